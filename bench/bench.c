@@ -0,0 +1,190 @@
+#include "bench.h"
+#include "../src/lib/error.h"
+#include "../src/lib/logger.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+uint16_t bench_warmup = 4;
+uint16_t bench_repetitions = 40;
+uint16_t bench_duration = 5;
+double bench_hz = 0;
+
+volatile uint64_t bench_used;
+
+void bench_keep(const void *pointer) { __asm__ volatile("" : : "r"(pointer) : "memory"); }
+
+void bench_use(uint64_t value) { bench_used += value; }
+
+uint64_t bench_now(void) {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t)now.tv_sec * 1000000000 + (uint64_t)now.tv_nsec;
+}
+
+uint64_t bench_ticks(void) {
+#if defined(__x86_64__)
+	return __builtin_ia32_rdtsc();
+#else
+	return 0;
+#endif
+}
+
+void bench_calibrate(void) {
+	uint64_t started_at = bench_now();
+	uint64_t ticks = bench_ticks();
+	while (bench_now() - started_at < 20000000) {
+	}
+	bench_hz = (double)(bench_ticks() - ticks) / (double)(bench_now() - started_at) * 1e9;
+}
+
+int bench_order(const void *left, const void *right) {
+	double difference = *(const double *)left - *(const double *)right;
+	return (difference > 0) - (difference < 0);
+}
+
+double bench_percentile(double *samples, uint16_t samples_len, uint8_t percent) {
+	uint32_t rank = ((uint32_t)samples_len * percent + 99) / 100;
+	return samples[rank == 0 ? 0 : rank - 1];
+}
+
+int bench_run(bench_t *bench, result_t *result) {
+	uint64_t budget = (uint64_t)bench_duration * 1000000;
+
+	uint64_t iterations = 1;
+	while (true) {
+		uint64_t start = bench_now();
+		bench->function(iterations);
+		uint64_t elapsed = bench_now() - start;
+		if (elapsed >= budget / 8 || iterations >= 1ull << 40) {
+			iterations = elapsed == 0 ? iterations : iterations * budget / elapsed;
+			break;
+		}
+		iterations *= elapsed < budget / 256 ? 16 : 2;
+	}
+	if (iterations == 0) {
+		iterations = 1;
+	}
+
+	for (uint16_t index = 0; index < bench_warmup; index++) {
+		bench->function(iterations);
+	}
+
+	double *samples = malloc(bench_repetitions * sizeof(*samples));
+	if (samples == NULL) {
+		error("failed to allocate %zu bytes for samples because %s\n", bench_repetitions * sizeof(*samples), errno_str());
+		return -1;
+	}
+
+	for (uint16_t index = 0; index < bench_repetitions; index++) {
+		uint64_t start = bench_now();
+		bench->function(iterations);
+		samples[index] = (double)(bench_now() - start) / (double)iterations;
+	}
+
+	qsort(samples, bench_repetitions, sizeof(*samples), &bench_order);
+
+	result->name = bench->name;
+	result->iterations = iterations;
+	result->low = samples[0];
+	result->median = bench_percentile(samples, bench_repetitions, 50);
+	result->high = bench_percentile(samples, bench_repetitions, 90);
+	result->tail = bench_percentile(samples, bench_repetitions, 99);
+	result->throughput = bench->bytes == 0 ? 0 : (double)bench->bytes / result->median * 1000;
+	result->bytes_per_cycle = bench->bytes == 0 || bench_hz == 0 ? 0 : (double)bench->bytes / (result->median * bench_hz / 1e9);
+
+	free(samples);
+	return 0;
+}
+
+void bench_report(result_t *result, baseline_t *baselines, uint16_t baselines_len, uint8_t threshold, bool *regressed) {
+	char throughput[16] = "-";
+	if (result->throughput != 0) {
+		snprintf(throughput, sizeof(throughput), "%.1f", result->throughput);
+	}
+
+	char bytes_per_cycle[16] = "-";
+	if (result->bytes_per_cycle != 0) {
+		snprintf(bytes_per_cycle, sizeof(bytes_per_cycle), "%.2f", result->bytes_per_cycle);
+	}
+
+	char comparison[24] = "";
+	for (uint16_t index = 0; index < baselines_len; index++) {
+		if (strcmp(baselines[index].name, result->name) != 0) {
+			continue;
+		}
+		double delta = (result->median - baselines[index].median) / baselines[index].median * 100;
+		const char *verdict = "";
+		if (delta > threshold) {
+			verdict = " slower";
+			*regressed = true;
+		} else if (delta < -(double)threshold) {
+			verdict = " faster";
+		}
+		snprintf(comparison, sizeof(comparison), "%+.1f%%%s", delta, verdict);
+		break;
+	}
+
+	printf("%-28s %12llu %10.1f %10.1f %10.1f %10.1f %10s %10s  %s\n", result->name, (unsigned long long)result->iterations,
+				 result->low, result->median, result->high, result->tail, throughput, bytes_per_cycle, comparison);
+	fflush(stdout);
+}
+
+int bench_load(const char *path, baseline_t **baselines, uint16_t *baselines_len) {
+	int status = 0;
+
+	FILE *file = fopen(path, "r");
+	if (file == NULL) {
+		error("failed to open %s because %s\n", path, errno_str());
+		return -1;
+	}
+
+	uint16_t cap = 0;
+	baseline_t baseline;
+	while (fscanf(file, "%47s %lf", baseline.name, &baseline.median) == 2) {
+		if (*baselines_len >= cap) {
+			cap = cap == 0 ? 64 : (uint16_t)(cap * 2);
+			baseline_t *grown = realloc(*baselines, cap * sizeof(*grown));
+			if (grown == NULL) {
+				error("failed to allocate %zu bytes for baselines because %s\n", cap * sizeof(*grown), errno_str());
+				status = -1;
+				goto cleanup;
+			}
+			*baselines = grown;
+		}
+		(*baselines)[*baselines_len] = baseline;
+		(*baselines_len)++;
+	}
+
+	if (ferror(file)) {
+		error("failed to read %s because %s\n", path, errno_str());
+		status = -1;
+	}
+
+cleanup:
+	fclose(file);
+	return status;
+}
+
+int bench_save(const char *path, result_t *results, uint16_t results_len) {
+	FILE *file = fopen(path, "w");
+	if (file == NULL) {
+		error("failed to open %s because %s\n", path, errno_str());
+		return -1;
+	}
+
+	for (uint16_t index = 0; index < results_len; index++) {
+		fprintf(file, "%s %.3f\n", results[index].name, results[index].median);
+	}
+
+	if (fclose(file) != 0) {
+		error("failed to write %s because %s\n", path, errno_str());
+		return -1;
+	}
+
+	info("saved %hu baselines to %s\n", results_len, path);
+	return 0;
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct bench_t {
+	const char *name;
+	size_t bytes;
+	void (*function)(uint64_t iterations);
+} bench_t;
+
+typedef struct result_t {
+	const char *name;
+	uint64_t iterations;
+	double low;
+	double median;
+	double high;
+	double tail;
+	double throughput;
+	double bytes_per_cycle;
+} result_t;
+
+typedef struct baseline_t {
+	char name[48];
+	double median;
+} baseline_t;
+
+typedef struct suite_t {
+	bench_t *benches;
+	uint8_t benches_len;
+} suite_t;
+
+extern uint16_t bench_warmup;
+extern uint16_t bench_repetitions;
+extern uint16_t bench_duration;
+extern double bench_hz;
+
+void bench_keep(const void *pointer);
+void bench_use(uint64_t value);
+void bench_calibrate(void);
+
+int bench_run(bench_t *bench, result_t *result);
+void bench_report(result_t *result, baseline_t *baselines, uint16_t baselines_len, uint8_t threshold, bool *regressed);
+
+int bench_load(const char *path, baseline_t **baselines, uint16_t *baselines_len);
+int bench_save(const char *path, result_t *results, uint16_t results_len);
+
+extern const char http_fixture[];
+extern const uint16_t http_fixture_len;
+
+extern bench_t http_benches[];
+extern const uint8_t http_benches_len;
+
+extern bench_t crypto_benches[];
+extern const uint8_t crypto_benches_len;
+
+extern bench_t codec_benches[];
+extern const uint8_t codec_benches_len;
+
+extern bench_t page_benches[];
+extern const uint8_t page_benches_len;
+
+extern bench_t runtime_benches[];
+extern const uint8_t runtime_benches_len;
+
+extern bench_t radio_benches[];
+extern const uint8_t radio_benches_len;
+
+int http_setup(void);
+int crypto_setup(void);
+int codec_setup(void);
+int page_setup(void);
+int runtime_setup(void);
+int radio_setup(void);
@@ -0,0 +1,248 @@
+#include "../src/app/airtime.h"
+#include "../src/lib/base16.h"
+#include "../src/lib/base32.h"
+#include "../src/lib/error.h"
+#include "../src/lib/logger.h"
+#include "../src/lib/scan.h"
+#include "bench.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+uint8_t codec_id[16];
+char codec_hex[32];
+uint8_t codec_token[68];
+char codec_base32[109];
+
+const char codec_long_fixture[] =
+		"POST /api/device/6a1f0c9e2b7d4e8fa3c5b1d7e9f02468/downlink?channel=4&confirm=true HTTP/1.1\r\n"
+		"Host: nexus.fieldlab.internal:2254\r\n"
+		"User-Agent: Mozilla/5.0 (Windows NT 10.0; Win64; x64) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/126.0.0.0 "
+		"Safari/537.36 Edg/126.0.0.0\r\n"
+		"Accept: application/json, text/plain, */*\r\n"
+		"Accept-Language: de-DE,de;q=0.9,en-US;q=0.8,en;q=0.7,fr;q=0.6\r\n"
+		"Accept-Encoding: gzip, deflate, br, zstd\r\n"
+		"Content-Type: application/octet-stream\r\n"
+		"Content-Length: 48\r\n"
+		"Origin: https://nexus.fieldlab.internal:2254\r\n"
+		"Referer: https://nexus.fieldlab.internal:2254/devices/6a1f0c9e2b7d4e8fa3c5b1d7e9f02468?tab=downlinks&order=created_at\r\n"
+		"sec-ch-ua: \"Not/A)Brand\";v=\"8\", \"Chromium\";v=\"126\", \"Microsoft Edge\";v=\"126\"\r\n"
+		"sec-ch-ua-mobile: ?0\r\n"
+		"sec-ch-ua-platform: \"Windows\"\r\n"
+		"Sec-Fetch-Dest: empty\r\n"
+		"Sec-Fetch-Mode: cors\r\n"
+		"Sec-Fetch-Site: same-origin\r\n"
+		"Cookie: auth=3ra5rmmlka7ahq2xk4mzv6n0c1p8tdw9yj5fbg7es3lr2ui6o4qhkn8m1zxv0cay7wdt5pfjb9gei2s6uoq3lr4kn8h1mzx7v0c; "
+		"_ga=GA1.1.1408237761.1718103645; _ga_Q7X4TRN0ZK=GS1.1.1718960412.14.1.1718960533.0.0.0; "
+		"theme=dark; sidebar=collapsed; table_density=compact; last_radio=3b9e7c1f5a2d4068; "
+		"consent=necessary%2Canalytics; tz=Europe%2FBerlin; locale=de-DE; "
+		"_pk_id.1.a3f2=8c1e5b7d9f2a4c6e.1718103645.; _pk_ses.1.a3f2=1; "
+		"grafana_session=9f8e7d6c5b4a39281706f5e4d3c2b1a0; grafana_session_expiry=1718964133\r\n"
+		"Priority: u=1, i\r\n"
+		"Connection: keep-alive\r\n"
+		"\r\n";
+
+char codec_firefox[1024];
+char codec_long[sizeof(codec_long_fixture)];
+
+radio_t codec_radios[] = {
+		{.bandwidth = 125000, .spreading_factor = 7, .coding_rate = 5, .preamble_len = 8, .checksum = true},
+		{.bandwidth = 250000, .spreading_factor = 9, .coding_rate = 6, .preamble_len = 10, .checksum = false},
+		{.bandwidth = 125000, .spreading_factor = 12, .coding_rate = 8, .preamble_len = 12, .checksum = true},
+};
+
+void codec_base16_encode_bench(uint64_t iterations) {
+	for (uint64_t index = 0; index < iterations; index++) {
+		bench_use((uint64_t)base16_encode(codec_hex, sizeof(codec_hex), codec_id, sizeof(codec_id)));
+	}
+}
+
+void codec_base16_decode_bench(uint64_t iterations) {
+	uint8_t id[16];
+	for (uint64_t index = 0; index < iterations; index++) {
+		bench_use((uint64_t)base16_decode(id, sizeof(id), codec_hex, sizeof(codec_hex)));
+	}
+	bench_keep(id);
+}
+
+void codec_base32_encode_bench(uint64_t iterations) {
+	for (uint64_t index = 0; index < iterations; index++) {
+		bench_use((uint64_t)base32_encode(codec_base32, sizeof(codec_base32), codec_token, sizeof(codec_token)));
+	}
+}
+
+void codec_base32_decode_bench(uint64_t iterations) {
+	uint8_t token[68];
+	for (uint64_t index = 0; index < iterations; index++) {
+		bench_use((uint64_t)base32_decode(token, sizeof(token), codec_base32, sizeof(codec_base32)));
+	}
+	bench_keep(token);
+}
+
+uint64_t codec_plain(uint32_t (*plain)(char *bytes, uint32_t len, char stop, char halt, bool fold), char *bytes,
+										 uint32_t len, uint64_t iterations) {
+	uint64_t runs = 0;
+	for (uint64_t index = 0; index < iterations; index++) {
+		for (uint32_t offset = 0; offset < len; offset++) {
+			offset += plain(&bytes[offset], len - offset, '\r', ':', false);
+			runs++;
+		}
+	}
+	return runs;
+}
+
+uint64_t codec_find(size_t (*find)(const char *bytes, size_t len, char lower, char upper), const char *bytes, size_t len,
+										uint64_t iterations) {
+	uint64_t lines = 0;
+	for (uint64_t index = 0; index < iterations; index++) {
+		for (size_t offset = 0; offset < len; offset++) {
+			offset += find(&bytes[offset], len - offset, '\n', '\n');
+			lines++;
+		}
+	}
+	return lines;
+}
+
+void codec_plain_firefox_scalar_bench(uint64_t iterations) {
+	bench_use(codec_plain(&scan_plain_scalar, codec_firefox, http_fixture_len, iterations));
+}
+
+void codec_plain_long_scalar_bench(uint64_t iterations) {
+	bench_use(codec_plain(&scan_plain_scalar, codec_long, sizeof(codec_long) - 1, iterations));
+}
+
+void codec_find_firefox_scalar_bench(uint64_t iterations) {
+	bench_use(codec_find(&scan_find_scalar, codec_firefox, http_fixture_len, iterations));
+}
+
+void codec_find_long_scalar_bench(uint64_t iterations) {
+	bench_use(codec_find(&scan_find_scalar, codec_long, sizeof(codec_long) - 1, iterations));
+}
+
+#if defined(__x86_64__)
+
+void codec_plain_firefox_sse2_bench(uint64_t iterations) {
+	bench_use(codec_plain(&scan_plain_sse2, codec_firefox, http_fixture_len, iterations));
+}
+
+void codec_plain_long_sse2_bench(uint64_t iterations) {
+	bench_use(codec_plain(&scan_plain_sse2, codec_long, sizeof(codec_long) - 1, iterations));
+}
+
+void codec_find_firefox_sse2_bench(uint64_t iterations) {
+	bench_use(codec_find(&scan_find_sse2, codec_firefox, http_fixture_len, iterations));
+}
+
+void codec_find_long_sse2_bench(uint64_t iterations) {
+	bench_use(codec_find(&scan_find_sse2, codec_long, sizeof(codec_long) - 1, iterations));
+}
+
+void codec_plain_firefox_avx2_bench(uint64_t iterations) {
+	bench_use(codec_plain(&scan_plain_avx2, codec_firefox, http_fixture_len, iterations));
+}
+
+void codec_plain_long_avx2_bench(uint64_t iterations) {
+	bench_use(codec_plain(&scan_plain_avx2, codec_long, sizeof(codec_long) - 1, iterations));
+}
+
+void codec_find_firefox_avx2_bench(uint64_t iterations) {
+	bench_use(codec_find(&scan_find_avx2, codec_firefox, http_fixture_len, iterations));
+}
+
+void codec_find_long_avx2_bench(uint64_t iterations) {
+	bench_use(codec_find(&scan_find_avx2, codec_long, sizeof(codec_long) - 1, iterations));
+}
+
+#elif defined(__aarch64__)
+
+void codec_plain_firefox_neon_bench(uint64_t iterations) {
+	bench_use(codec_plain(&scan_plain_neon, codec_firefox, http_fixture_len, iterations));
+}
+
+void codec_plain_long_neon_bench(uint64_t iterations) {
+	bench_use(codec_plain(&scan_plain_neon, codec_long, sizeof(codec_long) - 1, iterations));
+}
+
+void codec_find_firefox_neon_bench(uint64_t iterations) {
+	bench_use(codec_find(&scan_find_neon, codec_firefox, http_fixture_len, iterations));
+}
+
+void codec_find_long_neon_bench(uint64_t iterations) {
+	bench_use(codec_find(&scan_find_neon, codec_long, sizeof(codec_long) - 1, iterations));
+}
+
+#endif
+
+void codec_airtime_bench(uint64_t iterations) {
+	for (uint64_t index = 0; index < iterations; index++) {
+		radio_t *radio = &codec_radios[index % (sizeof(codec_radios) / sizeof(*codec_radios))];
+		bench_use(airtime_calculate(radio, (uint8_t)index));
+	}
+}
+
+int codec_setup(void) {
+	for (size_t index = 0; index < sizeof(codec_id); index++) {
+		codec_id[index] = (uint8_t)(index * 37 + 5);
+	}
+	for (size_t index = 0; index < sizeof(codec_token); index++) {
+		codec_token[index] = (uint8_t)(index * 53 + 1);
+	}
+	memcpy(codec_firefox, http_fixture, http_fixture_len);
+	memcpy(codec_long, codec_long_fixture, sizeof(codec_long_fixture));
+
+#if defined(__x86_64__)
+	__builtin_cpu_init();
+	bool avx2 = __builtin_cpu_supports("avx2");
+#endif
+	for (uint8_t index = 0; index < codec_benches_len; index++) {
+		if (strstr(codec_benches[index].name, ".firefox.") != NULL) {
+			codec_benches[index].bytes = http_fixture_len;
+		}
+#if defined(__x86_64__)
+		if (avx2 == false && strstr(codec_benches[index].name, ".avx2") != NULL) {
+			warn("skipping %s because cpu lacks avx2\n", codec_benches[index].name);
+			codec_benches[index].function = NULL;
+		}
+#endif
+	}
+
+	if (base16_encode(codec_hex, sizeof(codec_hex), codec_id, sizeof(codec_id)) == -1) {
+		error("failed to encode base 16 fixture\n");
+		return -1;
+	}
+	if (base32_encode(codec_base32, sizeof(codec_base32), codec_token, sizeof(codec_token)) == -1) {
+		error("failed to encode base 32 fixture\n");
+		return -1;
+	}
+
+	return 0;
+}
+
+bench_t codec_benches[] = {
+		{.name = "base16_encode.16", .bytes = sizeof(codec_id), .function = &codec_base16_encode_bench},
+		{.name = "base16_decode.16", .bytes = sizeof(codec_id), .function = &codec_base16_decode_bench},
+		{.name = "base32_encode.68", .bytes = sizeof(codec_token), .function = &codec_base32_encode_bench},
+		{.name = "base32_decode.68", .bytes = sizeof(codec_token), .function = &codec_base32_decode_bench},
+		{.name = "scan_plain.firefox.scalar", .bytes = 0, .function = &codec_plain_firefox_scalar_bench},
+		{.name = "scan_plain.long.scalar", .bytes = sizeof(codec_long) - 1, .function = &codec_plain_long_scalar_bench},
+		{.name = "scan_find.firefox.scalar", .bytes = 0, .function = &codec_find_firefox_scalar_bench},
+		{.name = "scan_find.long.scalar", .bytes = sizeof(codec_long) - 1, .function = &codec_find_long_scalar_bench},
+#if defined(__x86_64__)
+		{.name = "scan_plain.firefox.sse2", .bytes = 0, .function = &codec_plain_firefox_sse2_bench},
+		{.name = "scan_plain.long.sse2", .bytes = sizeof(codec_long) - 1, .function = &codec_plain_long_sse2_bench},
+		{.name = "scan_find.firefox.sse2", .bytes = 0, .function = &codec_find_firefox_sse2_bench},
+		{.name = "scan_find.long.sse2", .bytes = sizeof(codec_long) - 1, .function = &codec_find_long_sse2_bench},
+		{.name = "scan_plain.firefox.avx2", .bytes = 0, .function = &codec_plain_firefox_avx2_bench},
+		{.name = "scan_plain.long.avx2", .bytes = sizeof(codec_long) - 1, .function = &codec_plain_long_avx2_bench},
+		{.name = "scan_find.firefox.avx2", .bytes = 0, .function = &codec_find_firefox_avx2_bench},
+		{.name = "scan_find.long.avx2", .bytes = sizeof(codec_long) - 1, .function = &codec_find_long_avx2_bench},
+#elif defined(__aarch64__)
+		{.name = "scan_plain.firefox.neon", .bytes = 0, .function = &codec_plain_firefox_neon_bench},
+		{.name = "scan_plain.long.neon", .bytes = sizeof(codec_long) - 1, .function = &codec_plain_long_neon_bench},
+		{.name = "scan_find.firefox.neon", .bytes = 0, .function = &codec_find_firefox_neon_bench},
+		{.name = "scan_find.long.neon", .bytes = sizeof(codec_long) - 1, .function = &codec_find_long_neon_bench},
+#endif
+		{.name = "airtime_calculate", .bytes = 0, .function = &codec_airtime_bench},
+};
+
+const uint8_t codec_benches_len = sizeof(codec_benches) / sizeof(*codec_benches);
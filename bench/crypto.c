@@ -0,0 +1,150 @@
+#include "../src/lib/bwt.h"
+#include "../src/lib/error.h"
+#include "../src/lib/logger.h"
+#include "../src/lib/sha256.h"
+#include "../src/lib/ssc128.h"
+#include "bench.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+uint8_t crypto_data[4096];
+uint8_t crypto_payload[255];
+uint8_t crypto_key[16];
+ssc128_key_t crypto_expanded;
+sha256_key_t crypto_keyed;
+char crypto_cookie[5 + 109 + 1];
+size_t crypto_cookie_len;
+
+void crypto_blocks_scalar_bench(uint64_t iterations) {
+	uint32_t state[8] = {0};
+	for (uint64_t index = 0; index < iterations; index++) {
+		sha256_blocks_scalar(&state, crypto_data, sizeof(crypto_data) / 64);
+	}
+	bench_keep(state);
+}
+
+void crypto_blocks_selected_bench(uint64_t iterations) {
+	uint32_t state[8] = {0};
+	for (uint64_t index = 0; index < iterations; index++) {
+		sha256_blocks(&state, crypto_data, sizeof(crypto_data) / 64);
+	}
+	bench_keep(state);
+}
+
+void crypto_digest_bench(uint64_t iterations) {
+	uint8_t hash[32];
+	for (uint64_t index = 0; index < iterations; index++) {
+		sha256(crypto_data, 64, &hash);
+		bench_keep(hash);
+	}
+}
+
+void crypto_hmac_bench(uint64_t iterations) {
+	uint8_t hmac[32];
+	for (uint64_t index = 0; index < iterations; index++) {
+		sha256_hmac(crypto_key, sizeof(crypto_key), crypto_data, 68, &hmac);
+		bench_keep(hmac);
+	}
+}
+
+void crypto_hmac_keyed_bench(uint64_t iterations) {
+	uint8_t hmac[32];
+	for (uint64_t index = 0; index < iterations; index++) {
+		sha256_hmac_keyed(&crypto_keyed, crypto_data, 68, &hmac);
+		bench_keep(hmac);
+	}
+}
+
+void crypto_sign_bench(uint64_t iterations) {
+	char buffer[109];
+	uint8_t id[16] = {0};
+	uint8_t data[4] = {0};
+	for (uint64_t index = 0; index < iterations; index++) {
+		bwt_sign(&buffer, &id, &data);
+		bench_keep(buffer);
+	}
+}
+
+void crypto_verify_bench(uint64_t iterations) {
+	bwt_t bwt;
+	for (uint64_t index = 0; index < iterations; index++) {
+		bench_use((uint64_t)bwt_verify(crypto_cookie, crypto_cookie_len, &bwt));
+	}
+}
+
+void crypto_verify_cold_bench(uint64_t iterations) {
+	uint16_t cap = tokens.cap;
+	tokens.cap = 0;
+	crypto_verify_bench(iterations);
+	tokens.cap = cap;
+}
+
+void crypto_expand_bench(uint64_t iterations) {
+	for (uint64_t index = 0; index < iterations; index++) {
+		ssc128_expand((const uint8_t (*)[16])&crypto_key, &crypto_expanded);
+		bench_keep(&crypto_expanded);
+	}
+}
+
+void crypto_encrypt_bench(uint64_t iterations) {
+	for (uint64_t index = 0; index < iterations; index++) {
+		ssc128_encrypt(crypto_payload, sizeof(crypto_payload), (uint16_t)index, &crypto_expanded);
+		bench_keep(crypto_payload);
+	}
+}
+
+void crypto_encrypt_scalar_bench(uint64_t iterations) {
+	void (*lanes)(const ssc128_key_t *key, uint32_t *alpha, uint32_t *bravo, uint8_t count) = ssc128_lanes;
+	ssc128_lanes = &ssc128_lanes_scalar;
+	crypto_encrypt_bench(iterations);
+	ssc128_lanes = lanes;
+}
+
+int crypto_setup(void) {
+	for (size_t index = 0; index < sizeof(crypto_data); index++) {
+		crypto_data[index] = (uint8_t)(index * 131 + 7);
+	}
+	for (size_t index = 0; index < sizeof(crypto_payload); index++) {
+		crypto_payload[index] = (uint8_t)(index * 17 + 3);
+	}
+	for (size_t index = 0; index < sizeof(crypto_key); index++) {
+		crypto_key[index] = (uint8_t)(index * 29 + 11);
+	}
+
+	sha256_hmac_key(crypto_key, sizeof(crypto_key), &crypto_keyed);
+	ssc128_expand((const uint8_t (*)[16])&crypto_key, &crypto_expanded);
+
+	char buffer[109];
+	uint8_t id[16] = {0};
+	uint8_t data[4] = {0};
+	if (bwt_sign(&buffer, &id, &data) == -1) {
+		error("failed to sign bwt fixture\n");
+		return -1;
+	}
+	crypto_cookie_len = (size_t)snprintf(crypto_cookie, sizeof(crypto_cookie), "auth=%.*s", (int)sizeof(buffer), buffer);
+
+	bwt_t bwt;
+	if (bwt_verify(crypto_cookie, crypto_cookie_len, &bwt) == -1) {
+		error("failed to verify bwt fixture\n");
+		return -1;
+	}
+
+	return 0;
+}
+
+bench_t crypto_benches[] = {
+		{.name = "sha256.blocks.scalar", .bytes = sizeof(crypto_data), .function = &crypto_blocks_scalar_bench},
+		{.name = "sha256.blocks.selected", .bytes = sizeof(crypto_data), .function = &crypto_blocks_selected_bench},
+		{.name = "sha256.digest.64", .bytes = 64, .function = &crypto_digest_bench},
+		{.name = "sha256_hmac", .bytes = 68, .function = &crypto_hmac_bench},
+		{.name = "sha256_hmac.keyed", .bytes = 68, .function = &crypto_hmac_keyed_bench},
+		{.name = "bwt_sign", .bytes = 0, .function = &crypto_sign_bench},
+		{.name = "bwt_verify.cached", .bytes = 0, .function = &crypto_verify_bench},
+		{.name = "bwt_verify.cold", .bytes = 0, .function = &crypto_verify_cold_bench},
+		{.name = "ssc128_expand", .bytes = 0, .function = &crypto_expand_bench},
+		{.name = "ssc128_crypt.scalar.255", .bytes = sizeof(crypto_payload), .function = &crypto_encrypt_scalar_bench},
+		{.name = "ssc128_crypt.selected.255", .bytes = sizeof(crypto_payload), .function = &crypto_encrypt_bench},
+};
+
+const uint8_t crypto_benches_len = sizeof(crypto_benches) / sizeof(*crypto_benches);
@@ -0,0 +1,129 @@
+#include "../src/api/router.h"
+#include "../src/lib/config.h"
+#include "../src/lib/error.h"
+#include "../src/lib/logger.h"
+#include "../src/lib/request.h"
+#include "../src/lib/response.h"
+#include "bench.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+const char http_fixture[] = "GET /api/radios?limit=16&offset=0&order=frequency&sort=asc HTTP/1.1\r\n"
+														"Host: localhost:2254\r\n"
+														"User-Agent: Mozilla/5.0 (X11; Linux x86_64; rv:128.0) Gecko/20100101 Firefox/128.0\r\n"
+														"Accept: application/json, text/plain, */*\r\n"
+														"Accept-Language: en-US,en;q=0.5\r\n"
+														"Accept-Encoding: gzip, deflate, br\r\n"
+														"Referer: http://localhost:2254/radios\r\n"
+														"Connection: keep-alive\r\n"
+														"Sec-Fetch-Dest: empty\r\n"
+														"Sec-Fetch-Mode: cors\r\n"
+														"Sec-Fetch-Site: same-origin\r\n"
+														"Priority: u=0\r\n"
+														"\r\n";
+const uint16_t http_fixture_len = sizeof(http_fixture) - 1;
+
+char http_buffer[sizeof(http_fixture)];
+parser_t http_parser;
+request_t http_request;
+response_t http_response;
+char *http_response_buffer;
+
+void http_parse(void) {
+	memcpy(http_buffer, http_fixture, sizeof(http_fixture) - 1);
+	request_reset(&http_parser);
+	request_parse(&http_parser, http_buffer, sizeof(http_fixture) - 1);
+	response_init(&http_response, http_response_buffer);
+	request(http_buffer, sizeof(http_fixture) - 1, &http_parser, &http_request, &http_response);
+}
+
+void http_request_bench(uint64_t iterations) {
+	for (uint64_t index = 0; index < iterations; index++) {
+		http_parse();
+		bench_keep(&http_request);
+	}
+}
+
+void http_header_first_bench(uint64_t iterations) {
+	uint16_t value_len;
+	for (uint64_t index = 0; index < iterations; index++) {
+		bench_keep(header_find(&http_request, "host", &value_len));
+	}
+}
+
+void http_header_last_bench(uint64_t iterations) {
+	uint16_t value_len;
+	for (uint64_t index = 0; index < iterations; index++) {
+		bench_keep(header_find(&http_request, "priority", &value_len));
+	}
+}
+
+void http_header_missing_bench(uint64_t iterations) {
+	uint16_t value_len;
+	for (uint64_t index = 0; index < iterations; index++) {
+		bench_keep(header_find(&http_request, "authorization", &value_len));
+	}
+}
+
+void http_route(uint64_t iterations, char *method, char *pathname) {
+	request_t routed = http_request;
+	routed.method.ptr = method;
+	routed.method.len = (uint8_t)strlen(method);
+	routed.pathname.ptr = pathname;
+	routed.pathname.len = (uint8_t)strlen(pathname);
+
+	for (uint64_t index = 0; index < iterations; index++) {
+		response_init(&http_response, http_response_buffer);
+		bench_use((uint64_t)route(NULL, &routed, &http_response));
+	}
+}
+
+void http_route_method_bench(uint64_t iterations) { http_route(iterations, "delete", "/api/radios"); }
+
+void http_route_param_bench(uint64_t iterations) {
+	http_route(iterations, "patch", "/api/device/0123456789abcdef0123456789abcdef");
+}
+
+void http_route_miss_bench(uint64_t iterations) { http_route(iterations, "get", "/api/transmissions/missing"); }
+
+void http_response_bench(uint64_t iterations) {
+	for (uint64_t index = 0; index < iterations; index++) {
+		response_init(&http_response, http_response_buffer);
+		http_response.status = 200;
+		header_write(&http_response, "content-type:application/json\r\n");
+		body_write(&http_response, "[]", 2);
+		bench_use(response(&http_request, &http_response, http_response_buffer));
+	}
+}
+
+int http_setup(void) {
+	http_response_buffer = malloc(send_buffer);
+	if (http_response_buffer == NULL) {
+		error("failed to allocate %u bytes for response because %s\n", send_buffer, errno_str());
+		return -1;
+	}
+
+	int sock = -1;
+	request_init(&http_request, &sock);
+	http_parse();
+	if (http_parser.status != 0 || http_request.headers_len != 11) {
+		error("fixture parsed with status %hu and %hhu headers\n", http_parser.status, http_request.headers_len);
+		return -1;
+	}
+
+	return 0;
+}
+
+bench_t http_benches[] = {
+		{.name = "request.parse", .bytes = sizeof(http_fixture) - 1, .function = &http_request_bench},
+		{.name = "header_find.first", .bytes = 0, .function = &http_header_first_bench},
+		{.name = "header_find.last", .bytes = 0, .function = &http_header_last_bench},
+		{.name = "header_find.missing", .bytes = 0, .function = &http_header_missing_bench},
+		{.name = "route.method", .bytes = 0, .function = &http_route_method_bench},
+		{.name = "route.param", .bytes = 0, .function = &http_route_param_bench},
+		{.name = "route.miss", .bytes = 0, .function = &http_route_miss_bench},
+		{.name = "response.write", .bytes = 0, .function = &http_response_bench},
+};
+
+const uint8_t http_benches_len = sizeof(http_benches) / sizeof(*http_benches);
@@ -0,0 +1,159 @@
+#define _GNU_SOURCE
+
+#include "../src/api/router.h"
+#include "../src/lib/bwt.h"
+#include "../src/lib/config.h"
+#include "../src/lib/error.h"
+#include "../src/lib/format.h"
+#include "../src/lib/logger.h"
+#include "../src/lib/scan.h"
+#include "../src/lib/sha256.h"
+#include "../src/lib/ssc128.h"
+#include "bench.h"
+#include <errno.h>
+#include <sched.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+int main(int argc, char *argv[]) {
+	logger_init();
+	log_level = 3;
+
+	const char *filter = "";
+	const char *save = NULL;
+	const char *compare = NULL;
+	uint8_t threshold = 5;
+
+	int errors = 0;
+	for (int ind = 1; ind < argc; ind++) {
+		const char *flag = argv[ind];
+		if (match_arg(flag, "--help", "-h")) {
+			printf("available command line flags\n");
+			printf("--filter            -f   run benches containing text      (all)\n");
+			printf("--warmup            -w   discarded runs before sampling   (%hu)\n", bench_warmup);
+			printf("--repetitions       -r   sampled runs per bench           (%hu)\n", bench_repetitions);
+			printf("--duration          -d   milliseconds per sampled run     (%hu)\n", bench_duration);
+			printf("--save              -s   write medians to baseline file   (none)\n");
+			printf("--compare           -c   compare against baseline file    (none)\n");
+			printf("--threshold         -t   percent change to flag           (%hhu)\n", threshold);
+			printf("--log-level         -ll  logging verbosity to print       (%s)\n", human_log_level(log_level));
+			exit(0);
+		} else if (match_arg(flag, "--filter", "-f")) {
+			errors += parse_str(next_arg(argc, argv, &ind), "filter", 1, 47, &filter);
+		} else if (match_arg(flag, "--warmup", "-w")) {
+			errors += parse_uint16(next_arg(argc, argv, &ind), "warmup", 0, 1024, &bench_warmup);
+		} else if (match_arg(flag, "--repetitions", "-r")) {
+			errors += parse_uint16(next_arg(argc, argv, &ind), "repetitions", 1, 4096, &bench_repetitions);
+		} else if (match_arg(flag, "--duration", "-d")) {
+			errors += parse_uint16(next_arg(argc, argv, &ind), "duration", 1, 2000, &bench_duration);
+		} else if (match_arg(flag, "--save", "-s")) {
+			errors += parse_str(next_arg(argc, argv, &ind), "save", 1, 255, &save);
+		} else if (match_arg(flag, "--compare", "-c")) {
+			errors += parse_str(next_arg(argc, argv, &ind), "compare", 1, 255, &compare);
+		} else if (match_arg(flag, "--threshold", "-t")) {
+			errors += parse_uint8(next_arg(argc, argv, &ind), "threshold", 1, 100, &threshold);
+		} else if (match_arg(flag, "--log-level", "-ll")) {
+			errors += parse_log_level(next_arg(argc, argv, &ind), &log_level);
+		} else {
+			error("unknown argument %s\n", flag);
+			errors++;
+		}
+	}
+
+	if (errors != 0) {
+		fatal("config contains %d errors\n", errors);
+		exit(1);
+	}
+
+	baseline_t *baselines = NULL;
+	uint16_t baselines_len = 0;
+	if (compare != NULL && bench_load(compare, &baselines, &baselines_len) == -1) {
+		exit(1);
+	}
+
+	int cpu = sched_getcpu();
+	cpu_set_t cpus;
+	CPU_ZERO(&cpus);
+	CPU_SET((size_t)(cpu == -1 ? 0 : cpu), &cpus);
+	if (sched_setaffinity(0, sizeof(cpus), &cpus) == -1) {
+		warn("failed to pin bench to one cpu because %s\n", errno_str());
+	}
+
+	const char *sha256_backend = sha256_select();
+	if (sha256_backend == NULL) {
+		fatal("sha256 failed known answer tests\n");
+		exit(1);
+	}
+	const char *scan_backend = scan_init();
+	const char *ssc128_backend = ssc128_init();
+
+	if (router_init() == -1 || bwt_init() == -1) {
+		exit(1);
+	}
+
+	suite_t suites[] = {
+			{.benches = http_benches, .benches_len = http_benches_len},
+			{.benches = crypto_benches, .benches_len = crypto_benches_len},
+			{.benches = codec_benches, .benches_len = codec_benches_len},
+			{.benches = page_benches, .benches_len = page_benches_len},
+			{.benches = runtime_benches, .benches_len = runtime_benches_len},
+			{.benches = radio_benches, .benches_len = radio_benches_len},
+	};
+
+	if (http_setup() == -1 || crypto_setup() == -1 || codec_setup() == -1 || page_setup() == -1 || runtime_setup() == -1 ||
+			radio_setup() == -1) {
+		fatal("failed to set up bench fixtures\n");
+		exit(1);
+	}
+
+	bench_calibrate();
+
+	printf("nexus %s %s sha256 %s scan %s ssc128 %s\n", version, commit, sha256_backend, scan_backend, ssc128_backend);
+	printf("warmup %hu repetitions %hu duration %hums\n\n", bench_warmup, bench_repetitions, bench_duration);
+	printf("%-28s %12s %10s %10s %10s %10s %10s %10s  %s\n", "bench", "ops/run", "min ns", "p50 ns", "p90 ns", "p99 ns", "mb/s",
+				 "b/cycle", compare != NULL ? "vs baseline" : "");
+
+	uint16_t results_len = 0;
+	for (uint8_t index = 0; index < sizeof(suites) / sizeof(*suites); index++) {
+		results_len += suites[index].benches_len;
+	}
+
+	result_t *results = malloc(results_len * sizeof(*results));
+	if (results == NULL) {
+		fatal("failed to allocate %zu bytes for results because %s\n", results_len * sizeof(*results), errno_str());
+		exit(1);
+	}
+
+	bool regressed = false;
+	results_len = 0;
+	for (uint8_t index = 0; index < sizeof(suites) / sizeof(*suites); index++) {
+		for (uint8_t ind = 0; ind < suites[index].benches_len; ind++) {
+			bench_t *bench = &suites[index].benches[ind];
+			if (bench->function == NULL || strstr(bench->name, filter) == NULL) {
+				continue;
+			}
+			if (bench_run(bench, &results[results_len]) == -1) {
+				exit(1);
+			}
+			bench_report(&results[results_len], baselines, baselines_len, threshold, &regressed);
+			results_len++;
+		}
+	}
+
+	if (save != NULL && bench_save(save, results, results_len) == -1) {
+		exit(1);
+	}
+
+	free(results);
+	free(baselines);
+
+	if (regressed == true) {
+		error("benches regressed more than %hhu%% against %s\n", threshold, compare);
+		exit(1);
+	}
+
+	return 0;
+}
@@ -0,0 +1,104 @@
+#include "../src/app/assemble.h"
+#include "../src/app/file.h"
+#include "../src/app/hydrate.h"
+#include "../src/lib/error.h"
+#include "../src/lib/logger.h"
+#include "bench.h"
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+file_t page_raw = {.fd = -1, .path = "./src/app/pages/radios.html", .lock = PTHREAD_RWLOCK_INITIALIZER};
+file_t page_assembled = {.fd = -1, .path = "./src/app/pages/radios.html", .lock = PTHREAD_RWLOCK_INITIALIZER};
+
+int page_copy(file_t *source, file_t *copy) {
+	copy->ptr = malloc(source->len);
+	if (copy->ptr == NULL) {
+		error("failed to allocate %zu bytes for %s because %s\n", source->len, source->path, errno_str());
+		return -1;
+	}
+	memcpy(copy->ptr, source->ptr, source->len);
+	copy->len = source->len;
+	copy->path = source->path;
+	copy->hydrated = false;
+	return 0;
+}
+
+void page_assemble_bench(uint64_t iterations) {
+	for (uint64_t index = 0; index < iterations; index++) {
+		file_t asset;
+		if (page_copy(&page_raw, &asset) == -1) {
+			return;
+		}
+		bench_use((uint64_t)assemble(&asset));
+		free(asset.ptr);
+	}
+}
+
+void page_extract_bench(uint64_t iterations) {
+	class_t classes[256];
+	for (uint64_t index = 0; index < iterations; index++) {
+		uint16_t classes_len = 0;
+		bench_use((uint64_t)extract(&page_assembled, &classes, &classes_len));
+		bench_keep(classes);
+	}
+}
+
+void page_hydrate_bench(uint64_t iterations) {
+	class_t classes[256];
+	uint16_t extracted_len = 0;
+	extract(&page_assembled, &classes, &extracted_len);
+
+	for (uint64_t index = 0; index < iterations; index++) {
+		file_t asset;
+		if (page_copy(&page_assembled, &asset) == -1) {
+			return;
+		}
+		uint16_t classes_len = extracted_len;
+		bench_use((uint64_t)hydrate(&asset, &classes, &classes_len));
+		free(asset.ptr);
+	}
+}
+
+void page_pipeline_bench(uint64_t iterations) {
+	class_t classes[256];
+	for (uint64_t index = 0; index < iterations; index++) {
+		file_t asset;
+		if (page_copy(&page_raw, &asset) == -1) {
+			return;
+		}
+		uint16_t classes_len = 0;
+		if (assemble(&asset) == 0 && extract(&asset, &classes, &classes_len) == 0) {
+			bench_use((uint64_t)hydrate(&asset, &classes, &classes_len));
+		}
+		free(asset.ptr);
+	}
+}
+
+int page_setup(void) {
+	if (file(&page_raw) == -1 || file(&page_assembled) == -1) {
+		return -1;
+	}
+
+	if (assemble(&page_assembled) == -1) {
+		error("failed to assemble %s\n", page_assembled.path);
+		return -1;
+	}
+
+	page_benches[0].bytes = page_raw.len;
+	page_benches[1].bytes = page_assembled.len;
+	page_benches[2].bytes = page_assembled.len;
+	page_benches[3].bytes = page_raw.len;
+
+	return 0;
+}
+
+bench_t page_benches[] = {
+		{.name = "page.assemble", .bytes = 0, .function = &page_assemble_bench},
+		{.name = "page.extract", .bytes = 0, .function = &page_extract_bench},
+		{.name = "page.hydrate", .bytes = 0, .function = &page_hydrate_bench},
+		{.name = "page.pipeline", .bytes = 0, .function = &page_pipeline_bench},
+};
+
+const uint8_t page_benches_len = sizeof(page_benches) / sizeof(*page_benches);
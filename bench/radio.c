@@ -0,0 +1,136 @@
+#define _GNU_SOURCE
+
+#include "../src/app/sim.h"
+#include "../src/app/spi.h"
+#include "../src/lib/error.h"
+#include "../src/lib/logger.h"
+#include "bench.h"
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <unistd.h>
+
+spi_t radio_spi;
+uint8_t radio_fifo[255];
+
+spi_t radio_split[4];
+spi_t radio_shared[4];
+uint64_t radio_iterations;
+
+void radio_fifo_read_single_bench(uint64_t iterations) {
+	for (uint64_t index = 0; index < iterations; index++) {
+		spi_write_register(&radio_spi, 0x0d, 0x00);
+		for (uint8_t byte = 0; byte < sizeof(radio_fifo); byte++) {
+			spi_read_register(&radio_spi, 0x00, &radio_fifo[byte]);
+		}
+	}
+	bench_keep(radio_fifo);
+}
+
+void radio_fifo_read_burst_bench(uint64_t iterations) {
+	for (uint64_t index = 0; index < iterations; index++) {
+		spi_write_register(&radio_spi, 0x0d, 0x00);
+		spi_read_burst(&radio_spi, 0x00, radio_fifo, sizeof(radio_fifo));
+	}
+	bench_keep(radio_fifo);
+}
+
+void radio_fifo_write_single_bench(uint64_t iterations) {
+	for (uint64_t index = 0; index < iterations; index++) {
+		spi_write_register(&radio_spi, 0x0d, 0x80);
+		for (uint8_t byte = 0; byte < sizeof(radio_fifo); byte++) {
+			spi_write_register(&radio_spi, 0x00, radio_fifo[byte]);
+		}
+	}
+	bench_keep(radio_fifo);
+}
+
+void radio_fifo_write_burst_bench(uint64_t iterations) {
+	for (uint64_t index = 0; index < iterations; index++) {
+		spi_write_register(&radio_spi, 0x0d, 0x80);
+		spi_write_burst(&radio_spi, 0x00, radio_fifo, sizeof(radio_fifo));
+	}
+	bench_keep(radio_fifo);
+}
+
+void *radio_drain(void *args) {
+	spi_t *spi = args;
+	uint8_t fifo[255];
+	for (uint64_t index = 0; index < radio_iterations; index++) {
+		spi_write_register(spi, 0x0d, 0x00);
+		spi_read_burst(spi, 0x00, fifo, sizeof(fifo));
+	}
+	bench_keep(fifo);
+	return NULL;
+}
+
+void radio_parallel(spi_t (*spis)[4], uint64_t iterations) {
+	radio_iterations = iterations;
+
+	cpu_set_t cpus;
+	CPU_ZERO(&cpus);
+	long online = sysconf(_SC_NPROCESSORS_ONLN);
+	for (long cpu = 0; cpu < (online < CPU_SETSIZE ? online : CPU_SETSIZE); cpu++) {
+		CPU_SET((size_t)cpu, &cpus);
+	}
+
+	pthread_attr_t attr;
+	pthread_attr_init(&attr);
+	pthread_attr_setaffinity_np(&attr, sizeof(cpus), &cpus);
+
+	pthread_t threads[4];
+	uint8_t threads_len = 0;
+	for (uint8_t index = 0; index < sizeof(threads) / sizeof(*threads); index++) {
+		if ((errno = pthread_create(&threads[index], &attr, &radio_drain, &(*spis)[index])) != 0) {
+			error("failed to spawn radio thread because %s\n", errno_str());
+			break;
+		}
+		threads_len++;
+	}
+
+	for (uint8_t index = 0; index < threads_len; index++) {
+		pthread_join(threads[index], NULL);
+	}
+	pthread_attr_destroy(&attr);
+}
+
+void radio_bus_split_bench(uint64_t iterations) {
+	radio_parallel(&radio_split, iterations);
+}
+
+void radio_bus_shared_bench(uint64_t iterations) {
+	radio_parallel(&radio_shared, iterations);
+}
+
+int radio_setup(void) {
+	for (uint8_t byte = 0; byte < sizeof(radio_fifo); byte++) {
+		radio_fifo[byte] = byte;
+	}
+
+	for (uint8_t index = 0; index < 4; index++) {
+		char device[32];
+		sprintf(device, "sim-split%hhu", index);
+		if (spi_init(&radio_split[index], device, 0, 8 * 1000 * 1000, 8) == -1) {
+			return -1;
+		}
+		sprintf(device, "sim-shared.%hhu", index);
+		if (spi_init(&radio_shared[index], device, 0, 8 * 1000 * 1000, 8) == -1) {
+			return -1;
+		}
+	}
+
+	return spi_init(&radio_spi, "sim-bench", 0, 8 * 1000 * 1000, 8);
+}
+
+bench_t radio_benches[] = {
+		{.name = "spi.fifo.read.single", .bytes = sizeof(radio_fifo), .function = &radio_fifo_read_single_bench},
+		{.name = "spi.fifo.read.burst", .bytes = sizeof(radio_fifo), .function = &radio_fifo_read_burst_bench},
+		{.name = "spi.fifo.write.single", .bytes = sizeof(radio_fifo), .function = &radio_fifo_write_single_bench},
+		{.name = "spi.fifo.write.burst", .bytes = sizeof(radio_fifo), .function = &radio_fifo_write_burst_bench},
+		{.name = "spi.bus.split.4", .bytes = 4 * sizeof(radio_fifo), .function = &radio_bus_split_bench},
+		{.name = "spi.bus.shared.4", .bytes = 4 * sizeof(radio_fifo), .function = &radio_bus_shared_bench},
+};
+
+const uint8_t radio_benches_len = sizeof(radio_benches) / sizeof(*radio_benches);
@@ -0,0 +1,250 @@
+#define _GNU_SOURCE
+
+#include "../src/lib/config.h"
+#include "../src/lib/error.h"
+#include "../src/lib/logger.h"
+#include "../src/lib/metrics.h"
+#include "../src/lib/thread.h"
+#include "bench.h"
+#include <errno.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+typedef struct locked_t {
+	task_t *tasks;
+	uint16_t head;
+	uint16_t tail;
+	uint16_t size;
+	pthread_mutex_t lock;
+	pthread_cond_t filled;
+	pthread_cond_t available;
+} locked_t;
+
+uint8_t runtime_bytes[64];
+
+locked_t runtime_locked = {
+		.tasks = NULL,
+		.head = 0,
+		.tail = 0,
+		.size = 0,
+		.lock = PTHREAD_MUTEX_INITIALIZER,
+		.filled = PTHREAD_COND_INITIALIZER,
+		.available = PTHREAD_COND_INITIALIZER,
+};
+
+const uint8_t runtime_contenders = 4;
+uint64_t runtime_transfers;
+atomic_bool runtime_stopping = false;
+
+void runtime_locked_push(task_t *task) {
+	pthread_mutex_lock(&runtime_locked.lock);
+	while (runtime_locked.size == queue_size) {
+		pthread_cond_wait(&runtime_locked.available, &runtime_locked.lock);
+	}
+	runtime_locked.tasks[runtime_locked.tail] = *task;
+	runtime_locked.tail = (uint16_t)((runtime_locked.tail + 1) % queue_size);
+	runtime_locked.size++;
+	pthread_cond_signal(&runtime_locked.filled);
+	pthread_mutex_unlock(&runtime_locked.lock);
+}
+
+void runtime_locked_pop(task_t *task) {
+	pthread_mutex_lock(&runtime_locked.lock);
+	while (runtime_locked.size == 0) {
+		pthread_cond_wait(&runtime_locked.filled, &runtime_locked.lock);
+	}
+	*task = runtime_locked.tasks[runtime_locked.head];
+	runtime_locked.head = (uint16_t)((runtime_locked.head + 1) % queue_size);
+	runtime_locked.size--;
+	pthread_cond_signal(&runtime_locked.available);
+	pthread_mutex_unlock(&runtime_locked.lock);
+}
+
+void *runtime_locked_produce(void *args) {
+	task_t task = {.conn = args};
+	for (uint64_t index = 0; index < runtime_transfers; index++) {
+		runtime_locked_push(&task);
+	}
+	return NULL;
+}
+
+void *runtime_locked_consume(void *args) {
+	task_t task = {.conn = args};
+	for (uint64_t index = 0; index < runtime_transfers; index++) {
+		runtime_locked_pop(&task);
+	}
+	bench_keep(&task);
+	return NULL;
+}
+
+void *runtime_queue_produce(void *args) {
+	task_t task = {.conn = args};
+	for (uint64_t index = 0; index < runtime_transfers; index++) {
+		while (queue_push(&task) == false) {
+			sched_yield();
+		}
+	}
+	return NULL;
+}
+
+void *runtime_queue_consume(void *args) {
+	task_t task = {.conn = args};
+	for (uint64_t index = 0; index < runtime_transfers; index++) {
+		queue_pop(&task, &runtime_stopping);
+	}
+	bench_keep(&task);
+	return NULL;
+}
+
+void runtime_contend(void *(*produce)(void *), void *(*consume)(void *), uint64_t iterations) {
+	runtime_transfers = (iterations + runtime_contenders - 1) / runtime_contenders;
+
+	cpu_set_t cpus;
+	CPU_ZERO(&cpus);
+	long online = sysconf(_SC_NPROCESSORS_ONLN);
+	for (long cpu = 0; cpu < (online < CPU_SETSIZE ? online : CPU_SETSIZE); cpu++) {
+		CPU_SET((size_t)cpu, &cpus);
+	}
+
+	pthread_attr_t attr;
+	pthread_attr_init(&attr);
+	pthread_attr_setaffinity_np(&attr, sizeof(cpus), &cpus);
+
+	pthread_t threads[8];
+	uint8_t threads_len = 0;
+	for (uint8_t index = 0; index < runtime_contenders * 2; index++) {
+		void *(*function)(void *) = index % 2 == 0 ? produce : consume;
+		if ((errno = pthread_create(&threads[index], &attr, function, NULL)) != 0) {
+			error("failed to spawn contender thread because %s\n", errno_str());
+			break;
+		}
+		threads_len++;
+	}
+
+	for (uint8_t index = 0; index < threads_len; index++) {
+		pthread_join(threads[index], NULL);
+	}
+	pthread_attr_destroy(&attr);
+}
+
+void runtime_queue_bench(uint64_t iterations) {
+	task_t task = {.conn = NULL};
+	for (uint64_t index = 0; index < iterations; index++) {
+		queue_try_push(&task);
+		queue_try_pop(&task);
+	}
+	bench_keep(&task);
+}
+
+void runtime_queue_burst_bench(uint64_t iterations) {
+	task_t task = {.conn = NULL};
+	for (uint64_t index = 0; index < iterations; index++) {
+		for (uint8_t burst = 0; burst < 16; burst++) {
+			queue_try_push(&task);
+		}
+		for (uint8_t burst = 0; burst < 16; burst++) {
+			queue_try_pop(&task);
+		}
+	}
+	bench_keep(&task);
+}
+
+void runtime_locked_bench(uint64_t iterations) {
+	task_t task = {.conn = NULL};
+	for (uint64_t index = 0; index < iterations; index++) {
+		runtime_locked_push(&task);
+		runtime_locked_pop(&task);
+	}
+	bench_keep(&task);
+}
+
+void runtime_locked_burst_bench(uint64_t iterations) {
+	task_t task = {.conn = NULL};
+	for (uint64_t index = 0; index < iterations; index++) {
+		for (uint8_t burst = 0; burst < 16; burst++) {
+			runtime_locked_push(&task);
+		}
+		for (uint8_t burst = 0; burst < 16; burst++) {
+			runtime_locked_pop(&task);
+		}
+	}
+	bench_keep(&task);
+}
+
+void runtime_queue_contended_bench(uint64_t iterations) {
+	runtime_contend(&runtime_queue_produce, &runtime_queue_consume, iterations);
+}
+
+void runtime_locked_contended_bench(uint64_t iterations) {
+	runtime_contend(&runtime_locked_produce, &runtime_locked_consume, iterations);
+}
+
+void runtime_trace_bench(uint64_t iterations) {
+	for (uint64_t index = 0; index < iterations; index++) {
+		trace("disabled trace %" PRIu64 " of %u bytes\n", index, queue_len());
+	}
+}
+
+void runtime_trace_hex_bench(uint64_t iterations) {
+	for (uint64_t index = 0; index < iterations; index++) {
+		trace_hex("disabled trace", runtime_bytes, sizeof(runtime_bytes));
+	}
+}
+
+void runtime_metric_bench(uint64_t iterations) {
+	for (uint64_t index = 0; index < iterations; index++) {
+		shard_t *shard = metric_shard();
+		metric_count(&shard->requests[0], 1);
+		metric_observe(&shard->latency[0], index & 0xffff);
+	}
+}
+
+void runtime_clock_bench(uint64_t iterations) {
+	struct timespec now;
+	for (uint64_t index = 0; index < iterations; index++) {
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		bench_keep(&now);
+	}
+}
+
+int runtime_setup(void) {
+	if (queue_init() == -1) {
+		return -1;
+	}
+
+	runtime_locked.tasks = malloc(queue_size * sizeof(*runtime_locked.tasks));
+	if (runtime_locked.tasks == NULL) {
+		error("failed to allocate %zu bytes for tasks because %s\n", queue_size * sizeof(*runtime_locked.tasks), errno_str());
+		return -1;
+	}
+
+	atomic_store(&thread_pool.size, UINT8_MAX);
+
+	if (metrics_init() == -1) {
+		return -1;
+	}
+
+	return 0;
+}
+
+bench_t runtime_benches[] = {
+		{.name = "queue.push_pop", .bytes = 0, .function = &runtime_queue_bench},
+		{.name = "queue.burst.16", .bytes = 0, .function = &runtime_queue_burst_bench},
+		{.name = "queue.contended.4x4", .bytes = 0, .function = &runtime_queue_contended_bench},
+		{.name = "queue.locked.push_pop", .bytes = 0, .function = &runtime_locked_bench},
+		{.name = "queue.locked.burst.16", .bytes = 0, .function = &runtime_locked_burst_bench},
+		{.name = "queue.locked.contended.4x4", .bytes = 0, .function = &runtime_locked_contended_bench},
+		{.name = "trace.disabled", .bytes = 0, .function = &runtime_trace_bench},
+		{.name = "trace_hex.disabled", .bytes = 0, .function = &runtime_trace_hex_bench},
+		{.name = "metric.record", .bytes = 0, .function = &runtime_metric_bench},
+		{.name = "clock.monotonic", .bytes = 0, .function = &runtime_clock_bench},
+};
+
+const uint8_t runtime_benches_len = sizeof(runtime_benches) / sizeof(*runtime_benches);
@@ -0,0 +1,314 @@
+#include "../src/lib/error.h"
+#include "../src/lib/logger.h"
+#include "loadtest.h"
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+uint64_t loadtest_now(void) {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t)now.tv_sec * 1000000000 + (uint64_t)now.tv_nsec;
+}
+
+uint64_t client_random(client_t *client) {
+	client->seed ^= client->seed << 13;
+	client->seed ^= client->seed >> 7;
+	client->seed ^= client->seed << 17;
+	return client->seed;
+}
+
+uint16_t client_get(client_t *client, char *buffer, uint16_t buffer_cap, const char *pathname) {
+	(void)client;
+	int len = snprintf(buffer, buffer_cap, "GET %s HTTP/1.1\r\nhost:127.0.0.1\r\ncookie:%s\r\nconnection:keep-alive\r\n\r\n", pathname,
+										 loadtest.cookie);
+	return len < 0 || len >= buffer_cap ? 0 : (uint16_t)len;
+}
+
+uint16_t client_page(client_t *client, char *buffer, uint16_t buffer_cap) {
+	const char *pages[] = {"/", "/radios", "/devices", "/hosts"};
+	return client_get(client, buffer, buffer_cap, pages[client->turn % (sizeof(pages) / sizeof(*pages))]);
+}
+
+uint16_t client_radios(client_t *client, char *buffer, uint16_t buffer_cap) {
+	return client_get(client, buffer, buffer_cap, "/api/radios?order=device&sort=asc");
+}
+
+uint16_t client_devices(client_t *client, char *buffer, uint16_t buffer_cap) {
+	return client_get(client, buffer, buffer_cap, "/api/devices?order=tag&sort=asc");
+}
+
+uint16_t client_hosts(client_t *client, char *buffer, uint16_t buffer_cap) {
+	return client_get(client, buffer, buffer_cap, "/api/hosts?order=port&sort=asc");
+}
+
+uint16_t client_body(char *buffer, uint16_t buffer_cap, const char *method, const char *pathname, const char *body,
+										 uint16_t body_len) {
+	int len = snprintf(buffer, buffer_cap,
+										 "%s %s HTTP/1.1\r\nhost:127.0.0.1\r\ncookie:%s\r\nconnection:keep-alive\r\ncontent-length:%hu\r\n\r\n", method,
+										 pathname, loadtest.cookie, body_len);
+	if (len < 0 || len + body_len >= buffer_cap) {
+		return 0;
+	}
+	memcpy(&buffer[len], body, body_len);
+	return (uint16_t)(len + body_len);
+}
+
+uint16_t client_mutate(client_t *client, char *buffer, uint16_t buffer_cap) {
+	uint8_t host = (uint8_t)(client->turn % loadtest.hosts_len);
+	const char *id = loadtest.hosts[host];
+
+	char body[] = "127.0.0.1\0pp" "nexus\0.go4Nexus\0";
+	body[10] = (char)(loadtest.ports[host] >> 8);
+	body[11] = (char)(loadtest.ports[host] & 0xff);
+
+	char pathname[48];
+	snprintf(pathname, sizeof(pathname), "/api/host/%s", id);
+	return client_body(buffer, buffer_cap, "PATCH", pathname, body, sizeof(body) - 1);
+}
+
+uint16_t client_schedule(client_t *client, char *buffer, uint16_t buffer_cap) {
+	const char *id = loadtest.devices[client->turn % loadtest.devices_len];
+
+	char body[2 + 8 + 16];
+	body[0] = 0x00;
+	body[1] = 8;
+	memcpy(&body[2], "loadtest", 8);
+	for (uint8_t index = 0; index < 16; index++) {
+		unsigned int byte;
+		sscanf(&id[index * 2], "%2x", &byte);
+		body[10 + index] = (char)byte;
+	}
+
+	return client_body(buffer, buffer_cap, "POST", "/api/schedule", body, sizeof(body));
+}
+
+scenario_t scenarios[] = {
+		{.name = "page", .weight = 2, .build = &client_page},
+		{.name = "radios", .weight = 3, .build = &client_radios},
+		{.name = "devices", .weight = 3, .build = &client_devices},
+		{.name = "hosts", .weight = 3, .build = &client_hosts},
+		{.name = "mutate", .weight = 1, .build = &client_mutate},
+		{.name = "schedule", .weight = 0, .build = &client_schedule},
+};
+
+const uint8_t scenarios_len = sizeof(scenarios) / sizeof(*scenarios);
+
+int client_connect(void) {
+	int sock = socket(AF_INET, SOCK_STREAM, 0);
+	if (sock == -1) {
+		error("failed to create socket because %s\n", errno_str());
+		return -1;
+	}
+
+	int enable = 1;
+	setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+	struct timeval timeout = {.tv_sec = 10, .tv_usec = 0};
+	setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+	setsockopt(sock, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+	struct sockaddr_in addr = {.sin_family = AF_INET, .sin_port = htons(loadtest.port)};
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	if (connect(sock, (struct sockaddr *)&addr, sizeof(addr)) == -1) {
+		close(sock);
+		return -1;
+	}
+
+	return sock;
+}
+
+int client_exchange(int sock, const char *request, uint16_t request_len, char *buffer, size_t buffer_cap, uint16_t *status,
+										bool *closing, uint64_t *received_bytes) {
+	size_t sent = 0;
+	while (sent < request_len) {
+		ssize_t result = send(sock, &request[sent], request_len - sent, MSG_NOSIGNAL);
+		if (result <= 0) {
+			return -1;
+		}
+		sent += (size_t)result;
+	}
+
+	size_t len = 0;
+	char *end = NULL;
+	while (end == NULL) {
+		if (len + 1 >= buffer_cap) {
+			return -1;
+		}
+		ssize_t result = recv(sock, &buffer[len], buffer_cap - len - 1, 0);
+		if (result <= 0) {
+			return -1;
+		}
+		len += (size_t)result;
+		buffer[len] = '\0';
+		end = strstr(buffer, "\r\n\r\n");
+	}
+
+	if (len < 12 || memcmp(buffer, "HTTP/1.1 ", 9) != 0) {
+		return -1;
+	}
+	*status = (uint16_t)atoi(&buffer[9]);
+
+	size_t content_length = 0;
+	const char *length = strstr(buffer, "\r\ncontent-length:");
+	if (length != NULL && length < end) {
+		content_length = strtoul(&length[17], NULL, 10);
+	}
+
+	const char *connection = strstr(buffer, "\r\nconnection:close");
+	*closing = connection != NULL && connection < end;
+
+	size_t head_len = (size_t)(end - buffer) + 4;
+	size_t body_len = len - head_len;
+	while (body_len < content_length) {
+		size_t offset = head_len + body_len + 1 < buffer_cap ? head_len + body_len : head_len;
+		size_t room = buffer_cap - offset - 1;
+		size_t want = content_length - body_len;
+		ssize_t result = recv(sock, &buffer[offset], want < room ? want : room, 0);
+		if (result <= 0) {
+			return -1;
+		}
+		body_len += (size_t)result;
+		buffer[offset + (size_t)result] = '\0';
+	}
+
+	*received_bytes += head_len + body_len;
+	return 0;
+}
+
+uint8_t client_pick(client_t *client, uint16_t weights) {
+	uint16_t pick = (uint16_t)(client_random(client) % weights);
+	for (uint8_t index = 0; index < scenarios_len; index++) {
+		if (pick < scenarios[index].weight) {
+			return index;
+		}
+		pick -= scenarios[index].weight;
+	}
+	return 0;
+}
+
+int client_record(samples_t *samples, uint64_t elapsed) {
+	if (samples->len >= samples->cap) {
+		uint32_t cap = samples->cap == 0 ? 4096 : samples->cap * 2;
+		uint32_t *ptr = realloc(samples->ptr, cap * sizeof(*ptr));
+		if (ptr == NULL) {
+			error("failed to allocate %zu bytes for samples because %s\n", cap * sizeof(*ptr), errno_str());
+			return -1;
+		}
+		samples->ptr = ptr;
+		samples->cap = cap;
+	}
+
+	samples->ptr[samples->len] = elapsed > UINT32_MAX ? UINT32_MAX : (uint32_t)elapsed;
+	samples->len++;
+	return 0;
+}
+
+void *client_thread(void *args) {
+	client_t *client = args;
+	client->sock = -1;
+
+	uint16_t weights = 0;
+	for (uint8_t index = 0; index < scenarios_len; index++) {
+		weights += scenarios[index].weight;
+	}
+
+	char request[512];
+	while (!atomic_load_explicit(&loadtest.stopping, memory_order_relaxed)) {
+		if (client->sock == -1) {
+			client->sock = client_connect();
+			if (client->sock == -1) {
+				client->broken++;
+				nanosleep(&(struct timespec){.tv_sec = 0, .tv_nsec = 1000000}, NULL);
+				continue;
+			}
+			client->reconnects++;
+		}
+
+		uint8_t scenario = client_pick(client, weights);
+		uint16_t request_len = scenarios[scenario].build(client, request, sizeof(request));
+		client->turn++;
+
+		uint16_t status = 0;
+		bool closing = false;
+		uint64_t start = loadtest_now();
+		int result = client_exchange(client->sock, request, request_len, client->buffer, sizeof(client->buffer), &status, &closing,
+																 &client->received_bytes);
+		uint64_t elapsed = loadtest_now() - start;
+
+		if (result == -1) {
+			client->broken++;
+			closing = true;
+		} else if (atomic_load_explicit(&loadtest.recording, memory_order_relaxed)) {
+			if (status >= 400 && status <= 499) {
+				client->clients_failed[scenario]++;
+			}
+			if (status >= 500 && status <= 599) {
+				client->servers_failed[scenario]++;
+			}
+			if (client_record(&client->samples[scenario], elapsed) == -1) {
+				break;
+			}
+		}
+
+		if (closing == true) {
+			close(client->sock);
+			client->sock = -1;
+		}
+	}
+
+	if (client->sock != -1) {
+		close(client->sock);
+	}
+	return NULL;
+}
+
+void *subscriber_thread(void *args) {
+	subscriber_t *subscriber = args;
+
+	subscriber->sock = client_connect();
+	if (subscriber->sock == -1) {
+		return NULL;
+	}
+
+	char request[256];
+	int request_len = snprintf(request, sizeof(request), "GET /api/transmissions/sse HTTP/1.1\r\nhost:127.0.0.1\r\ncookie:%s\r\n\r\n",
+														 loadtest.cookie);
+
+	uint64_t start = loadtest_now();
+	if (send(subscriber->sock, request, (size_t)request_len, MSG_NOSIGNAL) != request_len) {
+		goto cleanup;
+	}
+
+	char buffer[4096];
+	while (!atomic_load_explicit(&loadtest.stopping, memory_order_relaxed)) {
+		struct pollfd pollfd = {.fd = subscriber->sock, .events = POLLIN};
+		if (poll(&pollfd, 1, 100) <= 0) {
+			continue;
+		}
+
+		ssize_t result = recv(subscriber->sock, buffer, sizeof(buffer), 0);
+		if (result <= 0) {
+			break;
+		}
+		if (subscriber->connected == false) {
+			subscriber->latency = (uint32_t)(loadtest_now() - start);
+			subscriber->connected = memcmp(buffer, "HTTP/1.1 200", 12) == 0;
+			if (subscriber->connected == false) {
+				break;
+			}
+		}
+		subscriber->received_bytes += (uint64_t)result;
+	}
+
+cleanup:
+	close(subscriber->sock);
+	return NULL;
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+typedef struct samples_t {
+	uint32_t *ptr;
+	uint32_t len;
+	uint32_t cap;
+} samples_t;
+
+typedef struct client_t client_t;
+
+typedef struct scenario_t {
+	const char *name;
+	uint8_t weight;
+	uint16_t (*build)(client_t *client, char *buffer, uint16_t buffer_cap);
+} scenario_t;
+
+struct client_t {
+	uint16_t id;
+	pthread_t thread;
+	int sock;
+	uint64_t seed;
+	uint32_t turn;
+	samples_t samples[6];
+	uint64_t clients_failed[6];
+	uint64_t servers_failed[6];
+	uint64_t broken;
+	uint64_t reconnects;
+	uint64_t received_bytes;
+	char buffer[65536];
+};
+
+typedef struct subscriber_t {
+	uint16_t id;
+	pthread_t thread;
+	int sock;
+	bool connected;
+	uint32_t latency;
+	uint64_t received_bytes;
+} subscriber_t;
+
+typedef struct loadtest_t {
+	const char *nexus;
+	uint16_t port;
+	char directory[64];
+	char database[96];
+	char log[96];
+	pid_t pid;
+	char cookie[128];
+	uint8_t cookie_len;
+	char hosts[8][33];
+	uint16_t ports[8];
+	uint8_t hosts_len;
+	char devices[8][33];
+	uint8_t devices_len;
+	uint8_t radios;
+	bool interrupts;
+	uint16_t upstream_port;
+	int upstream_sock;
+	pthread_t upstream;
+	atomic_bool upstreaming;
+	atomic_uint_fast64_t uplinks;
+	atomic_uint_fast64_t downlinks;
+	uint64_t receives;
+	uint64_t transmits;
+	atomic_bool recording;
+	atomic_bool stopping;
+} loadtest_t;
+
+extern struct loadtest_t loadtest;
+
+extern scenario_t scenarios[];
+extern const uint8_t scenarios_len;
+
+int server_prepare(void);
+int server_start(char **args, uint8_t args_len);
+int server_signin(void);
+int server_metric(const char *name, uint64_t *value);
+int server_stop(void);
+void server_clean(void);
+
+int upstream_start(void);
+void upstream_stop(void);
+
+int client_connect(void);
+int client_exchange(int sock, const char *request, uint16_t request_len, char *buffer, size_t buffer_cap, uint16_t *status,
+										bool *closing, uint64_t *received_bytes);
+void *client_thread(void *args);
+void *subscriber_thread(void *args);
+
+uint64_t loadtest_now(void);
+int loadtest_mix(const char *mix);
+void loadtest_report(client_t *clients, uint16_t clients_len, subscriber_t *subscribers, uint16_t subscribers_len,
+										 uint16_t seconds);
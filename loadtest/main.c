@@ -0,0 +1,182 @@
+#include "../src/lib/config.h"
+#include "../src/lib/error.h"
+#include "../src/lib/format.h"
+#include "../src/lib/logger.h"
+#include "loadtest.h"
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+int main(int argc, char *argv[]) {
+	logger_init();
+	log_level = 3;
+
+	uint16_t clients_len = 32;
+	uint16_t subscribers_len = 8;
+	uint16_t seconds = 10;
+	uint16_t warmup = 2;
+	const char *mix = NULL;
+
+	char **args = NULL;
+	uint8_t args_len = 0;
+
+	int errors = 0;
+	for (int ind = 1; ind < argc; ind++) {
+		const char *flag = argv[ind];
+		if (strcmp(flag, "--") == 0) {
+			args = &argv[ind + 1];
+			args_len = (uint8_t)(argc - ind - 1 > 32 ? 32 : argc - ind - 1);
+			break;
+		} else if (match_arg(flag, "--help", "-h")) {
+			printf("available command line flags\n");
+			printf("--clients           -c   concurrent keep alive clients    (%hu)\n", clients_len);
+			printf("--subscribers       -s   concurrent event subscribers     (%hu)\n", subscribers_len);
+			printf("--duration          -d   seconds of recorded load         (%hu)\n", seconds);
+			printf("--warmup            -w   seconds of unrecorded load       (%hu)\n", warmup);
+			printf("--mix               -m   scenario weights as name:weight  (");
+			for (uint8_t index = 0; index < scenarios_len; index++) {
+				printf("%s%s:%hhu", index == 0 ? "" : ",", scenarios[index].name, scenarios[index].weight);
+			}
+			printf(")\n");
+			printf("--radios            -r   simulated radios to receive from (%hhu)\n", loadtest.radios);
+			printf("--interrupts        -i   simulated radios signal dio0     (%s)\n", human_bool(loadtest.interrupts));
+			printf("--port              -p   loopback port for nexus          (%hu)\n", loadtest.port);
+			printf("--nexus             -n   path to nexus binary             (%s)\n", loadtest.nexus);
+			printf("--log-level         -ll  logging verbosity to print       (%s)\n", human_log_level(log_level));
+			printf("--                       pass remaining flags to nexus\n");
+			exit(0);
+		} else if (match_arg(flag, "--clients", "-c")) {
+			errors += parse_uint16(next_arg(argc, argv, &ind), "clients", 0, 1024, &clients_len);
+		} else if (match_arg(flag, "--subscribers", "-s")) {
+			errors += parse_uint16(next_arg(argc, argv, &ind), "subscribers", 0, 255, &subscribers_len);
+		} else if (match_arg(flag, "--duration", "-d")) {
+			errors += parse_uint16(next_arg(argc, argv, &ind), "duration", 1, 3600, &seconds);
+		} else if (match_arg(flag, "--warmup", "-w")) {
+			errors += parse_uint16(next_arg(argc, argv, &ind), "warmup", 0, 600, &warmup);
+		} else if (match_arg(flag, "--mix", "-m")) {
+			errors += parse_str(next_arg(argc, argv, &ind), "mix", 3, 255, &mix);
+		} else if (match_arg(flag, "--radios", "-r")) {
+			errors += parse_uint8(next_arg(argc, argv, &ind), "radios", 0, 32, &loadtest.radios);
+		} else if (match_arg(flag, "--interrupts", "-i")) {
+			errors += parse_bool(next_arg(argc, argv, &ind), "interrupts", &loadtest.interrupts);
+		} else if (match_arg(flag, "--port", "-p")) {
+			errors += parse_uint16(next_arg(argc, argv, &ind), "port", 1, 65534, &loadtest.port);
+		} else if (match_arg(flag, "--nexus", "-n")) {
+			errors += parse_str(next_arg(argc, argv, &ind), "nexus", 1, 255, &loadtest.nexus);
+		} else if (match_arg(flag, "--log-level", "-ll")) {
+			errors += parse_log_level(next_arg(argc, argv, &ind), &log_level);
+		} else {
+			error("unknown argument %s\n", flag);
+			errors++;
+		}
+	}
+
+	if (mix != NULL && loadtest_mix(mix) == -1) {
+		errors++;
+	}
+
+	if (errors != 0) {
+		fatal("config contains %d errors\n", errors);
+		exit(1);
+	}
+
+	if (access(loadtest.nexus, X_OK) == -1) {
+		fatal("cannot execute %s because %s\n", loadtest.nexus, errno_str());
+		exit(1);
+	}
+
+	client_t *clients = calloc(clients_len == 0 ? 1 : clients_len, sizeof(*clients));
+	subscriber_t *subscribers = calloc(subscribers_len == 0 ? 1 : subscribers_len, sizeof(*subscribers));
+	if (clients == NULL || subscribers == NULL) {
+		fatal("failed to allocate clients because %s\n", errno_str());
+		exit(1);
+	}
+
+	loadtest.upstream_port = loadtest.port + 1;
+	if (loadtest.radios != 0 && upstream_start() == -1) {
+		exit(1);
+	}
+
+	if (server_prepare() == -1 || server_start(args, args_len) == -1 || server_signin() == -1) {
+		server_stop();
+		upstream_stop();
+		exit(1);
+	}
+
+	printf("nexus on 127.0.0.1:%hu with %hu clients %hu subscribers %hhu radios for %hus after %hus warmup", loadtest.port,
+				 clients_len, subscribers_len, loadtest.radios, seconds, warmup);
+	for (uint8_t index = 0; index < args_len; index++) {
+		printf(" %s", args[index]);
+	}
+	printf("\n\n");
+	fflush(stdout);
+
+	uint16_t subscribers_spawned = 0;
+	for (uint16_t index = 0; index < subscribers_len; index++) {
+		subscribers[index].id = index;
+		if ((errno = pthread_create(&subscribers[index].thread, NULL, &subscriber_thread, &subscribers[index])) != 0) {
+			error("failed to spawn subscriber thread because %s\n", errno_str());
+			break;
+		}
+		subscribers_spawned++;
+	}
+
+	uint16_t clients_spawned = 0;
+	for (uint16_t index = 0; index < clients_len; index++) {
+		clients[index].id = index;
+		clients[index].seed = 0x9e3779b97f4a7c15ull * (index + 1);
+		if ((errno = pthread_create(&clients[index].thread, NULL, &client_thread, &clients[index])) != 0) {
+			error("failed to spawn client thread because %s\n", errno_str());
+			break;
+		}
+		clients_spawned++;
+	}
+
+	sleep(warmup);
+	uint64_t receives = 0;
+	uint64_t transmits = 0;
+	if (loadtest.radios != 0) {
+		server_metric("nexus_radio_receives_total", &receives);
+		server_metric("nexus_radio_transmits_total", &transmits);
+	}
+	atomic_store(&loadtest.recording, true);
+	sleep(seconds);
+	atomic_store(&loadtest.recording, false);
+	if (loadtest.radios != 0) {
+		server_metric("nexus_radio_receives_total", &loadtest.receives);
+		server_metric("nexus_radio_transmits_total", &loadtest.transmits);
+		loadtest.receives -= receives < loadtest.receives ? receives : loadtest.receives;
+		loadtest.transmits -= transmits < loadtest.transmits ? transmits : loadtest.transmits;
+	}
+	atomic_store(&loadtest.stopping, true);
+
+	for (uint16_t index = 0; index < clients_spawned; index++) {
+		pthread_join(clients[index].thread, NULL);
+	}
+	for (uint16_t index = 0; index < subscribers_spawned; index++) {
+		pthread_join(subscribers[index].thread, NULL);
+	}
+
+	loadtest_report(clients, clients_spawned, subscribers, subscribers_spawned, seconds);
+
+	fflush(stdout);
+	int stopped = server_stop();
+	upstream_stop();
+	if (stopped == 0) {
+		server_clean();
+	}
+
+	for (uint16_t index = 0; index < clients_len; index++) {
+		for (uint8_t scenario = 0; scenario < scenarios_len; scenario++) {
+			free(clients[index].samples[scenario].ptr);
+		}
+	}
+	free(clients);
+	free(subscribers);
+
+	return 0;
+}
@@ -0,0 +1,194 @@
+#include "../src/lib/error.h"
+#include "../src/lib/logger.h"
+#include "loadtest.h"
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+int loadtest_mix(const char *mix) {
+	for (uint8_t index = 0; index < scenarios_len; index++) {
+		scenarios[index].weight = 0;
+	}
+
+	const char *entry = mix;
+	while (*entry != '\0') {
+		size_t entry_len = strcspn(entry, ",");
+		const char *colon = memchr(entry, ':', entry_len);
+		if (colon == NULL) {
+			error("mix entry %.*s is missing a weight\n", (int)entry_len, entry);
+			return -1;
+		}
+
+		size_t name_len = (size_t)(colon - entry);
+		uint8_t scenario = 0;
+		while (scenario < scenarios_len &&
+					 (strlen(scenarios[scenario].name) != name_len || memcmp(scenarios[scenario].name, entry, name_len) != 0)) {
+			scenario++;
+		}
+		if (scenario == scenarios_len) {
+			error("mix entry %.*s names an unknown scenario\n", (int)name_len, entry);
+			return -1;
+		}
+
+		char *weight_end;
+		unsigned long weight = strtoul(colon + 1, &weight_end, 10);
+		if (weight_end != entry + entry_len || weight > 100) {
+			error("mix weight for %s must be between 0 and 100\n", scenarios[scenario].name);
+			return -1;
+		}
+		scenarios[scenario].weight = (uint8_t)weight;
+
+		entry += entry_len;
+		if (*entry == ',') {
+			entry++;
+		}
+	}
+
+	uint16_t weights = 0;
+	for (uint8_t index = 0; index < scenarios_len; index++) {
+		weights += scenarios[index].weight;
+	}
+	if (weights == 0) {
+		error("mix must give at least one scenario a weight\n");
+		return -1;
+	}
+
+	return 0;
+}
+
+int loadtest_order(const void *left, const void *right) {
+	uint32_t lhs = *(const uint32_t *)left;
+	uint32_t rhs = *(const uint32_t *)right;
+	return (lhs > rhs) - (lhs < rhs);
+}
+
+double loadtest_percentile(samples_t *samples, uint16_t permille) {
+	if (samples->len == 0) {
+		return 0;
+	}
+	uint64_t rank = ((uint64_t)samples->len * permille + 999) / 1000;
+	return (double)samples->ptr[rank == 0 ? 0 : rank - 1] / 1000;
+}
+
+int loadtest_merge(client_t *clients, uint16_t clients_len, uint8_t scenario, samples_t *merged) {
+	merged->len = 0;
+	for (uint16_t index = 0; index < clients_len; index++) {
+		merged->len += clients[index].samples[scenario].len;
+	}
+
+	merged->cap = merged->len;
+	merged->ptr = malloc((merged->len == 0 ? 1 : merged->len) * sizeof(*merged->ptr));
+	if (merged->ptr == NULL) {
+		error("failed to allocate %zu bytes for samples because %s\n", merged->len * sizeof(*merged->ptr), errno_str());
+		return -1;
+	}
+
+	uint32_t offset = 0;
+	for (uint16_t index = 0; index < clients_len; index++) {
+		samples_t *samples = &clients[index].samples[scenario];
+		memcpy(&merged->ptr[offset], samples->ptr, samples->len * sizeof(*samples->ptr));
+		offset += samples->len;
+	}
+
+	qsort(merged->ptr, merged->len, sizeof(*merged->ptr), &loadtest_order);
+	return 0;
+}
+
+void loadtest_row(const char *name, samples_t *samples, uint64_t clients_failed, uint64_t servers_failed, uint16_t seconds) {
+	printf("%-10s %10u %8" PRIu64 " %8" PRIu64 " %10.1f %10.1f %10.1f %10.1f %10.1f\n", name, samples->len, clients_failed,
+				 servers_failed, (double)samples->len / seconds,
+				 loadtest_percentile(samples, 500), loadtest_percentile(samples, 990), loadtest_percentile(samples, 999),
+				 loadtest_percentile(samples, 1000));
+}
+
+void loadtest_report(client_t *clients, uint16_t clients_len, subscriber_t *subscribers, uint16_t subscribers_len,
+										 uint16_t seconds) {
+	printf("%-10s %10s %8s %8s %10s %10s %10s %10s %10s\n", "scenario", "requests", "4xx", "5xx", "rps", "p50 us", "p99 us",
+				 "p999 us", "max us");
+
+	samples_t total = {.ptr = NULL, .len = 0, .cap = 0};
+	uint64_t total_clients_failed = 0;
+	uint64_t total_servers_failed = 0;
+	for (uint8_t scenario = 0; scenario < scenarios_len; scenario++) {
+		samples_t merged;
+		if (loadtest_merge(clients, clients_len, scenario, &merged) == -1) {
+			free(total.ptr);
+			return;
+		}
+
+		uint64_t clients_failed = 0;
+		uint64_t servers_failed = 0;
+		for (uint16_t index = 0; index < clients_len; index++) {
+			clients_failed += clients[index].clients_failed[scenario];
+			servers_failed += clients[index].servers_failed[scenario];
+		}
+
+		if (merged.len != 0) {
+			loadtest_row(scenarios[scenario].name, &merged, clients_failed, servers_failed, seconds);
+		}
+
+		uint32_t *grown = realloc(total.ptr, (total.len + merged.len + 1) * sizeof(*grown));
+		if (grown == NULL) {
+			error("failed to allocate %zu bytes for samples because %s\n", (total.len + merged.len + 1) * sizeof(*grown), errno_str());
+			free(merged.ptr);
+			free(total.ptr);
+			return;
+		}
+		total.ptr = grown;
+		memcpy(&total.ptr[total.len], merged.ptr, merged.len * sizeof(*merged.ptr));
+		total.len += merged.len;
+		total_clients_failed += clients_failed;
+		total_servers_failed += servers_failed;
+		free(merged.ptr);
+	}
+
+	qsort(total.ptr, total.len, sizeof(*total.ptr), &loadtest_order);
+	loadtest_row("total", &total, total_clients_failed, total_servers_failed, seconds);
+	free(total.ptr);
+
+	uint64_t broken = 0;
+	uint64_t reconnects = 0;
+	uint64_t received_bytes = 0;
+	for (uint16_t index = 0; index < clients_len; index++) {
+		broken += clients[index].broken;
+		reconnects += clients[index].reconnects;
+		received_bytes += clients[index].received_bytes;
+	}
+	printf("\n");
+	if (clients_len != 0) {
+		printf("%hu clients opened %" PRIu64 " connections with %" PRIu64 " broken exchanges and received %.1f mb\n", clients_len,
+					 reconnects, broken, (double)received_bytes / 1000000);
+	}
+
+	if (loadtest.radios != 0) {
+		printf("%hhu simulated radios received %" PRIu64 " packets at %.1f per second and transmitted %" PRIu64 " replies\n",
+					 loadtest.radios, loadtest.receives, (double)loadtest.receives / seconds, loadtest.transmits);
+		printf("upstream accepted %" PRIu64 " uplinks and %" PRIu64 " downlinks\n", atomic_load(&loadtest.uplinks),
+					 atomic_load(&loadtest.downlinks));
+	}
+
+	if (subscribers_len == 0) {
+		return;
+	}
+
+	samples_t latencies = {.ptr = malloc(subscribers_len * sizeof(uint32_t)), .len = 0, .cap = subscribers_len};
+	if (latencies.ptr == NULL) {
+		error("failed to allocate %zu bytes for samples because %s\n", subscribers_len * sizeof(uint32_t), errno_str());
+		return;
+	}
+
+	uint64_t streamed_bytes = 0;
+	for (uint16_t index = 0; index < subscribers_len; index++) {
+		if (subscribers[index].connected == true) {
+			latencies.ptr[latencies.len++] = subscribers[index].latency;
+		}
+		streamed_bytes += subscribers[index].received_bytes;
+	}
+	qsort(latencies.ptr, latencies.len, sizeof(*latencies.ptr), &loadtest_order);
+
+	printf("%hu of %hu subscribers streaming with p50 %.1f us p99 %.1f us to subscribe and %" PRIu64 " bytes streamed\n",
+				 (uint16_t)latencies.len, subscribers_len, loadtest_percentile(&latencies, 500), loadtest_percentile(&latencies, 990),
+				 streamed_bytes);
+	free(latencies.ptr);
+}
@@ -0,0 +1,317 @@
+#include "../src/lib/error.h"
+#include "../src/lib/logger.h"
+#include "loadtest.h"
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sqlite3.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+loadtest_t loadtest = {.nexus = "./nexus", .port = 2255, .pid = -1, .upstream_sock = -1};
+
+pid_t server_spawn(char **argv, bool logged) {
+	pid_t pid = fork();
+	if (pid == -1) {
+		error("failed to fork because %s\n", errno_str());
+		return -1;
+	}
+
+	if (pid == 0) {
+		int fd = open(logged == true ? loadtest.log : "/dev/null", O_WRONLY | O_CREAT | O_APPEND, 0600);
+		if (fd != -1) {
+			dup2(fd, STDOUT_FILENO);
+			dup2(fd, STDERR_FILENO);
+			close(fd);
+		}
+		execv(argv[0], argv);
+		_exit(127);
+	}
+
+	return pid;
+}
+
+int server_fixtures(sqlite3 *database, const char *sql, char (*ids)[8][33], uint16_t (*ports)[8], uint8_t *ids_len) {
+	int status = 0;
+
+	sqlite3_stmt *stmt;
+	if (sqlite3_prepare_v2(database, sql, -1, &stmt, NULL) != SQLITE_OK) {
+		error("failed to prepare statement because %s\n", sqlite3_errmsg(database));
+		return -1;
+	}
+
+	*ids_len = 0;
+	int result;
+	while ((result = sqlite3_step(stmt)) == SQLITE_ROW && *ids_len < sizeof(*ids) / sizeof(**ids)) {
+		const unsigned char *id = sqlite3_column_text(stmt, 0);
+		if (id == NULL || strlen((const char *)id) != 32) {
+			error("fixture id has unexpected length\n");
+			status = -1;
+			goto cleanup;
+		}
+		memcpy((*ids)[*ids_len], id, 33);
+		if (ports != NULL) {
+			(*ports)[*ids_len] = (uint16_t)sqlite3_column_int(stmt, 1);
+		}
+		(*ids_len)++;
+	}
+
+	if (result != SQLITE_ROW && result != SQLITE_DONE) {
+		error("failed to execute statement because %s\n", sqlite3_errmsg(database));
+		status = -1;
+	}
+
+cleanup:
+	sqlite3_finalize(stmt);
+	return status;
+}
+
+int server_prepare(void) {
+	strcpy(loadtest.directory, "/tmp/nexus-loadtest-XXXXXX");
+	if (mkdtemp(loadtest.directory) == NULL) {
+		error("failed to create temporary directory because %s\n", errno_str());
+		return -1;
+	}
+	snprintf(loadtest.database, sizeof(loadtest.database), "%s/nexus.sqlite", loadtest.directory);
+	snprintf(loadtest.log, sizeof(loadtest.log), "%s/nexus.log", loadtest.directory);
+
+	char *argv[] = {(char *)loadtest.nexus, "--database-file", loadtest.database, "--init", "--seed", NULL};
+	pid_t pid = server_spawn(argv, true);
+	if (pid == -1) {
+		return -1;
+	}
+
+	int status;
+	if (waitpid(pid, &status, 0) == -1 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+		error("failed to initialise and seed %s see %s\n", loadtest.database, loadtest.log);
+		return -1;
+	}
+
+	sqlite3 *database;
+	if (sqlite3_open_v2(loadtest.database, &database, SQLITE_OPEN_READWRITE, NULL) != SQLITE_OK) {
+		error("failed to open %s because %s\n", loadtest.database, sqlite3_errmsg(database));
+		sqlite3_close_v2(database);
+		return -1;
+	}
+
+	int result = 0;
+	if (sqlite3_exec(database, "delete from radio", NULL, NULL, NULL) != SQLITE_OK) {
+		error("failed to remove seeded radios because %s\n", sqlite3_errmsg(database));
+		result = -1;
+	}
+	for (uint8_t index = 0; result == 0 && index < loadtest.radios; index++) {
+		char sql[192];
+		snprintf(sql, sizeof(sql),
+						 "insert into radio values (randomblob(16), 'sim%hhu%s', %u, 125000, 7, 5, 2, 8, 18, true)", index,
+						 loadtest.interrupts == true ? "@sim" : "", 433000000 + index * 200000);
+		if (sqlite3_exec(database, sql, NULL, NULL, NULL) != SQLITE_OK) {
+			error("failed to insert simulated radio because %s\n", sqlite3_errmsg(database));
+			result = -1;
+		}
+	}
+	if (result == 0 && loadtest.radios != 0) {
+		char sql[64];
+		snprintf(sql, sizeof(sql), "update host set address = '127.0.0.1', port = %hu", loadtest.upstream_port);
+		if (sqlite3_exec(database, sql, NULL, NULL, NULL) != SQLITE_OK) {
+			error("failed to point hosts upstream because %s\n", sqlite3_errmsg(database));
+			result = -1;
+		}
+	}
+	if (result == 0) {
+		result = server_fixtures(database, "select lower(hex(id)), port from host", &loadtest.hosts, &loadtest.ports,
+															&loadtest.hosts_len);
+	}
+	if (result == 0) {
+		result = server_fixtures(database, "select lower(hex(id)) from device", &loadtest.devices, NULL, &loadtest.devices_len);
+	}
+
+	sqlite3_close_v2(database);
+
+	if (result == 0 && (loadtest.hosts_len == 0 || loadtest.devices_len == 0)) {
+		error("seeded database has %hhu hosts and %hhu devices\n", loadtest.hosts_len, loadtest.devices_len);
+		return -1;
+	}
+
+	return result;
+}
+
+int server_start(char **args, uint8_t args_len) {
+	int sock = client_connect();
+	if (sock != -1) {
+		close(sock);
+		error("port %hu is already in use\n", loadtest.port);
+		return -1;
+	}
+
+	char port[8];
+	snprintf(port, sizeof(port), "%hu", loadtest.port);
+
+	char *argv[48] = {
+			(char *)loadtest.nexus, "--database-file", loadtest.database, "--port", port, "--address", "127.0.0.1",
+			"--log-level", "warn", "--log-requests", "false", "--log-responses", "false",
+	};
+	uint8_t argv_len = 13;
+	for (uint8_t index = 0; index < args_len && (size_t)argv_len + 1 < sizeof(argv) / sizeof(*argv); index++) {
+		argv[argv_len++] = args[index];
+	}
+	argv[argv_len] = NULL;
+
+	loadtest.pid = server_spawn(argv, true);
+	if (loadtest.pid == -1) {
+		return -1;
+	}
+
+	for (uint8_t attempt = 0; attempt < 100; attempt++) {
+		int status;
+		if (waitpid(loadtest.pid, &status, WNOHANG) == loadtest.pid) {
+			error("nexus exited during startup see %s\n", loadtest.log);
+			loadtest.pid = -1;
+			return -1;
+		}
+
+		sock = client_connect();
+		if (sock != -1) {
+			close(sock);
+			return 0;
+		}
+
+		nanosleep(&(struct timespec){.tv_sec = 0, .tv_nsec = 50000000}, NULL);
+	}
+
+	error("nexus did not accept connections on port %hu see %s\n", loadtest.port, loadtest.log);
+	return -1;
+}
+
+int server_signin(void) {
+	const char body[] = "alice\0.go4Alice\0";
+	char request[256];
+	int request_len = snprintf(request, sizeof(request), "POST /api/signin HTTP/1.1\r\ncontent-length:%zu\r\n\r\n", sizeof(body) - 1);
+	memcpy(&request[request_len], body, sizeof(body) - 1);
+	request_len += (int)sizeof(body) - 1;
+
+	int sock = client_connect();
+	if (sock == -1) {
+		return -1;
+	}
+
+	char buffer[4096];
+	uint16_t status = 0;
+	bool closing;
+	uint64_t received_bytes = 0;
+	int result = client_exchange(sock, request, (uint16_t)request_len, buffer, sizeof(buffer), &status, &closing, &received_bytes);
+	close(sock);
+
+	if (result == -1 || status != 201) {
+		error("failed to sign in with status %hu\n", status);
+		return -1;
+	}
+
+	const char *cookie = strstr(buffer, "set-cookie:auth=");
+	if (cookie == NULL) {
+		error("sign in response did not set an auth cookie\n");
+		return -1;
+	}
+	cookie += strlen("set-cookie:");
+
+	uint8_t cookie_len = 0;
+	while (cookie[cookie_len] != ';' && cookie[cookie_len] != '\r' && (size_t)cookie_len + 1 < sizeof(loadtest.cookie)) {
+		cookie_len++;
+	}
+	memcpy(loadtest.cookie, cookie, cookie_len);
+	loadtest.cookie[cookie_len] = '\0';
+	loadtest.cookie_len = cookie_len;
+
+	return 0;
+}
+
+int server_metric(const char *name, uint64_t *value) {
+	char request[256];
+	int request_len = snprintf(request, sizeof(request), "GET /api/metrics HTTP/1.1\r\ncookie:%s\r\n\r\n", loadtest.cookie);
+
+	int sock = client_connect();
+	if (sock == -1) {
+		return -1;
+	}
+
+	char *buffer = malloc(262144);
+	if (buffer == NULL) {
+		error("failed to allocate %d bytes for metrics because %s\n", 262144, errno_str());
+		close(sock);
+		return -1;
+	}
+
+	uint16_t status = 0;
+	bool closing;
+	uint64_t received_bytes = 0;
+	int result = client_exchange(sock, request, (uint16_t)request_len, buffer, 262144, &status, &closing, &received_bytes);
+	close(sock);
+
+	if (result == -1 || status != 200) {
+		error("failed to fetch metrics with status %hu\n", status);
+		free(buffer);
+		return -1;
+	}
+
+	char key[64];
+	snprintf(key, sizeof(key), "\n%s ", name);
+	const char *line = strstr(buffer, key);
+	if (line == NULL) {
+		error("metrics did not contain %s\n", name);
+		free(buffer);
+		return -1;
+	}
+
+	*value = strtoull(&line[strlen(key)], NULL, 10);
+	free(buffer);
+	return 0;
+}
+
+int server_stop(void) {
+	if (loadtest.pid == -1) {
+		return 0;
+	}
+
+	kill(loadtest.pid, SIGINT);
+	for (uint8_t attempt = 0; attempt < 100; attempt++) {
+		int status;
+		if (waitpid(loadtest.pid, &status, WNOHANG) == loadtest.pid) {
+			if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+				warn("nexus exited abnormally see %s\n", loadtest.log);
+				loadtest.pid = -1;
+				return -1;
+			}
+			loadtest.pid = -1;
+			return 0;
+		}
+		nanosleep(&(struct timespec){.tv_sec = 0, .tv_nsec = 50000000}, NULL);
+	}
+
+	warn("nexus did not stop in time and was killed\n");
+	kill(loadtest.pid, SIGKILL);
+	waitpid(loadtest.pid, NULL, 0);
+	loadtest.pid = -1;
+	return -1;
+}
+
+void server_clean(void) {
+	if (loadtest.directory[0] == '\0') {
+		return;
+	}
+
+	const char *suffixes[] = {"", "-wal", "-shm", "-journal"};
+	for (uint8_t index = 0; index < sizeof(suffixes) / sizeof(*suffixes); index++) {
+		char path[128];
+		snprintf(path, sizeof(path), "%s%s", loadtest.database, suffixes[index]);
+		unlink(path);
+	}
+	unlink(loadtest.log);
+
+	if (rmdir(loadtest.directory) == -1) {
+		warn("failed to remove %s because %s\n", loadtest.directory, errno_str());
+	}
+}
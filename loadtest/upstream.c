@@ -0,0 +1,100 @@
+#include "../src/lib/error.h"
+#include "../src/lib/logger.h"
+#include "loadtest.h"
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+void upstream_answer(int sock) {
+	char buffer[2048];
+	ssize_t len = recv(sock, buffer, sizeof(buffer) - 1, 0);
+	if (len <= 0) {
+		return;
+	}
+	buffer[len] = '\0';
+
+	const char *response = "HTTP/1.1 201 Created\r\ncontent-length:0\r\n\r\n";
+	if (strncmp(buffer, "POST /api/signin ", 17) == 0) {
+		response = "HTTP/1.1 201 Created\r\nset-cookie:auth=loadtest; path=/\r\ncontent-length:0\r\n\r\n";
+	} else if (strncmp(buffer, "POST /api/uplink ", 17) == 0) {
+		if (atomic_load_explicit(&loadtest.recording, memory_order_relaxed)) {
+			atomic_fetch_add_explicit(&loadtest.uplinks, 1, memory_order_relaxed);
+		}
+	} else if (strncmp(buffer, "POST /api/downlink ", 19) == 0) {
+		if (atomic_load_explicit(&loadtest.recording, memory_order_relaxed)) {
+			atomic_fetch_add_explicit(&loadtest.downlinks, 1, memory_order_relaxed);
+		}
+	} else {
+		response = "HTTP/1.1 404 Not Found\r\ncontent-length:0\r\n\r\n";
+	}
+
+	send(sock, response, strlen(response), MSG_NOSIGNAL);
+}
+
+void *upstream_thread(void *args) {
+	(void)args;
+
+	while (atomic_load_explicit(&loadtest.upstreaming, memory_order_relaxed)) {
+		struct pollfd pollfd = {.fd = loadtest.upstream_sock, .events = POLLIN};
+		if (poll(&pollfd, 1, 100) <= 0) {
+			continue;
+		}
+
+		int sock = accept(loadtest.upstream_sock, NULL, NULL);
+		if (sock == -1) {
+			continue;
+		}
+		struct timeval timeout = {.tv_sec = 2, .tv_usec = 0};
+		setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+		upstream_answer(sock);
+		close(sock);
+	}
+
+	return NULL;
+}
+
+int upstream_start(void) {
+	loadtest.upstream_sock = socket(AF_INET, SOCK_STREAM, 0);
+	if (loadtest.upstream_sock == -1) {
+		error("failed to create upstream socket because %s\n", errno_str());
+		return -1;
+	}
+
+	int enable = 1;
+	setsockopt(loadtest.upstream_sock, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+
+	struct sockaddr_in addr = {.sin_family = AF_INET, .sin_port = htons(loadtest.upstream_port)};
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	if (bind(loadtest.upstream_sock, (struct sockaddr *)&addr, sizeof(addr)) == -1 || listen(loadtest.upstream_sock, 64) == -1) {
+		error("failed to listen on upstream port %hu because %s\n", loadtest.upstream_port, errno_str());
+		close(loadtest.upstream_sock);
+		loadtest.upstream_sock = -1;
+		return -1;
+	}
+
+	atomic_store(&loadtest.upstreaming, true);
+	if ((errno = pthread_create(&loadtest.upstream, NULL, &upstream_thread, NULL)) != 0) {
+		error("failed to spawn upstream thread because %s\n", errno_str());
+		close(loadtest.upstream_sock);
+		loadtest.upstream_sock = -1;
+		return -1;
+	}
+
+	return 0;
+}
+
+void upstream_stop(void) {
+	if (loadtest.upstream_sock == -1) {
+		return;
+	}
+
+	atomic_store(&loadtest.upstreaming, false);
+	pthread_join(loadtest.upstream, NULL);
+	close(loadtest.upstream_sock);
+	loadtest.upstream_sock = -1;
+}
@@ -238,12 +238,12 @@ cleanup:
 
 void device_find(sqlite3 *database, request_t *request, response_t *response) {
 	device_query_t query = {.limit = 16, .offset = 0};
-	if (strnfind(request->search.ptr, request->search.len, "order=", "&", &query.order, &query.order_len, 16) == -1) {
+	if (search_find(request, "order", &query.order, &query.order_len, 16) == -1) {
 		response->status = 400;
 		return;
 	}
 
-	if (strnfind(request->search.ptr, request->search.len, "sort=", "", &query.sort, &query.sort_len, 8) == -1) {
+	if (search_find(request, "sort", &query.sort, &query.sort_len, 8) == -1) {
 		response->status = 400;
 		return;
 	}
@@ -256,7 +256,6 @@ void device_find(sqlite3 *database, request_t *request, response_t *response) {
 	}
 
 	header_write(response, "content-type:application/octet-stream\r\n");
-	header_write(response, "content-length:%u\r\n", response->body.len);
 	info("found %hhu devices\n", devices_len);
 	response->status = 200;
 }
@@ -291,7 +290,7 @@ void device_modify(sqlite3 *database, request_t *request, response_t *response)
 	}
 
 	uint8_t uuid_len = 0;
-	const char *uuid = param_find(request, 12, &uuid_len);
+	const char *uuid = param_find(request, &uuid_len);
 	if (uuid_len != sizeof(*((device_t *)0)->id) * 2) {
 		warn("uuid length %hhu does not match %zu\n", uuid_len, sizeof(*((device_t *)0)->id) * 2);
 		response->status = 400;
@@ -328,7 +327,7 @@ void device_remove(sqlite3 *database, request_t *request, response_t *response)
 	}
 
 	uint8_t uuid_len = 0;
-	const char *uuid = param_find(request, 12, &uuid_len);
+	const char *uuid = param_find(request, &uuid_len);
 	if (uuid_len != sizeof(*((device_t *)0)->id) * 2) {
 		warn("uuid length %hhu does not match %zu\n", uuid_len, sizeof(*((device_t *)0)->id) * 2);
 		response->status = 400;
@@ -0,0 +1,184 @@
+#include "metric.h"
+#include "../app/downlink.h"
+#include "../app/uplink.h"
+#include "../lib/bwt.h"
+#include "../lib/logger.h"
+#include "../lib/metrics.h"
+#include "../lib/request.h"
+#include "../lib/response.h"
+#include "../lib/thread.h"
+#include "router.h"
+#include "transmission.h"
+#include <inttypes.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+
+void metric_write(response_t *response, const char *format, ...) __attribute__((format(printf, 2, 3)));
+
+void metric_write(response_t *response, const char *format, ...) {
+	size_t available = response->body.cap - response->body.len;
+
+	va_list args;
+	va_start(args, format);
+	int len = vsnprintf(response->body.ptr + response->body.len, available, format, args);
+	va_end(args);
+
+	if (len > 0 && (size_t)len < available) {
+		response->body.len += (uint32_t)len;
+	}
+}
+
+const char *metric_labels(uint8_t index) {
+	static _Thread_local char labels[96];
+	if (index < endpoints_len) {
+		snprintf(labels, sizeof(labels), "method=\"%s\",pathname=\"%s\"", endpoints[index].method, endpoints[index].pathname);
+	} else {
+		snprintf(labels, sizeof(labels), "method=\"\",pathname=\"\"");
+	}
+	return labels;
+}
+
+void metric_histogram(response_t *response, const char *name, const char *labels, histogram_t *histogram) {
+	uint64_t buckets[48];
+	uint64_t sum;
+	metric_merge(histogram, &buckets, &sum);
+
+	uint8_t last = 0;
+	for (uint8_t bucket = 0; bucket < 48; bucket++) {
+		if (buckets[bucket] != 0) {
+			last = bucket;
+		}
+	}
+
+	const char *separator = labels[0] == '\0' ? "" : ",";
+	uint64_t count = 0;
+	for (uint8_t bucket = 0; bucket <= last; bucket++) {
+		count += buckets[bucket];
+		metric_write(response, "%s_bucket{%s%sle=\"%" PRIu64 "\"} %" PRIu64 "\n", name, labels, separator, metric_bound(bucket),
+								 count);
+	}
+	for (uint8_t bucket = last + 1; bucket < 48; bucket++) {
+		count += buckets[bucket];
+	}
+	metric_write(response, "%s_bucket{%s%sle=\"+Inf\"} %" PRIu64 "\n", name, labels, separator, count);
+	if (labels[0] == '\0') {
+		metric_write(response, "%s_sum %" PRIu64 "\n", name, sum);
+		metric_write(response, "%s_count %" PRIu64 "\n", name, count);
+	} else {
+		metric_write(response, "%s_sum{%s} %" PRIu64 "\n", name, labels, sum);
+		metric_write(response, "%s_count{%s} %" PRIu64 "\n", name, labels, count);
+	}
+}
+
+void metric_spread_write(response_t *response, const char *name, spread_t *spread, int16_t origin, uint8_t step) {
+	uint64_t buckets[24];
+	int64_t sum;
+	metric_gather(spread, &buckets, &sum);
+
+	metric_write(response, "# TYPE %s histogram\n", name);
+	uint64_t count = 0;
+	for (uint8_t bucket = 0; bucket < 23; bucket++) {
+		count += buckets[bucket];
+		metric_write(response, "%s_bucket{le=\"%d\"} %" PRIu64 "\n", name, origin + (bucket + 1) * step - 1, count);
+	}
+	count += buckets[23];
+	metric_write(response, "%s_bucket{le=\"+Inf\"} %" PRIu64 "\n", name, count);
+	metric_write(response, "%s_sum %" PRId64 "\n", name, sum);
+	metric_write(response, "%s_count %" PRIu64 "\n", name, count);
+}
+
+void metric_find(request_t *request, response_t *response) {
+	if (request->search.len != 0) {
+		response->status = 400;
+		return;
+	}
+
+	header_write(response, "content-type:text/plain; version=0.0.4\r\n");
+
+	metric_write(response, "# TYPE nexus_http_requests_total counter\n");
+	for (uint8_t index = 0; index <= endpoints_len; index++) {
+		metric_write(response, "nexus_http_requests_total{%s} %" PRIu64 "\n", metric_labels(index),
+								 metric_total(&metrics.shards[0].requests[index]));
+	}
+
+	metric_write(response, "# TYPE nexus_http_received_bytes_total counter\n");
+	for (uint8_t index = 0; index <= endpoints_len; index++) {
+		if (metric_total(&metrics.shards[0].requests[index]) > 0) {
+			metric_write(response, "nexus_http_received_bytes_total{%s} %" PRIu64 "\n", metric_labels(index),
+									 metric_total(&metrics.shards[0].received_bytes[index]));
+		}
+	}
+
+	metric_write(response, "# TYPE nexus_http_sent_bytes_total counter\n");
+	for (uint8_t index = 0; index <= endpoints_len; index++) {
+		if (metric_total(&metrics.shards[0].requests[index]) > 0) {
+			metric_write(response, "nexus_http_sent_bytes_total{%s} %" PRIu64 "\n", metric_labels(index),
+									 metric_total(&metrics.shards[0].sent_bytes[index]));
+		}
+	}
+
+	metric_write(response, "# TYPE nexus_http_latency_microseconds histogram\n");
+	for (uint8_t index = 0; index <= endpoints_len; index++) {
+		if (metric_total(&metrics.shards[0].requests[index]) > 0) {
+			metric_histogram(response, "nexus_http_latency_microseconds", metric_labels(index), &metrics.shards[0].latency[index]);
+		}
+	}
+
+	metric_write(response, "# TYPE nexus_queue_depth gauge\n");
+	metric_write(response, "nexus_queue_depth %hu\n", queue_len());
+	metric_write(response, "# TYPE nexus_workers gauge\n");
+	metric_write(response, "nexus_workers %hhu\n", atomic_load(&thread_pool.size));
+	metric_write(response, "# TYPE nexus_workers_busy gauge\n");
+	metric_write(response, "nexus_workers_busy %hhu\n", atomic_load(&thread_pool.load));
+	metric_write(response, "# TYPE nexus_workers_grown_total counter\n");
+	metric_write(response, "nexus_workers_grown_total %" PRIu64 "\n", metric_total(&metrics.shards[0].grown));
+	metric_write(response, "# TYPE nexus_workers_shrunk_total counter\n");
+	metric_write(response, "nexus_workers_shrunk_total %" PRIu64 "\n", metric_total(&metrics.shards[0].shrunk));
+
+	metric_write(response, "# TYPE nexus_radio_receives_total counter\n");
+	metric_write(response, "nexus_radio_receives_total %" PRIu64 "\n", metric_total(&metrics.shards[0].receives));
+	metric_write(response, "# TYPE nexus_radio_transmits_total counter\n");
+	metric_write(response, "nexus_radio_transmits_total %" PRIu64 "\n", metric_total(&metrics.shards[0].transmits));
+	metric_write(response, "# TYPE nexus_radio_checksum_failures_total counter\n");
+	metric_write(response, "nexus_radio_checksum_failures_total %" PRIu64 "\n", metric_total(&metrics.shards[0].corrupts));
+	metric_write(response, "# TYPE nexus_radio_deadline_misses_total counter\n");
+	metric_write(response, "nexus_radio_deadline_misses_total %" PRIu64 "\n", metric_total(&metrics.shards[0].deadline_misses));
+	metric_write(response, "# TYPE nexus_radio_telemetry_dropped_total counter\n");
+	metric_write(response, "nexus_radio_telemetry_dropped_total %" PRIu64 "\n", metric_total(&metrics.shards[0].drops));
+	metric_write(response, "# TYPE nexus_radio_turnaround_microseconds histogram\n");
+	metric_histogram(response, "nexus_radio_turnaround_microseconds", "", &metrics.shards[0].turnaround);
+	metric_spread_write(response, "nexus_radio_rssi_dbm", &metrics.shards[0].rssi, rssi_origin, rssi_step);
+	metric_spread_write(response, "nexus_radio_snr_db", &metrics.shards[0].snr, snr_origin, snr_step);
+	metric_spread_write(response, "nexus_radio_airtime_error_microseconds", &metrics.shards[0].airtime_error,
+											airtime_error_origin, airtime_error_step);
+
+	metric_write(response, "# TYPE nexus_uplinks_depth gauge\n");
+	metric_write(response, "nexus_uplinks_depth %hhu\n", uplinks.size);
+	metric_write(response, "# TYPE nexus_uplinks_wait_microseconds histogram\n");
+	metric_histogram(response, "nexus_uplinks_wait_microseconds", "", &metrics.shards[0].uplink_wait);
+	metric_write(response, "# TYPE nexus_uplinks_forward_microseconds histogram\n");
+	metric_histogram(response, "nexus_uplinks_forward_microseconds", "", &metrics.shards[0].uplink_forward);
+
+	metric_write(response, "# TYPE nexus_downlinks_depth gauge\n");
+	metric_write(response, "nexus_downlinks_depth %hhu\n", downlinks.size);
+	metric_write(response, "# TYPE nexus_downlinks_wait_microseconds histogram\n");
+	metric_histogram(response, "nexus_downlinks_wait_microseconds", "", &metrics.shards[0].downlink_wait);
+	metric_write(response, "# TYPE nexus_downlinks_forward_microseconds histogram\n");
+	metric_histogram(response, "nexus_downlinks_forward_microseconds", "", &metrics.shards[0].downlink_forward);
+
+	metric_write(response, "# TYPE nexus_transmissions_depth gauge\n");
+	metric_write(response, "nexus_transmissions_depth %hhu\n", transmissions.size);
+	metric_write(response, "# TYPE nexus_transmissions_wait_microseconds histogram\n");
+	metric_histogram(response, "nexus_transmissions_wait_microseconds", "", &metrics.shards[0].transmission_wait);
+
+	metric_write(response, "# TYPE nexus_bwt_cache_hits_total counter\n");
+	metric_write(response, "nexus_bwt_cache_hits_total %u\n", atomic_load(&tokens.hits));
+	metric_write(response, "# TYPE nexus_bwt_cache_misses_total counter\n");
+	metric_write(response, "nexus_bwt_cache_misses_total %u\n", atomic_load(&tokens.misses));
+	metric_write(response, "# TYPE nexus_log_dropped_total counter\n");
+	metric_write(response, "nexus_log_dropped_total %" PRIu64 "\n", atomic_load(&logs.dropped));
+
+	response->status = 200;
+}
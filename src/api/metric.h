@@ -0,0 +1,6 @@
+#pragma once
+
+#include "../lib/request.h"
+#include "../lib/response.h"
+
+void metric_find(request_t *request, response_t *response);
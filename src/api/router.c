@@ -1,12 +1,17 @@
+#include "router.h"
 #include "../app/page.h"
 #include "../app/radio.h"
 #include "../app/serve.h"
 #include "../lib/bwt.h"
 #include "../lib/endian.h"
+#include "../lib/error.h"
+#include "../lib/logger.h"
+#include "../lib/metrics.h"
 #include "../lib/request.h"
 #include "../lib/response.h"
 #include "device.h"
 #include "host.h"
+#include "metric.h"
 #include "radio.h"
 #include "schedule.h"
 #include "transmission.h"
@@ -14,58 +19,12 @@
 #include <sqlite3.h>
 #include <stdbool.h>
 #include <stdint.h>
+#include <stdlib.h>
 #include <string.h>
 
-bool pathcmp(const char *pattern, uint8_t pattern_len, const char *pathname, uint8_t pathname_len) {
-	uint8_t pattern_ind = 0;
-	uint8_t pathname_ind = 0;
-
-	while (pattern_ind < pattern_len && pathname_ind < pathname_len) {
-		if (pattern[pattern_ind] == ':') {
-			while (pattern_ind < pattern_len && pattern[pattern_ind] != '/') {
-				pattern_ind++;
-			}
-			while (pathname_ind < pathname_len && pathname[pathname_ind] != '/') {
-				pathname_ind++;
-			}
-		} else if (pattern[pattern_ind] == pathname[pathname_ind]) {
-			pattern_ind++;
-			pathname_ind++;
-		} else {
-			return false;
-		}
-	}
-
-	return pattern_ind == pattern_len && pathname_ind == pathname_len;
-}
-
-bool endpoint(request_t *request, const char *method, const char *pathname, bool *method_found, bool *pathname_found) {
-	if (*method_found == true && *pathname_found == true) {
-		return false;
-	}
-
-	if (pathcmp(pathname, (uint8_t)strlen(pathname), request->pathname.ptr, (uint8_t)request->pathname.len) == true) {
-		*pathname_found = true;
-
-		if (strcmp(method, "get") == 0 && request->method.len == 4 &&
-				memcmp(request->method.ptr, "head", request->method.len) == 0) {
-			*method_found = true;
-
-			return true;
-		}
-
-		if (request->method.len == strlen(method) && memcmp(request->method.ptr, method, request->method.len) == 0) {
-			*method_found = true;
-
-			return true;
-		}
-	}
-
-	return false;
-}
-
 bool authenticate(bool redirect, bwt_t *bwt, request_t *request, response_t *response) {
-	const char *cookie = header_find(request, "cookie");
+	uint16_t cookie_len;
+	const char *cookie = header_find(request, "cookie", &cookie_len);
 	if (cookie == NULL) {
 		if (redirect == true) {
 			response->status = 307;
@@ -77,7 +36,7 @@ bool authenticate(bool redirect, bwt_t *bwt, request_t *request, response_t *res
 		return false;
 	}
 
-	if (bwt_verify(cookie, request->header.len - (size_t)(cookie - (const char *)request->header.ptr), bwt) == -1) {
+	if (bwt_verify(cookie, cookie_len, bwt) == -1) {
 		response->status = 401;
 		return false;
 	}
@@ -98,173 +57,383 @@ bool authorize(bwt_t *bwt, uint32_t permission, response_t *response) {
 	return true;
 }
 
-void route(sqlite3 *database, request_t *request, response_t *response) {
-	bool method_found = false;
-	bool pathname_found = false;
+void route_home(sqlite3 *database, request_t *request, response_t *response) {
+	(void)database;
+	bwt_t bwt;
+	if (authenticate(true, &bwt, request, response) == true) {
+		serve(&page_home, response);
+	}
+}
 
-	if (response->status != 0) {
-		goto respond;
+void route_robots(sqlite3 *database, request_t *request, response_t *response) {
+	(void)database;
+	(void)request;
+	serve(&page_robots, response);
+}
+
+void route_security(sqlite3 *database, request_t *request, response_t *response) {
+	(void)database;
+	(void)request;
+	serve(&page_security, response);
+}
+
+void route_radios(sqlite3 *database, request_t *request, response_t *response) {
+	(void)database;
+	bwt_t bwt;
+	if (authenticate(true, &bwt, request, response) == true) {
+		serve(&page_radios, response);
 	}
+}
 
-	if (endpoint(request, "get", "/", &method_found, &pathname_found) == true) {
-		bwt_t bwt;
-		if (authenticate(true, &bwt, request, response) == true) {
-			serve(&page_home, response);
-		}
+void route_devices(sqlite3 *database, request_t *request, response_t *response) {
+	(void)database;
+	bwt_t bwt;
+	if (authenticate(true, &bwt, request, response) == true) {
+		serve(&page_devices, response);
 	}
+}
 
-	if (endpoint(request, "get", "/robots.txt", &method_found, &pathname_found) == true) {
-		serve(&page_robots, response);
+void route_hosts(sqlite3 *database, request_t *request, response_t *response) {
+	(void)database;
+	bwt_t bwt;
+	if (authenticate(true, &bwt, request, response) == true) {
+		serve(&page_hosts, response);
 	}
+}
+
+void route_signin(sqlite3 *database, request_t *request, response_t *response) {
+	(void)database;
+	(void)request;
+	serve(&page_signin, response);
+}
 
-	if (endpoint(request, "get", "/security.txt", &method_found, &pathname_found) == true) {
-		serve(&page_security, response);
+void route_transmission_stream(sqlite3 *database, request_t *request, response_t *response) {
+	(void)database;
+	bwt_t bwt;
+	if (authenticate(false, &bwt, request, response) == true) {
+		transmission_stream(response);
 	}
+}
 
-	if (endpoint(request, "get", "/radios", &method_found, &pathname_found) == true) {
-		bwt_t bwt;
-		if (authenticate(true, &bwt, request, response) == true) {
-			serve(&page_radios, response);
-		}
+void route_radio_find(sqlite3 *database, request_t *request, response_t *response) {
+	bwt_t bwt;
+	if (authenticate(false, &bwt, request, response) == true) {
+		radio_find(database, request, response);
 	}
+}
 
-	if (endpoint(request, "get", "/devices", &method_found, &pathname_found) == true) {
-		bwt_t bwt;
-		if (authenticate(true, &bwt, request, response) == true) {
-			serve(&page_devices, response);
-		}
+void route_radio_reload(sqlite3 *database, request_t *request, response_t *response) {
+	bwt_t bwt;
+	if (authenticate(false, &bwt, request, response) == true) {
+		radio_reload(database, response);
 	}
+}
 
-	if (endpoint(request, "get", "/hosts", &method_found, &pathname_found) == true) {
-		bwt_t bwt;
-		if (authenticate(true, &bwt, request, response) == true) {
-			serve(&page_hosts, response);
-		}
+void route_radio_create(sqlite3 *database, request_t *request, response_t *response) {
+	bwt_t bwt;
+	if (authenticate(false, &bwt, request, response) == true) {
+		radio_create(database, request, response);
 	}
+}
 
-	if (endpoint(request, "get", "/signin", &method_found, &pathname_found) == true) {
-		serve(&page_signin, response);
+void route_radio_modify(sqlite3 *database, request_t *request, response_t *response) {
+	bwt_t bwt;
+	if (authenticate(false, &bwt, request, response) == true) {
+		radio_modify(database, request, response);
 	}
+}
 
-	if (endpoint(request, "get", "/api/transmissions/sse", &method_found, &pathname_found) == true) {
-		bwt_t bwt;
-		if (authenticate(false, &bwt, request, response) == true) {
-			transmission_stream(request, response);
-		}
+void route_radio_remove(sqlite3 *database, request_t *request, response_t *response) {
+	bwt_t bwt;
+	if (authenticate(false, &bwt, request, response) == true) {
+		radio_remove(database, request, response);
 	}
+}
 
-	if (endpoint(request, "get", "/api/radios", &method_found, &pathname_found) == true) {
-		bwt_t bwt;
-		if (authenticate(false, &bwt, request, response) == true) {
-			radio_find(database, request, response);
-		}
+void route_device_find(sqlite3 *database, request_t *request, response_t *response) {
+	bwt_t bwt;
+	if (authenticate(false, &bwt, request, response) == true) {
+		device_find(database, request, response);
 	}
+}
 
-	if (endpoint(request, "reload", "/api/radios", &method_found, &pathname_found) == true) {
-		bwt_t bwt;
-		if (authenticate(false, &bwt, request, response) == true) {
-			radio_reload(database, response);
-		}
+void route_device_create(sqlite3 *database, request_t *request, response_t *response) {
+	bwt_t bwt;
+	if (authenticate(false, &bwt, request, response) == true) {
+		device_create(database, request, response);
 	}
+}
 
-	if (endpoint(request, "post", "/api/radio", &method_found, &pathname_found) == true) {
-		bwt_t bwt;
-		if (authenticate(false, &bwt, request, response) == true) {
-			radio_create(database, request, response);
-		}
+void route_device_modify(sqlite3 *database, request_t *request, response_t *response) {
+	bwt_t bwt;
+	if (authenticate(false, &bwt, request, response) == true) {
+		device_modify(database, request, response);
 	}
+}
 
-	if (endpoint(request, "patch", "/api/radio/:id", &method_found, &pathname_found) == true) {
-		bwt_t bwt;
-		if (authenticate(false, &bwt, request, response) == true) {
-			radio_modify(database, request, response);
-		}
+void route_device_remove(sqlite3 *database, request_t *request, response_t *response) {
+	bwt_t bwt;
+	if (authenticate(false, &bwt, request, response) == true) {
+		device_remove(database, request, response);
 	}
+}
 
-	if (endpoint(request, "delete", "/api/radio/:id", &method_found, &pathname_found) == true) {
-		bwt_t bwt;
-		if (authenticate(false, &bwt, request, response) == true) {
-			radio_remove(database, request, response);
-		}
+void route_host_find(sqlite3 *database, request_t *request, response_t *response) {
+	bwt_t bwt;
+	if (authenticate(false, &bwt, request, response) == true) {
+		host_find(database, request, response);
 	}
+}
 
-	if (endpoint(request, "get", "/api/devices", &method_found, &pathname_found) == true) {
-		bwt_t bwt;
-		if (authenticate(false, &bwt, request, response) == true) {
-			device_find(database, request, response);
-		}
+void route_host_create(sqlite3 *database, request_t *request, response_t *response) {
+	bwt_t bwt;
+	if (authenticate(false, &bwt, request, response) == true) {
+		host_create(database, request, response);
 	}
+}
 
-	if (endpoint(request, "post", "/api/device", &method_found, &pathname_found) == true) {
-		bwt_t bwt;
-		if (authenticate(false, &bwt, request, response) == true) {
-			device_create(database, request, response);
-		}
+void route_host_modify(sqlite3 *database, request_t *request, response_t *response) {
+	bwt_t bwt;
+	if (authenticate(false, &bwt, request, response) == true) {
+		host_modify(database, request, response);
 	}
+}
 
-	if (endpoint(request, "patch", "/api/device/:id", &method_found, &pathname_found) == true) {
-		bwt_t bwt;
-		if (authenticate(false, &bwt, request, response) == true) {
-			device_modify(database, request, response);
-		}
+void route_host_remove(sqlite3 *database, request_t *request, response_t *response) {
+	bwt_t bwt;
+	if (authenticate(false, &bwt, request, response) == true) {
+		host_remove(database, request, response);
 	}
+}
 
-	if (endpoint(request, "delete", "/api/device/:id", &method_found, &pathname_found) == true) {
-		bwt_t bwt;
-		if (authenticate(false, &bwt, request, response) == true) {
-			device_remove(database, request, response);
-		}
+void route_schedule_create(sqlite3 *database, request_t *request, response_t *response) {
+	(void)database;
+	bwt_t bwt;
+	if (authenticate(false, &bwt, request, response) == true) {
+		schedule_create(request, response);
 	}
+}
 
-	if (endpoint(request, "get", "/api/hosts", &method_found, &pathname_found) == true) {
-		bwt_t bwt;
-		if (authenticate(false, &bwt, request, response) == true) {
-			host_find(database, request, response);
+void route_user_signin(sqlite3 *database, request_t *request, response_t *response) { user_signin(database, request, response); }
+
+void route_metric_find(sqlite3 *database, request_t *request, response_t *response) {
+	(void)database;
+	bwt_t bwt;
+	if (authenticate(false, &bwt, request, response) == true) {
+		metric_find(request, response);
+	}
+}
+
+const char *methods[] = {"get", "post", "patch", "delete", "reload"};
+
+endpoint_t endpoints[] = {
+		{.method = "get", .pathname = "/", .handler = &route_home},
+		{.method = "get", .pathname = "/robots.txt", .handler = &route_robots},
+		{.method = "get", .pathname = "/security.txt", .handler = &route_security},
+		{.method = "get", .pathname = "/radios", .handler = &route_radios},
+		{.method = "get", .pathname = "/devices", .handler = &route_devices},
+		{.method = "get", .pathname = "/hosts", .handler = &route_hosts},
+		{.method = "get", .pathname = "/signin", .handler = &route_signin},
+		{.method = "get", .pathname = "/api/transmissions/sse", .handler = &route_transmission_stream},
+		{.method = "get", .pathname = "/api/radios", .handler = &route_radio_find},
+		{.method = "reload", .pathname = "/api/radios", .handler = &route_radio_reload},
+		{.method = "post", .pathname = "/api/radio", .handler = &route_radio_create},
+		{.method = "patch", .pathname = "/api/radio/:id", .handler = &route_radio_modify},
+		{.method = "delete", .pathname = "/api/radio/:id", .handler = &route_radio_remove},
+		{.method = "get", .pathname = "/api/devices", .handler = &route_device_find},
+		{.method = "post", .pathname = "/api/device", .handler = &route_device_create},
+		{.method = "patch", .pathname = "/api/device/:id", .handler = &route_device_modify},
+		{.method = "delete", .pathname = "/api/device/:id", .handler = &route_device_remove},
+		{.method = "get", .pathname = "/api/hosts", .handler = &route_host_find},
+		{.method = "post", .pathname = "/api/host", .handler = &route_host_create},
+		{.method = "patch", .pathname = "/api/host/:id", .handler = &route_host_modify},
+		{.method = "delete", .pathname = "/api/host/:id", .handler = &route_host_remove},
+		{.method = "post", .pathname = "/api/schedule", .handler = &route_schedule_create},
+		{.method = "post", .pathname = "/api/signin", .handler = &route_user_signin},
+		{.method = "get", .pathname = "/api/metrics", .handler = &route_metric_find},
+};
+
+const uint8_t endpoints_len = sizeof(endpoints) / sizeof(*endpoints);
+
+router_t router = {.nodes = NULL, .len = 0, .cap = 0};
+
+int8_t router_method(const char *method, uint8_t method_len) {
+	if (method_len == 4 && memcmp(method, "head", 4) == 0) {
+		return 0;
+	}
+
+	for (uint8_t index = 0; index < sizeof(methods) / sizeof(*methods); index++) {
+		if (strlen(methods[index]) == method_len && memcmp(methods[index], method, method_len) == 0) {
+			return (int8_t)index;
 		}
 	}
 
-	if (endpoint(request, "post", "/api/host", &method_found, &pathname_found) == true) {
-		bwt_t bwt;
-		if (authenticate(false, &bwt, request, response) == true) {
-			host_create(database, request, response);
+	return -1;
+}
+
+node_t *router_child(node_t *node, const char *segment, uint8_t segment_len) {
+	bool param = segment_len > 0 && segment[0] == ':';
+
+	for (node_t *child = node->child; child != NULL; child = child->sibling) {
+		if (param == true && child->param == true) {
+			return child;
+		}
+		if (param == false && child->param == false && child->segment_len == segment_len &&
+				memcmp(child->segment, segment, segment_len) == 0) {
+			return child;
 		}
 	}
 
-	if (endpoint(request, "patch", "/api/host/:id", &method_found, &pathname_found) == true) {
-		bwt_t bwt;
-		if (authenticate(false, &bwt, request, response) == true) {
-			host_modify(database, request, response);
+	if (router.len >= router.cap) {
+		fatal("router exceeds %hhu nodes\n", router.cap);
+		return NULL;
+	}
+
+	node_t *child = &router.nodes[router.len];
+	router.len++;
+	child->segment = segment;
+	child->segment_len = segment_len;
+	child->param = param;
+	child->sibling = node->child;
+	node->child = child;
+
+	return child;
+}
+
+int router_init(void) {
+	if (endpoints_len >= sizeof(((shard_t *)0)->requests) / sizeof(*((shard_t *)0)->requests)) {
+		fatal("router exceeds %zu metered endpoints\n", sizeof(((shard_t *)0)->requests) / sizeof(*((shard_t *)0)->requests) - 1);
+		return -1;
+	}
+
+	router.cap = 1;
+	for (uint8_t index = 0; index < sizeof(endpoints) / sizeof(*endpoints); index++) {
+		for (const char *byte = endpoints[index].pathname; *byte != '\0'; byte++) {
+			if (*byte == '/') {
+				router.cap++;
+			}
 		}
 	}
 
-	if (endpoint(request, "delete", "/api/host/:id", &method_found, &pathname_found) == true) {
-		bwt_t bwt;
-		if (authenticate(false, &bwt, request, response) == true) {
-			host_remove(database, request, response);
+	router.nodes = calloc(router.cap, sizeof(*router.nodes));
+	if (router.nodes == NULL) {
+		fatal("failed to allocate %zu bytes for router because %s\n", router.cap * sizeof(*router.nodes), errno_str());
+		return -1;
+	}
+	router.len = 1;
+
+	for (uint8_t index = 0; index < sizeof(endpoints) / sizeof(*endpoints); index++) {
+		endpoint_t *endpoint = &endpoints[index];
+		node_t *node = &router.nodes[0];
+
+		const char *segment = &endpoint->pathname[1];
+		while (*segment != '\0') {
+			uint8_t segment_len = 0;
+			while (segment[segment_len] != '\0' && segment[segment_len] != '/') {
+				segment_len++;
+			}
+			if ((node = router_child(node, segment, segment_len)) == NULL) {
+				return -1;
+			}
+			segment += segment_len;
+			if (*segment == '/') {
+				segment++;
+			}
 		}
+
+		int8_t method = router_method(endpoint->method, (uint8_t)strlen(endpoint->method));
+		if (method == -1) {
+			fatal("unknown method %s for endpoint %s\n", endpoint->method, endpoint->pathname);
+			return -1;
+		}
+		node->endpoints[method] = endpoint;
+		node->handled = true;
+	}
+
+	debug("compiled %hhu endpoints into %hhu router nodes\n", endpoints_len, router.len);
+	return 0;
+}
+
+void router_free(void) {
+	free(router.nodes);
+	router.nodes = NULL;
+	router.len = 0;
+	router.cap = 0;
+}
+
+node_t *router_find(request_t *request) {
+	if (request->pathname.len == 0 || request->pathname.ptr[0] != '/') {
+		return NULL;
 	}
 
-	if (endpoint(request, "post", "/api/schedule", &method_found, &pathname_found) == true) {
-		bwt_t bwt;
-		if (authenticate(false, &bwt, request, response) == true) {
-			schedule_create(request, response);
+	node_t *node = &router.nodes[0];
+	uint8_t index = 1;
+	while (request->pathname.len > 1) {
+		const char *segment = &request->pathname.ptr[index];
+		uint8_t segment_len = 0;
+		while (index + segment_len < request->pathname.len && segment[segment_len] != '/') {
+			segment_len++;
+		}
+
+		node_t *match = NULL;
+		node_t *param = NULL;
+		for (node_t *child = node->child; child != NULL; child = child->sibling) {
+			if (child->param == true) {
+				param = child;
+			} else if (child->segment_len == segment_len && memcmp(child->segment, segment, segment_len) == 0) {
+				match = child;
+				break;
+			}
+		}
+
+		if (match == NULL && param == NULL) {
+			return NULL;
+		}
+		if (match == NULL) {
+			if (segment_len == 0) {
+				return NULL;
+			}
+			request->param = segment;
+			request->param_len = segment_len;
+			match = param;
+		}
+
+		node = match;
+		index += segment_len;
+		if (index >= request->pathname.len) {
+			break;
 		}
+		index++;
 	}
 
-	if (endpoint(request, "post", "/api/signin", &method_found, &pathname_found) == true) {
-		user_signin(database, request, response);
+	return node;
+}
+
+int8_t route(sqlite3 *database, request_t *request, response_t *response) {
+	int8_t index = -1;
+
+	if (response->status != 0) {
+		goto respond;
 	}
 
-respond:
-	if (response->status == 0 && pathname_found == false && method_found == false) {
+	node_t *node = router_find(request);
+	if (node == NULL || node->handled == false) {
 		response->status = 404;
+		goto respond;
 	}
-	if (response->status == 0 && pathname_found == true && method_found == false) {
+
+	int8_t method = router_method(request->method.ptr, request->method.len);
+	if (method == -1 || node->endpoints[method] == NULL) {
 		response->status = 405;
+		goto respond;
 	}
 
+	index = (int8_t)(node->endpoints[method] - endpoints);
+	node->endpoints[method]->handler(database, request, response);
+
+respond:
 	if (request->pathname.len >= 5 && memcmp(request->pathname.ptr, "/api/", 5) == 0) {
-		return;
+		return index;
 	}
 
 	if (response->status == 400) {
@@ -300,4 +469,6 @@ respond:
 	if (response->status == 507) {
 		serve(&page_insufficient_storage, response);
 	}
+
+	return index;
 }
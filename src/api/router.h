@@ -3,5 +3,37 @@
 #include "../lib/request.h"
 #include "../lib/response.h"
 #include <sqlite3.h>
+#include <stdbool.h>
+#include <stdint.h>
 
-void route(sqlite3 *database, request_t *request, response_t *response);
+typedef struct endpoint_t {
+	const char *method;
+	const char *pathname;
+	void (*handler)(sqlite3 *database, request_t *request, response_t *response);
+} endpoint_t;
+
+typedef struct node_t {
+	const char *segment;
+	uint8_t segment_len;
+	bool param;
+	bool handled;
+	endpoint_t *endpoints[5];
+	struct node_t *child;
+	struct node_t *sibling;
+} node_t;
+
+typedef struct router_t {
+	node_t *nodes;
+	uint8_t len;
+	uint8_t cap;
+} router_t;
+
+extern struct router_t router;
+
+extern endpoint_t endpoints[];
+extern const uint8_t endpoints_len;
+
+int router_init(void);
+void router_free(void);
+
+int8_t route(sqlite3 *database, request_t *request, response_t *response);
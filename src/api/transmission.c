@@ -1,11 +1,14 @@
 #include "transmission.h"
 #include "../lib/config.h"
 #include "../lib/error.h"
+#include "../lib/format.h"
 #include "../lib/logger.h"
+#include "../lib/metrics.h"
 #include "../lib/request.h"
 #include "../lib/response.h"
 #include <arpa/inet.h>
 #include <errno.h>
+#include <inttypes.h>
 #include <pthread.h>
 #include <stdbool.h>
 #include <stdlib.h>
@@ -14,6 +17,7 @@
 
 streams_t streams = {
 		.size = 0,
+		.pending = 0,
 		.lock = PTHREAD_MUTEX_INITIALIZER,
 };
 
@@ -76,35 +80,31 @@ void *transmission_thread(void *args) {
 		transmission_t transmission = transmissions.ptr[transmissions.head];
 		pthread_mutex_unlock(&transmissions.lock);
 
+		metric_observe(&metric_shard()->transmission_wait, metric_elapsed(&transmission.queued_at));
+
 		char buffer[512];
 		uint16_t buffer_len = 0;
 
 		buffer_len += (uint16_t)sprintf(&buffer[buffer_len], "data:");
-		buffer_len += (uint16_t)sprintf(&buffer[buffer_len], "%lu", transmission.timestamp);
+		buffer_len += (uint16_t)sprintf(&buffer[buffer_len], "%" PRIu64, transmission.timestamp);
 		buffer[buffer_len] = ' ';
 		buffer_len += sizeof(char);
-		for (uint8_t index = 0; index < 2; index++) {
-			buffer_len += (uint16_t)sprintf(&buffer[buffer_len], "%02x", transmission.radio_id[index]);
-		}
+		buffer_len += human_hex(&buffer[buffer_len], sizeof(buffer) - buffer_len, transmission.radio_id, 2);
 		buffer[buffer_len] = ' ';
 		buffer_len += sizeof(char);
 		buffer_len += (uint16_t)sprintf(&buffer[buffer_len], "%.*s", (int)sizeof(transmission.type), transmission.type);
 		buffer[buffer_len] = ' ';
 		buffer_len += sizeof(char);
-		for (uint8_t index = 0; index < 2; index++) {
-			buffer_len += (uint16_t)sprintf(&buffer[buffer_len], "%02x", transmission.device_id[index]);
-		}
+		buffer_len += human_hex(&buffer[buffer_len], sizeof(buffer) - buffer_len, transmission.device_id, 2);
 		buffer[buffer_len] = ' ';
 		buffer_len += sizeof(char);
 		buffer_len += (uint16_t)sprintf(&buffer[buffer_len], "%hu", transmission.frame);
 		buffer[buffer_len] = ' ';
 		buffer_len += sizeof(char);
-		buffer_len += (uint16_t)sprintf(&buffer[buffer_len], "%02x", transmission.kind);
+		buffer_len += human_hex(&buffer[buffer_len], sizeof(buffer) - buffer_len, &transmission.kind, 1);
 		buffer[buffer_len] = ' ';
 		buffer_len += sizeof(char);
-		for (uint8_t index = 0; index < transmission.data_len; index++) {
-			buffer_len += (uint16_t)sprintf(&buffer[buffer_len], "%02x", transmission.data[index]);
-		}
+		buffer_len += human_hex(&buffer[buffer_len], sizeof(buffer) - buffer_len, transmission.data, transmission.data_len);
 		buffer[buffer_len] = ' ';
 		buffer_len += sizeof(char);
 		buffer_len += (uint16_t)sprintf(&buffer[buffer_len], "%hd", transmission.rssi);
@@ -151,18 +151,21 @@ void *transmission_thread(void *args) {
 	}
 }
 
-void transmission_stream(request_t *request, response_t *response) {
+void transmission_stream(response_t *response) {
 	header_write(response, "content-type:text/event-stream\r\n");
 
 	bool space = false;
 	pthread_mutex_lock(&streams.lock);
+	uint8_t used = streams.pending;
 	for (uint8_t index = 0; index < streams_size; index++) {
-		if (streams.ptr[index] == -1) {
-			streams.ptr[index] = request->socket;
-			space = true;
-			break;
+		if (streams.ptr[index] != -1) {
+			used++;
 		}
 	}
+	if (used < streams_size) {
+		streams.pending++;
+		space = true;
+	}
 	pthread_mutex_unlock(&streams.lock);
 
 	if (space == false) {
@@ -175,3 +178,22 @@ void transmission_stream(request_t *request, response_t *response) {
 	response->status = 200;
 	response->stream = true;
 }
+
+void transmission_attach(int sock) {
+	pthread_mutex_lock(&streams.lock);
+	streams.pending--;
+	for (uint8_t index = 0; index < streams_size; index++) {
+		if (streams.ptr[index] == -1) {
+			streams.ptr[index] = sock;
+			pthread_mutex_unlock(&streams.lock);
+			trace("attached stream to socket %d\n", sock);
+			return;
+		}
+	}
+	pthread_mutex_unlock(&streams.lock);
+
+	warn("no more streams available for socket %d\n", sock);
+	if (close(sock) == -1) {
+		error("failed to close client socket because %s\n", errno_str());
+	}
+}
@@ -9,11 +9,13 @@
 typedef struct streams_t {
 	int *ptr;
 	uint8_t size;
+	uint8_t pending;
 	pthread_mutex_t lock;
 } streams_t;
 
 typedef struct transmission_t {
-	time_t timestamp;
+	uint64_t timestamp;
+	struct timespec queued_at;
 	uint8_t radio_id[16];
 	char type[2];
 	uint8_t device_id[16];
@@ -53,4 +55,6 @@ int transmission_spawn(pthread_t *thread, void *(*function)(void *));
 
 void *transmission_thread(void *args);
 
-void transmission_stream(request_t *request, response_t *response);
+void transmission_stream(response_t *response);
+
+void transmission_attach(int sock);
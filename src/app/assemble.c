@@ -52,10 +52,10 @@ recursion:
 			}
 			char id[32];
 			uint8_t id_len = 0;
-			char *id_start;
+			char *id_start = NULL;
 			char class[128];
 			uint8_t class_len = 0;
-			char *class_start;
+			char *class_start = NULL;
 			while (asset_ind < asset->len) {
 				if (*byte == ' ' && asset_ind + 5 < asset->len && memcmp(byte + 1, "id=\"", 4) == 0) {
 					byte += 5;
@@ -4,6 +4,7 @@
 #include "../lib/endian.h"
 #include "../lib/error.h"
 #include "../lib/logger.h"
+#include "../lib/metrics.h"
 #include "../lib/request.h"
 #include "../lib/response.h"
 #include "auth.h"
@@ -154,6 +155,9 @@ void *downlink_thread(void *args) {
 		downlink_t downlink = downlinks.ptr[downlinks.head];
 		pthread_mutex_unlock(&downlinks.lock);
 
+		shard_t *shard = metric_shard();
+		metric_observe(&shard->downlink_wait, metric_elapsed(&downlink.queued_at));
+
 		while (true) {
 			host_t *host = NULL;
 			if (arg->hosts_len == 0) {
@@ -169,7 +173,10 @@ void *downlink_thread(void *args) {
 				}
 			}
 
+			struct timespec start;
+			clock_gettime(CLOCK_MONOTONIC, &start);
 			if (downlink_create(&downlink, host, &cookie) != -1) {
+				metric_observe(&shard->downlink_forward, metric_elapsed(&start));
 				break;
 			}
 
@@ -244,8 +251,7 @@ int downlink_create(downlink_t *downlink, host_t *host, cookie_t *cookie) {
 	request.body.len += sizeof(downlink->tx_power);
 	memcpy(&request.body.ptr[request.body.len], &downlink->preamble_len, sizeof(downlink->preamble_len));
 	request.body.len += sizeof(downlink->preamble_len);
-	memcpy(&request.body.ptr[request.body.len], (time_t[]){(time_t)hton64((uint64_t)downlink->sent_at)},
-				 sizeof(downlink->sent_at));
+	memcpy(&request.body.ptr[request.body.len], (uint64_t[]){hton64(downlink->sent_at)}, sizeof(downlink->sent_at));
 	request.body.len += sizeof(downlink->sent_at);
 	memcpy(&request.body.ptr[request.body.len], downlink->device_id, sizeof(downlink->device_id));
 	request.body.len += sizeof(downlink->device_id);
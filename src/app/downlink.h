@@ -19,7 +19,8 @@ typedef struct downlink_t {
 	uint8_t coding_rate;
 	uint8_t tx_power;
 	uint8_t preamble_len;
-	time_t sent_at;
+	uint64_t sent_at;
+	struct timespec queued_at;
 	uint8_t device_id[16];
 } downlink_t;
 
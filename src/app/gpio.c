@@ -0,0 +1,146 @@
+#include "gpio.h"
+#include "../lib/error.h"
+#include "../lib/logger.h"
+#include "sim.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <linux/gpio.h>
+#include <poll.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <time.h>
+#include <unistd.h>
+
+int gpio_init(gpio_t *gpio, const char *line, sim_t *sim) {
+	gpio->fd = -1;
+	gpio->simulated = false;
+
+	if (strcmp(line, "sim") == 0) {
+		if (sim == NULL) {
+			error("simulated dio0 requires a simulated radio\n");
+			return -1;
+		}
+		gpio->fd = sim_dio0(sim);
+		gpio->simulated = true;
+		return gpio->fd == -1 ? -1 : 0;
+	}
+
+	const char *colon = strchr(line, ':');
+	if (colon == NULL || colon == line || colon[1] == '\0') {
+		error("dio0 line %s must look like gpiochip0:25\n", line);
+		return -1;
+	}
+
+	char *offset_end;
+	unsigned long offset = strtoul(colon + 1, &offset_end, 10);
+	if (*offset_end != '\0' || offset > 1023) {
+		error("dio0 line offset %s must be between 0 and 1023\n", colon + 1);
+		return -1;
+	}
+
+	char chip[64];
+	snprintf(chip, sizeof(chip), "/dev/%.*s", (int)(colon - line), line);
+	int chip_fd = open(chip, O_RDONLY | O_CLOEXEC);
+	if (chip_fd == -1) {
+		error("failed to open %s because %s\n", chip, errno_str());
+		return -1;
+	}
+
+	struct gpio_v2_line_request request;
+	memset(&request, 0, sizeof(request));
+	request.offsets[0] = (uint32_t)offset;
+	request.num_lines = 1;
+	request.config.flags = GPIO_V2_LINE_FLAG_INPUT | GPIO_V2_LINE_FLAG_EDGE_RISING;
+	snprintf(request.consumer, sizeof(request.consumer), "nexus dio0");
+
+	if (ioctl(chip_fd, GPIO_V2_GET_LINE_IOCTL, &request) == -1) {
+		error("failed to request %s line %lu because %s\n", chip, offset, errno_str());
+		close(chip_fd);
+		return -1;
+	}
+	close(chip_fd);
+
+	if (fcntl(request.fd, F_SETFL, fcntl(request.fd, F_GETFL) | O_NONBLOCK) == -1) {
+		error("failed to set %s line %lu non blocking because %s\n", chip, offset, errno_str());
+		close(request.fd);
+		return -1;
+	}
+
+	gpio->fd = request.fd;
+	trace("waiting on %s line %lu for dio0\n", chip, offset);
+	return 0;
+}
+
+void gpio_close(gpio_t *gpio) {
+	if (gpio->fd != -1 && gpio->simulated == false && close(gpio->fd) == -1) {
+		error("failed to close gpio line because %s\n", errno_str());
+	}
+	gpio->fd = -1;
+}
+
+int gpio_drain(gpio_t *gpio, uint64_t since, uint64_t *timestamp) {
+	if (gpio->simulated == true) {
+		uint64_t expirations;
+		if (read(gpio->fd, &expirations, sizeof(expirations)) == -1) {
+			if (errno == EAGAIN) {
+				return 0;
+			}
+			error("failed to read simulated gpio event because %s\n", errno_str());
+			return -1;
+		}
+		struct timespec now;
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		*timestamp = (uint64_t)now.tv_sec * 1000000000 + (uint64_t)now.tv_nsec;
+		return 1;
+	}
+
+	int found = 0;
+	struct gpio_v2_line_event events[16];
+	while (true) {
+		ssize_t received = read(gpio->fd, events, sizeof(events));
+		if (received == -1) {
+			if (errno == EAGAIN) {
+				return found;
+			}
+			if (errno == EINTR) {
+				continue;
+			}
+			error("failed to read gpio events because %s\n", errno_str());
+			return -1;
+		}
+
+		size_t events_len = (size_t)received / sizeof(*events);
+		for (size_t index = 0; index < events_len; index++) {
+			if (events[index].timestamp_ns < since) {
+				trace("discarding dio0 edge %" PRIu64 "us before armed\n", (uint64_t)(since - events[index].timestamp_ns) / 1000);
+				continue;
+			}
+			*timestamp = events[index].timestamp_ns;
+			found = 1;
+		}
+		if (events_len < sizeof(events) / sizeof(*events)) {
+			return found;
+		}
+	}
+}
+
+int gpio_wait(gpio_t *gpio, int timeout, uint64_t since, uint64_t *timestamp) {
+	struct pollfd pollfd = {.fd = gpio->fd, .events = POLLIN};
+	int result = poll(&pollfd, 1, timeout);
+	if (result == -1) {
+		if (errno == EINTR) {
+			return 0;
+		}
+		error("failed to poll gpio line because %s\n", errno_str());
+		return -1;
+	}
+	if (result == 0) {
+		return 0;
+	}
+
+	return gpio_drain(gpio, since, timestamp);
+}
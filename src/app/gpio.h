@@ -0,0 +1,17 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef struct sim_t sim_t;
+
+typedef struct gpio_t {
+	int fd;
+	bool simulated;
+} gpio_t;
+
+int gpio_init(gpio_t *gpio, const char *line, sim_t *sim);
+void gpio_close(gpio_t *gpio);
+
+int gpio_drain(gpio_t *gpio, uint64_t since, uint64_t *timestamp);
+int gpio_wait(gpio_t *gpio, int timeout, uint64_t since, uint64_t *timestamp);
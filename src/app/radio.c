@@ -4,16 +4,20 @@
 #include "../lib/config.h"
 #include "../lib/error.h"
 #include "../lib/logger.h"
+#include "../lib/metrics.h"
 #include "../lib/response.h"
 #include "../lib/ssc128.h"
 #include "airtime.h"
 #include "downlink.h"
+#include "gpio.h"
 #include "radio.h"
 #include "schedule.h"
+#include "sim.h"
 #include "spi.h"
 #include "sx1278.h"
 #include "uplink.h"
 #include <errno.h>
+#include <inttypes.h>
 #include <pthread.h>
 #include <sqlite3.h>
 #include <stdbool.h>
@@ -26,6 +30,7 @@ comms_t comms = {
 		.radios = NULL,
 		.radios_len = 0,
 		.devices = NULL,
+		.keys = NULL,
 		.devices_len = 0,
 };
 
@@ -120,6 +125,12 @@ int radio_init(sqlite3 *database) {
 				status = -1;
 				goto cleanup;
 			}
+			comms.keys = realloc(comms.keys, sizeof(ssc128_key_t) * (comms.devices_len + 1));
+			if (comms.keys == NULL) {
+				error("failed to allocate %zu bytes for keys because %s\n", sizeof(ssc128_key_t) * (comms.devices_len + 1), errno_str());
+				status = -1;
+				goto cleanup;
+			}
 			comms.devices[comms.devices_len].id = malloc(sizeof(*((device_t *)0)->id));
 			if (comms.devices[comms.devices_len].id == NULL) {
 				error("failed to allocate %zu bytes for id because %s\n", sizeof(*((device_t *)0)->id), errno_str());
@@ -162,6 +173,7 @@ int radio_init(sqlite3 *database) {
 			memcpy(comms.devices[comms.devices_len].id, id, id_len);
 			memcpy(comms.devices[comms.devices_len].tag, tag, tag_len);
 			memcpy(comms.devices[comms.devices_len].key, key, key_len);
+			ssc128_expand((const uint8_t (*)[16])comms.devices[comms.devices_len].key, &comms.keys[comms.devices_len]);
 			comms.devices_len += 1;
 		} else if (result == SQLITE_DONE) {
 			status = 0;
@@ -179,15 +191,24 @@ int radio_init(sqlite3 *database) {
 		goto cleanup;
 	}
 
+	for (uint8_t index = 0; index < comms.radios_len; index++) {
+		comms.workers[index].arg.sx1278.spi = (spi_t){.fd = -1, .sim = NULL, .bus = NULL};
+		comms.workers[index].arg.sx1278.dio0 = (gpio_t){.fd = -1, .simulated = false};
+	}
+
 	for (uint8_t index = 0; index < comms.radios_len; index++) {
 		char device[64];
 		sprintf(device, "%.*s", (int)comms.radios[index].device_len, comms.radios[index].device);
-		if ((comms.workers[index].arg.fd = spi_init(device, 0, 8 * 1000 * 1000, 8)) == -1) {
+		if (sx1278_init(&comms.workers[index].arg.sx1278, device) == -1) {
 			return -1;
 		}
+		if (comms.workers[index].arg.sx1278.spi.sim != NULL) {
+			sim_feed(comms.workers[index].arg.sx1278.spi.sim, comms.devices, comms.keys, comms.devices_len);
+		}
 
 		comms.workers[index].arg.radio = &comms.radios[index];
 		comms.workers[index].arg.devices = comms.devices;
+		comms.workers[index].arg.keys = comms.keys;
 		comms.workers[index].arg.devices_len = comms.devices_len;
 		if (radio_spawn(&comms.workers[index].thread, radio_thread, &comms.workers[index].arg) == -1) {
 			return -1;
@@ -215,84 +236,175 @@ int radio_spawn(pthread_t *thread, void *(*function)(void *), radio_arg_t *arg)
 	return 0;
 }
 
+int radio_uplink(uplink_t *uplink) {
+	clock_gettime(CLOCK_MONOTONIC, &uplink->queued_at);
+	pthread_mutex_lock(&uplinks.lock);
+
+	if (uplinks.size >= uplinks_size) {
+		pthread_mutex_unlock(&uplinks.lock);
+		warn("dropping uplink because uplinks size %hhu is full\n", uplinks_size);
+		metric_count(&metric_shard()->drops, 1);
+		return -1;
+	}
+
+	memcpy(&uplinks.ptr[uplinks.tail], uplink, sizeof(*uplink));
+	uplinks.tail = (uint8_t)((uplinks.tail + 1) % uplinks_size);
+	uplinks.size++;
+	trace("radio thread increased uplinks size to %hhu\n", uplinks.size);
+
+	pthread_cond_signal(&uplinks.filled);
+	pthread_mutex_unlock(&uplinks.lock);
+	return 0;
+}
+
+int radio_downlink(downlink_t *downlink) {
+	clock_gettime(CLOCK_MONOTONIC, &downlink->queued_at);
+	pthread_mutex_lock(&downlinks.lock);
+
+	if (downlinks.size >= downlinks_size) {
+		pthread_mutex_unlock(&downlinks.lock);
+		warn("dropping downlink because downlinks size %hhu is full\n", downlinks_size);
+		metric_count(&metric_shard()->drops, 1);
+		return -1;
+	}
+
+	memcpy(&downlinks.ptr[downlinks.tail], downlink, sizeof(*downlink));
+	downlinks.tail = (uint8_t)((downlinks.tail + 1) % downlinks_size);
+	downlinks.size++;
+	trace("radio thread increased downlinks size to %hhu\n", downlinks.size);
+
+	pthread_cond_signal(&downlinks.filled);
+	pthread_mutex_unlock(&downlinks.lock);
+	return 0;
+}
+
+int radio_transmission(transmission_t *transmission) {
+	clock_gettime(CLOCK_MONOTONIC, &transmission->queued_at);
+	pthread_mutex_lock(&transmissions.lock);
+
+	if (transmissions.size >= transmissions_size) {
+		pthread_mutex_unlock(&transmissions.lock);
+		warn("dropping transmission because transmissions size %hhu is full\n", transmissions_size);
+		metric_count(&metric_shard()->drops, 1);
+		return -1;
+	}
+
+	memcpy(&transmissions.ptr[transmissions.tail], transmission, sizeof(*transmission));
+	transmissions.tail = (uint8_t)((transmissions.tail + 1) % transmissions_size);
+	transmissions.size++;
+	trace("radio thread increased transmissions size to %hhu\n", transmissions.size);
+
+	pthread_cond_signal(&transmissions.filled);
+	pthread_mutex_unlock(&transmissions.lock);
+	return 0;
+}
+
+uint64_t radio_realtime(uint64_t monotonic) {
+	struct timespec realtime;
+	struct timespec now;
+	clock_gettime(CLOCK_REALTIME, &realtime);
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	uint64_t realtime_ns = (uint64_t)realtime.tv_sec * 1000000000 + (uint64_t)realtime.tv_nsec;
+	uint64_t now_ns = (uint64_t)now.tv_sec * 1000000000 + (uint64_t)now.tv_nsec;
+	if (monotonic == 0 || monotonic > now_ns) {
+		return realtime_ns;
+	}
+	return realtime_ns - (now_ns - monotonic);
+}
+
 void *radio_thread(void *args) {
 	radio_arg_t *arg = (radio_arg_t *)args;
 
 	srand((unsigned int)time(NULL));
 
-	if (sx1278_sleep(arg->fd) == -1) {
+	if (sx1278_sleep(&arg->sx1278) == -1) {
 		error("failed to enable sleep mode\n");
 	}
 
-	if (sx1278_standby(arg->fd) == -1) {
+	if (sx1278_standby(&arg->sx1278) == -1) {
 		error("failed to enable standby mode\n");
 	}
 
-	if (sx1278_frequency(arg->fd, arg->radio->frequency) == -1) {
+	sx1278_begin(&arg->sx1278);
+
+	if (sx1278_frequency(&arg->sx1278, arg->radio->frequency) == -1) {
 		error("failed to set radio frequency\n");
 	}
 
-	if (sx1278_tx_power(arg->fd, arg->radio->tx_power) == -1) {
+	if (sx1278_tx_power(&arg->sx1278, arg->radio->tx_power) == -1) {
 		error("failed to set radio tx power\n");
 	}
 
-	if (sx1278_preamble_length(arg->fd, arg->radio->preamble_len) == -1) {
+	if (sx1278_preamble_length(&arg->sx1278, arg->radio->preamble_len) == -1) {
 		error("failed to set radio preamble length\n");
 	}
 
-	if (sx1278_coding_rate(arg->fd, arg->radio->coding_rate) == -1) {
+	if (sx1278_coding_rate(&arg->sx1278, arg->radio->coding_rate) == -1) {
 		error("failed to set radio coding rate\n");
 	}
 
-	if (sx1278_bandwidth(arg->fd, arg->radio->bandwidth) == -1) {
+	if (sx1278_bandwidth(&arg->sx1278, arg->radio->bandwidth) == -1) {
 		error("failed to set radio bandwidth\n");
 	}
 
-	if (sx1278_spreading_factor(arg->fd, arg->radio->spreading_factor) == -1) {
+	if (sx1278_spreading_factor(&arg->sx1278, arg->radio->spreading_factor) == -1) {
 		error("failed to set radio spreading factor\n");
 	}
 
-	if (sx1278_checksum(arg->fd, arg->radio->checksum) == -1) {
+	if (sx1278_checksum(&arg->sx1278, arg->radio->checksum) == -1) {
 		error("failed to set radio checksum\n");
 	}
 
-	if (sx1278_sync_word(arg->fd, arg->radio->sync_word) == -1) {
+	if (sx1278_sync_word(&arg->sx1278, arg->radio->sync_word) == -1) {
 		error("failed to set sync word\n");
 	}
 
+	if (sx1278_commit(&arg->sx1278) == -1) {
+		error("failed to apply radio configuration\n");
+	}
+
 	while (true) {
+		pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, NULL);
+
 		uint8_t rx_data[256];
 		uint8_t rx_data_len = 0;
-		if (sx1278_receive(arg->fd, &rx_data, &rx_data_len) == -1) {
+		uint64_t received_at = 0;
+		if (sx1278_receive(&arg->sx1278, &rx_data, &rx_data_len, &received_at) == -1) {
 			error("failed to receive packet\n");
 			continue;
 		}
 
+		pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, NULL);
+
 		if (rx_data_len < 6) {
 			debug("received packet without headers\n");
 			continue;
 		}
 
 		int16_t rssi;
-		if (sx1278_rssi(arg->fd, &rssi) == -1) {
+		if (sx1278_rssi(&arg->sx1278, &rssi) == -1) {
 			error("failed to read packet rssi\n");
 			continue;
 		}
 
 		int8_t snr;
-		if (sx1278_snr(arg->fd, &snr) == -1) {
+		if (sx1278_snr(&arg->sx1278, &snr) == -1) {
 			error("failed to read packet snr\n");
 			continue;
 		}
 
-		rx("id %02x%02x frame %hu kind %02x bytes %hhu rssi %hd snr %.2f sf %hhu power %hhu\n", rx_data[0], rx_data[1],
-			 (uint16_t)(rx_data[2] << 8) | (uint16_t)rx_data[3], rx_data[5], rx_data_len, rssi, snr / 4.0f,
-			 arg->radio->spreading_factor, ((rx_data[4] >> 4) & 0x0f) + 2);
+		shard_t *shard = metric_shard();
+		metric_count(&shard->receives, 1);
+		metric_spread(&shard->rssi, rssi, rssi_origin, rssi_step);
+		metric_spread(&shard->snr, snr / 4, snr_origin, snr_step);
 
 		device_t *device = NULL;
+		ssc128_key_t *key = NULL;
 		for (uint8_t ind = 0; ind < arg->devices_len; ind++) {
 			if (memcmp(&rx_data[0], arg->devices[ind].tag, sizeof(*arg->devices[ind].tag)) == 0) {
 				device = &arg->devices[ind];
+				key = &arg->keys[ind];
 				break;
 			}
 		}
@@ -302,8 +414,82 @@ void *radio_thread(void *args) {
 			continue;
 		}
 
-		ssc128_decrypt(&rx_data[6], rx_data_len - 6, (uint16_t)(rx_data[2] << 8) | (uint16_t)rx_data[3],
-									 (const uint8_t (*)[16])device->key);
+		arg->radio->tx_power = ((rx_data[4] >> 4) & 0x0f) + 2;
+		arg->radio->preamble_len = (rx_data[4] & 0x0f) + 6;
+
+		uint8_t tx_data[256];
+		uint8_t tx_data_len = 0;
+
+		tx_data[tx_data_len] = rx_data[0];
+		tx_data_len += sizeof(rx_data[0]);
+		tx_data[tx_data_len] = rx_data[1];
+		tx_data_len += sizeof(rx_data[1]);
+		tx_data[tx_data_len] = rx_data[2];
+		tx_data_len += sizeof(rx_data[2]);
+		tx_data[tx_data_len] = rx_data[3];
+		tx_data_len += sizeof(rx_data[3]);
+		tx_data[tx_data_len] = (uint8_t)((((arg->radio->tx_power - 2) << 4) & 0xf0) | ((arg->radio->preamble_len - 6) & 0x0f));
+		tx_data_len += sizeof(tx_data[4]);
+
+		bool transmitted = false;
+		uint16_t airtime = 0;
+		uint64_t elapsed = sx1278_now() - received_at;
+		if (elapsed > (uint64_t)reply_deadline * 1000000) {
+			uint64_t overrun = (elapsed - (uint64_t)reply_deadline * 1000000) / 1000;
+			schedule_t schedule;
+			if (schedule_peek(&schedule, (uint8_t (*)[2])(&rx_data[0])) == 0) {
+				warn("missed reply deadline for device %02x%02x by %" PRIu64 "us keeping kind %02x bytes %hhu scheduled\n", rx_data[0],
+						 rx_data[1], overrun, schedule.kind, schedule.data_len);
+			} else {
+				warn("missed reply deadline for device %02x%02x by %" PRIu64 "us\n", rx_data[0], rx_data[1], overrun);
+			}
+			metric_count(&shard->deadline_misses, 1);
+		} else {
+			schedule_t schedule;
+			if (schedule_find(&schedule, (uint8_t (*)[2])(&rx_data[0])) == 0) {
+				tx_data[tx_data_len] = schedule.kind;
+				tx_data_len += sizeof(schedule.kind);
+				memcpy(&tx_data[tx_data_len], schedule.data, schedule.data_len);
+				tx_data_len += schedule.data_len;
+				ssc128_encrypt(&tx_data[6], tx_data_len - 6, (uint16_t)(tx_data[2] << 8) | (uint16_t)tx_data[3], key);
+			} else {
+				tx_data[tx_data_len] = 0x00;
+				tx_data_len += sizeof(uint8_t);
+			}
+			airtime = airtime_calculate(arg->radio, tx_data_len);
+
+			if (sx1278_standby(&arg->sx1278) == -1) {
+				error("failed to enable standby mode\n");
+			}
+
+			sx1278_begin(&arg->sx1278);
+
+			if (sx1278_tx_power(&arg->sx1278, arg->radio->tx_power) == -1) {
+				error("failed to set radio tx power\n");
+			}
+
+			if (sx1278_preamble_length(&arg->sx1278, arg->radio->preamble_len) == -1) {
+				error("failed to set radio preamble length\n");
+			}
+
+			if (sx1278_commit(&arg->sx1278) == -1) {
+				error("failed to apply radio header settings\n");
+			}
+
+			metric_observe(&shard->turnaround, (sx1278_now() - received_at) / 1000);
+			if (sx1278_transmit(&arg->sx1278, &tx_data, tx_data_len, (uint64_t)airtime * 1000000 / 16) == -1) {
+				error("failed to transmit packet\n");
+			} else {
+				metric_count(&shard->transmits, 1);
+				transmitted = true;
+			}
+		}
+
+		rx("id %02x%02x frame %hu kind %02x bytes %hhu rssi %hd snr %.2f sf %hhu power %hhu\n", rx_data[0], rx_data[1],
+			 (uint16_t)(rx_data[2] << 8) | (uint16_t)rx_data[3], rx_data[5], rx_data_len, rssi, snr / 4.0f,
+			 arg->radio->spreading_factor, ((rx_data[4] >> 4) & 0x0f) + 2);
+
+		ssc128_decrypt(&rx_data[6], rx_data_len - 6, (uint16_t)(rx_data[2] << 8) | (uint16_t)rx_data[3], key);
 
 		uplink_t uplink;
 		uplink.frame = (uint16_t)(rx_data[2] << 8) | (uint16_t)rx_data[3];
@@ -319,23 +505,9 @@ void *radio_thread(void *args) {
 		uplink.coding_rate = arg->radio->coding_rate;
 		uplink.tx_power = ((rx_data[4] >> 4) & 0x0f) + 2;
 		uplink.preamble_len = (rx_data[4] & 0x0f) + 6;
-		uplink.received_at = time(NULL);
+		uplink.received_at = radio_realtime(received_at);
 		memcpy(uplink.device_id, device->id, sizeof(*device->id));
-
-		pthread_mutex_lock(&uplinks.lock);
-
-		while (uplinks.size >= uplinks_size) {
-			warn("waiting for uplinks size %hhu to decrease\n", uplinks.size);
-			pthread_cond_wait(&uplinks.available, &uplinks.lock);
-		}
-
-		memcpy(&uplinks.ptr[uplinks.tail], &uplink, sizeof(uplink));
-		uplinks.tail = (uint8_t)((uplinks.tail + 1) % uplinks_size);
-		uplinks.size++;
-		trace("radio thread increased uplinks size to %hhu\n", uplinks.size);
-
-		pthread_cond_signal(&uplinks.filled);
-		pthread_mutex_unlock(&uplinks.lock);
+		radio_uplink(&uplink);
 
 		transmission_t transmission;
 		transmission.timestamp = uplink.received_at;
@@ -352,68 +524,9 @@ void *radio_thread(void *args) {
 		transmission.cr = uplink.coding_rate;
 		transmission.tx_power = uplink.tx_power;
 		transmission.preamble_len = uplink.preamble_len;
+		radio_transmission(&transmission);
 
-		pthread_mutex_lock(&transmissions.lock);
-
-		while (transmissions.size >= transmissions_size) {
-			warn("waiting for transmissions size %hhu to decrease\n", transmissions.size);
-			pthread_cond_wait(&transmissions.available, &transmissions.lock);
-		}
-
-		memcpy(&transmissions.ptr[transmissions.tail], &transmission, sizeof(transmission));
-		transmissions.tail = (uint8_t)((transmissions.tail + 1) % transmissions_size);
-		transmissions.size++;
-		trace("radio thread increased transmissions size to %hhu\n", transmissions.size);
-
-		pthread_cond_signal(&transmissions.filled);
-		pthread_mutex_unlock(&transmissions.lock);
-
-		if (sx1278_standby(arg->fd) == -1) {
-			error("failed to enable standby mode\n");
-		}
-
-		if (arg->radio->tx_power != ((rx_data[4] >> 4) & 0x0f) + 2) {
-			arg->radio->tx_power = ((rx_data[4] >> 4) & 0x0f) + 2;
-			if (sx1278_tx_power(arg->fd, arg->radio->tx_power) == -1) {
-				error("failed to set radio tx power\n");
-			}
-		}
-
-		if (arg->radio->preamble_len != (rx_data[4] & 0x0f) + 6) {
-			arg->radio->preamble_len = (rx_data[4] & 0x0f) + 6;
-			if (sx1278_preamble_length(arg->fd, arg->radio->preamble_len) == -1) {
-				error("failed to set radio preamble length\n");
-			}
-		}
-
-		uint8_t tx_data[256];
-		uint8_t tx_data_len = 0;
-
-		tx_data[tx_data_len] = rx_data[0];
-		tx_data_len += sizeof(rx_data[0]);
-		tx_data[tx_data_len] = rx_data[1];
-		tx_data_len += sizeof(rx_data[1]);
-		tx_data[tx_data_len] = rx_data[2];
-		tx_data_len += sizeof(rx_data[2]);
-		tx_data[tx_data_len] = rx_data[3];
-		tx_data_len += sizeof(rx_data[3]);
-		tx_data[tx_data_len] = (uint8_t)((((arg->radio->tx_power - 2) << 4) & 0xf0) | ((arg->radio->preamble_len - 6) & 0x0f));
-		tx_data_len += sizeof(tx_data[4]);
-		schedule_t schedule;
-		if (schedule_find(&schedule, (uint8_t (*)[2])(&rx_data[0])) == 0) {
-			tx_data[tx_data_len] = schedule.kind;
-			tx_data_len += sizeof(schedule.kind);
-			memcpy(&tx_data[tx_data_len], schedule.data, schedule.data_len);
-			tx_data_len += schedule.data_len;
-			ssc128_encrypt(&tx_data[6], tx_data_len - 6, (uint16_t)(tx_data[2] << 8) | (uint16_t)tx_data[3],
-										 (const uint8_t (*)[16])device->key);
-		} else {
-			tx_data[tx_data_len] = 0x00;
-			tx_data_len += sizeof(uint8_t);
-		}
-
-		if (sx1278_transmit(arg->fd, &tx_data, tx_data_len) == -1) {
-			error("failed to transmit packet\n");
+		if (transmitted == false) {
 			continue;
 		}
 
@@ -421,38 +534,23 @@ void *radio_thread(void *args) {
 			 (uint16_t)(tx_data[2] << 8) | (uint16_t)tx_data[3], tx_data[5], tx_data_len, arg->radio->spreading_factor,
 			 ((tx_data[4] >> 4) & 0x0f) + 2);
 
-		ssc128_decrypt(&tx_data[6], tx_data_len - 6, (uint16_t)(tx_data[2] << 8) | (uint16_t)tx_data[3],
-									 (const uint8_t (*)[16])device->key);
+		ssc128_decrypt(&tx_data[6], tx_data_len - 6, (uint16_t)(tx_data[2] << 8) | (uint16_t)tx_data[3], key);
 
 		downlink_t downlink;
 		downlink.frame = (uint16_t)(tx_data[2] << 8) | (uint16_t)tx_data[3];
 		downlink.kind = tx_data[5];
 		memcpy(downlink.data, &tx_data[6], tx_data_len - 6);
 		downlink.data_len = tx_data_len - 6;
-		downlink.airtime = airtime_calculate(arg->radio, tx_data_len);
+		downlink.airtime = airtime;
 		downlink.frequency = arg->radio->frequency;
 		downlink.bandwidth = arg->radio->bandwidth;
 		downlink.spreading_factor = arg->radio->spreading_factor;
 		downlink.coding_rate = arg->radio->coding_rate;
 		downlink.tx_power = ((tx_data[4] >> 4) & 0x0f) + 2;
 		downlink.preamble_len = (tx_data[4] & 0x0f) + 6;
-		downlink.sent_at = time(NULL);
+		downlink.sent_at = radio_realtime(0);
 		memcpy(downlink.device_id, device->id, sizeof(*device->id));
-
-		pthread_mutex_lock(&downlinks.lock);
-
-		while (downlinks.size >= downlinks_size) {
-			warn("waiting for downlinks size %hhu to decrease\n", downlinks.size);
-			pthread_cond_wait(&downlinks.available, &downlinks.lock);
-		}
-
-		memcpy(&downlinks.ptr[downlinks.tail], &downlink, sizeof(downlink));
-		downlinks.tail = (uint8_t)((downlinks.tail + 1) % downlinks_size);
-		downlinks.size++;
-		trace("radio thread increased downlinks size to %hhu\n", downlinks.size);
-
-		pthread_cond_signal(&downlinks.filled);
-		pthread_mutex_unlock(&downlinks.lock);
+		radio_downlink(&downlink);
 
 		transmission.timestamp = downlink.sent_at;
 		memcpy(transmission.radio_id, arg->radio->id, sizeof(*arg->radio->id));
@@ -468,21 +566,7 @@ void *radio_thread(void *args) {
 		transmission.cr = downlink.coding_rate;
 		transmission.tx_power = downlink.tx_power;
 		transmission.preamble_len = downlink.preamble_len;
-
-		pthread_mutex_lock(&transmissions.lock);
-
-		while (transmissions.size >= transmissions_size) {
-			warn("waiting for transmissions size %hhu to decrease\n", transmissions.size);
-			pthread_cond_wait(&transmissions.available, &transmissions.lock);
-		}
-
-		memcpy(&transmissions.ptr[transmissions.tail], &transmission, sizeof(transmission));
-		transmissions.tail = (uint8_t)((transmissions.tail + 1) % transmissions_size);
-		transmissions.size++;
-		trace("radio thread increased transmissions size to %hhu\n", transmissions.size);
-
-		pthread_cond_signal(&transmissions.filled);
-		pthread_mutex_unlock(&transmissions.lock);
+		radio_transmission(&transmission);
 	}
 }
 
@@ -495,9 +579,7 @@ void radio_reload(sqlite3 *database, response_t *response) {
 		if (pthread_join(comms.workers[index].thread, NULL) == -1) {
 			error("failed to join radio thread %02x%02x\n", (*comms.radios[index].id)[0], (*comms.radios[index].id)[1]);
 		}
-		if (close(comms.workers[index].arg.fd) == -1) {
-			error("failed to close ioctl because %s\n", errno_str());
-		}
+		sx1278_close(&comms.workers[index].arg.sx1278);
 		free(comms.radios[index].id);
 		free(comms.radios[index].device);
 	}
@@ -515,6 +597,8 @@ void radio_reload(sqlite3 *database, response_t *response) {
 	comms.radios_len = 0;
 	free(comms.devices);
 	comms.devices = NULL;
+	free(comms.keys);
+	comms.keys = NULL;
 	comms.devices_len = 0;
 
 	if (radio_init(database) == -1) {
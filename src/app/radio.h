@@ -2,15 +2,21 @@
 
 #include "../api/device.h"
 #include "../api/radio.h"
+#include "../api/transmission.h"
 #include "../lib/response.h"
+#include "../lib/ssc128.h"
+#include "downlink.h"
+#include "sx1278.h"
+#include "uplink.h"
 #include <pthread.h>
 #include <sqlite3.h>
 #include <stdint.h>
 
 typedef struct radio_arg_t {
-	int fd;
+	sx1278_t sx1278;
 	radio_t *radio;
 	device_t *devices;
+	ssc128_key_t *keys;
 	uint8_t devices_len;
 } radio_arg_t;
 
@@ -24,6 +30,7 @@ typedef struct comms_t {
 	radio_t *radios;
 	uint8_t radios_len;
 	device_t *devices;
+	ssc128_key_t *keys;
 	uint8_t devices_len;
 } comms_t;
 
@@ -31,5 +38,9 @@ extern struct comms_t comms;
 
 int radio_init(sqlite3 *database);
 int radio_spawn(pthread_t *thread, void *(*function)(void *), radio_arg_t *arg);
+int radio_uplink(uplink_t *uplink);
+int radio_downlink(downlink_t *downlink);
+int radio_transmission(transmission_t *transmission);
+uint64_t radio_realtime(uint64_t monotonic);
 void *radio_thread(void *args);
 void radio_reload(sqlite3 *database, response_t *response);
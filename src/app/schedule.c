@@ -46,6 +46,23 @@ cleanup:
 	return status;
 }
 
+int schedule_peek(schedule_t *schedule, uint8_t (*device_tag)[2]) {
+	int status = -1;
+
+	pthread_mutex_lock(&schedules.lock);
+
+	for (uint8_t index = 0; index < schedules.len; index++) {
+		if (memcmp(schedules.ptr[index].device_tag, device_tag, sizeof(*device_tag)) == 0) {
+			*schedule = schedules.ptr[index];
+			status = 0;
+			break;
+		}
+	}
+
+	pthread_mutex_unlock(&schedules.lock);
+	return status;
+}
+
 int schedule_find(schedule_t *schedule, uint8_t (*device_tag)[2]) {
 	int status;
 
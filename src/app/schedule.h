@@ -24,4 +24,6 @@ int schedule_init(void);
 
 int schedule_push(schedule_t *schedule);
 
+int schedule_peek(schedule_t *schedule, uint8_t (*device_tag)[2]);
+
 int schedule_find(schedule_t *schedule, uint8_t (*device_tag)[2]);
@@ -1,5 +1,5 @@
 const timestamp = (time) => {
-	const date = new Date(Number(time) * 1000);
+	const date = new Date(Number(time / 1000000n));
 
 	const year = date.getFullYear();
 	const month = (date.getMonth() + 1).toString().padStart(2, '0');
@@ -57,7 +57,6 @@ void serve(file_t *asset, response_t *response) {
 			response->status = 200;
 		}
 		header_write(response, "content-type:%s\r\n", type(asset->path));
-		header_write(response, "content-length:%zu\r\n", asset->len);
 		body_write(response, asset->ptr, asset->len);
 	}
 
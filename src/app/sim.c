@@ -0,0 +1,315 @@
+#include "sim.h"
+#include "../api/radio.h"
+#include "../lib/config.h"
+#include "../lib/error.h"
+#include "../lib/logger.h"
+#include "airtime.h"
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/timerfd.h>
+#include <time.h>
+#include <unistd.h>
+
+const uint32_t sim_bandwidths[] = {7800, 10400, 15600, 20800, 31250, 41700, 62500, 125000, 250000, 500000};
+const uint8_t sim_bandwidths_len = sizeof(sim_bandwidths) / sizeof(*sim_bandwidths);
+
+uint64_t sim_now(void) {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t)now.tv_sec * 1000000000 + (uint64_t)now.tv_nsec;
+}
+
+uint64_t sim_random(sim_t *sim) {
+	sim->seed ^= sim->seed << 13;
+	sim->seed ^= sim->seed >> 7;
+	sim->seed ^= sim->seed << 17;
+	return sim->seed;
+}
+
+sim_t *sim_init(const char *device) {
+	sim_t *sim = calloc(1, sizeof(*sim));
+	if (sim == NULL) {
+		error("failed to allocate %zu bytes for sim because %s\n", sizeof(*sim), errno_str());
+		return NULL;
+	}
+
+	sim->regs[0x01] = 0x09;
+	sim->regs[0x06] = 0x6c;
+	sim->regs[0x07] = 0x80;
+	sim->regs[0x09] = 0x4f;
+	sim->regs[0x0e] = 0x80;
+	sim->regs[0x1d] = 0x72;
+	sim->regs[0x1e] = 0x70;
+	sim->regs[0x21] = 0x08;
+	sim->regs[0x22] = 0x01;
+	sim->regs[0x39] = 0x12;
+	sim->regs[0x42] = 0x12;
+	sim->fsk[0x0d] = 0x0e;
+	sim->fsk[0x0e] = 0x02;
+	sim->fsk[0x0f] = 0x0a;
+	sim->fsk[0x10] = 0xff;
+	sim->fsk[0x12] = 0x15;
+	sim->fsk[0x13] = 0x0b;
+	sim->fsk[0x1f] = 0x40;
+	sim->fsk[0x26] = 0x03;
+	sim->fsk[0x27] = 0x93;
+	sim->fsk[0x30] = 0x90;
+	sim->fsk[0x31] = 0x40;
+	sim->fsk[0x32] = 0x40;
+	sim->fsk[0x35] = 0x0f;
+	sim->fsk[0x39] = 0xf5;
+	sim->fsk[0x3e] = 0x80;
+	sim->fsk[0x3f] = 0x40;
+	sim->dio0 = -1;
+
+	sim->seed = 0x9e3779b97f4a7c15ull ^ sim_now();
+	for (const char *byte = device; *byte != '\0'; byte++) {
+		sim->seed = (sim->seed ^ (uint8_t)*byte) * 0x100000001b3ull;
+	}
+
+	trace("simulating sx1278 on %s\n", device);
+	return sim;
+}
+
+void sim_free(sim_t *sim) {
+	if (sim->missed != 0) {
+		debug("sim missed %u packets while not receiving\n", sim->missed);
+	}
+	debug("sim served %" PRIu64 " spi transfers\n", sim->transfers);
+	if (sim->dio0 != -1) {
+		close(sim->dio0);
+	}
+	free(sim);
+}
+
+void sim_feed(sim_t *sim, device_t *devices, ssc128_key_t *keys, uint8_t devices_len) {
+	sim->devices = devices;
+	sim->keys = keys;
+	sim->devices_len = devices_len;
+}
+
+int sim_dio0(sim_t *sim) {
+	if (sim->dio0 != -1) {
+		return sim->dio0;
+	}
+
+	sim->dio0 = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK);
+	if (sim->dio0 == -1) {
+		error("failed to create simulated dio0 because %s\n", errno_str());
+		return -1;
+	}
+
+	trace("simulating dio0 with timerfd %d\n", sim->dio0);
+	return sim->dio0;
+}
+
+void sim_arm(sim_t *sim) {
+	uint8_t mode = sim->regs[0x01] & 0x07;
+	uint8_t mapping = sim->regs[0x40] & 0xc0;
+
+	uint64_t at = 0;
+	if (mode == 0x03 && mapping == 0x40) {
+		at = sim->tx_done_at;
+	}
+	if ((mode == 0x05 || mode == 0x06) && mapping == 0x00) {
+		at = sim->rx_done_at;
+	}
+	if (at == sim->dio0_at) {
+		return;
+	}
+
+	struct itimerspec spec = {.it_value = {.tv_sec = (time_t)(at / 1000000000), .tv_nsec = (long)(at % 1000000000)}};
+	if (timerfd_settime(sim->dio0, TFD_TIMER_ABSTIME, &spec, NULL) == -1) {
+		error("failed to arm simulated dio0 because %s\n", errno_str());
+		return;
+	}
+	sim->dio0_at = at;
+}
+
+uint64_t sim_duration(sim_t *sim, uint8_t payload_len) {
+	if (sim_airtime == false) {
+		return 1000000;
+	}
+
+	uint8_t bw_bits = sim->regs[0x1d] >> 4;
+	radio_t radio = {
+			.bandwidth = sim_bandwidths[bw_bits < sim_bandwidths_len ? bw_bits : 7],
+			.spreading_factor = sim->regs[0x1e] >> 4,
+			.coding_rate = (uint8_t)(((sim->regs[0x1d] >> 1) & 0x07) + 4),
+			.preamble_len = sim->regs[0x21],
+			.checksum = (sim->regs[0x1e] & 0x04) != 0,
+	};
+	if (radio.spreading_factor < 6 || radio.spreading_factor > 12) {
+		radio.spreading_factor = 7;
+	}
+
+	return (uint64_t)airtime_calculate(&radio, payload_len) * 1000000 / 16;
+}
+
+uint64_t sim_arrival(sim_t *sim) {
+	uint64_t interval = (uint64_t)sim_interval * 1000000;
+	return interval / 2 + sim_random(sim) % (interval + 1);
+}
+
+void sim_generate(sim_t *sim) {
+	if (sim->devices_len == 0) {
+		return;
+	}
+
+	uint8_t index = (uint8_t)(sim_random(sim) % sim->devices_len);
+	uint8_t data_len = (uint8_t)(sim_random(sim) % 33);
+
+	uint8_t packet[6 + 32];
+	memcpy(&packet[0], sim->devices[index].tag, sizeof(*sim->devices[index].tag));
+	packet[2] = (uint8_t)(sim->frame >> 8);
+	packet[3] = (uint8_t)(sim->frame & 0xff);
+	packet[4] = (uint8_t)(((sim->regs[0x09] & 0x0f) << 4) | ((sim->regs[0x21] - 6) & 0x0f));
+	if (sim_random(sim) % 4 == 0) {
+		packet[4] = (uint8_t)sim_random(sim);
+	}
+	packet[5] = (uint8_t)(sim_random(sim) % 4);
+	for (uint8_t byte = 0; byte < data_len; byte++) {
+		packet[6 + byte] = (uint8_t)sim_random(sim);
+	}
+	ssc128_encrypt(&packet[6], data_len, sim->frame, &sim->keys[index]);
+	sim->frame++;
+
+	uint8_t packet_len = 6 + data_len;
+	uint8_t base = sim->regs[0x0f];
+	for (uint8_t byte = 0; byte < packet_len; byte++) {
+		sim->fifo[(uint8_t)(base + byte)] = packet[byte];
+	}
+
+	sim->regs[0x10] = base;
+	sim->regs[0x13] = packet_len;
+	sim->regs[0x19] = (uint8_t)((int)(sim_random(sim) % 81) - 40);
+	sim->regs[0x1a] = (uint8_t)(40 + sim_random(sim) % 61);
+	sim->regs[0x12] |= 0x50;
+}
+
+uint8_t *sim_reg(sim_t *sim, uint8_t reg) {
+	if (reg >= 0x0d && reg <= 0x3f && (sim->regs[0x01] & 0xc0) != 0x80) {
+		return &sim->fsk[reg];
+	}
+	return &sim->regs[reg];
+}
+
+void sim_advance(sim_t *sim, uint64_t now) {
+	if ((sim->regs[0x01] & 0x80) == 0) {
+		return;
+	}
+
+	uint8_t mode = sim->regs[0x01] & 0x07;
+
+	if (mode == 0x03 && now >= sim->tx_done_at) {
+		sim->regs[0x12] |= 0x08;
+		sim->regs[0x01] = (sim->regs[0x01] & 0xf8) | 0x01;
+	}
+
+	if ((mode == 0x05 || mode == 0x06) && now >= sim->rx_done_at) {
+		sim_generate(sim);
+		sim->rx_done_at = now + sim_arrival(sim);
+		if (mode == 0x06) {
+			sim->regs[0x01] = (sim->regs[0x01] & 0xf8) | 0x01;
+		}
+	}
+}
+
+void sim_write(sim_t *sim, uint8_t reg, uint8_t value, uint64_t now) {
+	if (reg == 0x01) {
+		uint8_t from = sim->regs[0x01] & 0x07;
+		uint8_t to = value & 0x07;
+		if (from != 0x00) {
+			value = (uint8_t)((value & 0x7f) | (sim->regs[0x01] & 0x80));
+		}
+		sim->regs[0x01] = value;
+		if ((value & 0x80) == 0) {
+			return;
+		}
+		if (to == 0x03 && from != 0x03) {
+			sim->tx_done_at = now + sim_duration(sim, sim->regs[0x22]);
+		}
+		if ((to == 0x05 || to == 0x06) && from != 0x05 && from != 0x06) {
+			if (sim->rx_done_at == 0) {
+				sim->rx_done_at = now + sim_arrival(sim);
+			}
+			while (sim->rx_done_at < now) {
+				sim->rx_done_at += sim_arrival(sim);
+				sim->missed++;
+			}
+		}
+		return;
+	}
+
+	if (sim_reg(sim, reg) == &sim->fsk[reg]) {
+		sim->fsk[reg] = value;
+		return;
+	}
+
+	if (reg == 0x12) {
+		sim->regs[0x12] &= (uint8_t)~value;
+		return;
+	}
+
+	if (reg == 0x10 || reg == 0x13 || reg == 0x19 || reg == 0x1a || reg == 0x42) {
+		return;
+	}
+
+	sim->regs[reg] = value;
+}
+
+int sim_transfer(spi_t *spi, const uint8_t *tx_buf, uint8_t *rx_buf, uint16_t len) {
+	sim_t *sim = spi->sim;
+	uint64_t now = sim_now();
+	sim_advance(sim, now);
+	sim->transfers++;
+
+	bool write = (tx_buf[0] & 0x80) != 0;
+	uint8_t reg = tx_buf[0] & 0x7f;
+	rx_buf[0] = 0x00;
+
+	for (uint16_t index = 1; index < len; index++) {
+		if (reg == 0x00) {
+			if (write) {
+				sim->fifo[sim->regs[0x0d]] = tx_buf[index];
+			} else {
+				rx_buf[index] = sim->fifo[sim->regs[0x0d]];
+			}
+			sim->regs[0x0d]++;
+			continue;
+		}
+
+		if (write) {
+			sim_write(sim, reg, tx_buf[index], now);
+		} else {
+			rx_buf[index] = *sim_reg(sim, reg);
+		}
+		reg = (reg + 1) & 0x7f;
+	}
+
+	if (sim->dio0 != -1) {
+		sim_arm(sim);
+	}
+
+	return 0;
+}
+
+int sim_batch(spi_t *spi, const uint8_t (*writes)[2], uint8_t len) {
+	sim_t *sim = spi->sim;
+	uint64_t now = sim_now();
+	sim_advance(sim, now);
+	sim->transfers++;
+
+	for (uint8_t index = 0; index < len; index++) {
+		sim_write(sim, writes[index][0] & 0x7f, writes[index][1], now);
+	}
+
+	if (sim->dio0 != -1) {
+		sim_arm(sim);
+	}
+
+	return 0;
+}
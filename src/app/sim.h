@@ -0,0 +1,31 @@
+#pragma once
+
+#include "../api/device.h"
+#include "../lib/ssc128.h"
+#include "spi.h"
+#include <stdint.h>
+
+typedef struct sim_t {
+	uint8_t regs[128];
+	uint8_t fsk[128];
+	uint8_t fifo[256];
+	uint64_t tx_done_at;
+	uint64_t rx_done_at;
+	uint64_t seed;
+	uint16_t frame;
+	uint32_t missed;
+	uint64_t transfers;
+	int dio0;
+	uint64_t dio0_at;
+	device_t *devices;
+	ssc128_key_t *keys;
+	uint8_t devices_len;
+} sim_t;
+
+sim_t *sim_init(const char *device);
+void sim_free(sim_t *sim);
+void sim_feed(sim_t *sim, device_t *devices, ssc128_key_t *keys, uint8_t devices_len);
+int sim_dio0(sim_t *sim);
+
+int sim_transfer(spi_t *spi, const uint8_t *tx_buf, uint8_t *rx_buf, uint16_t len);
+int sim_batch(spi_t *spi, const uint8_t (*writes)[2], uint8_t len);
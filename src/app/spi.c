@@ -1,54 +1,199 @@
+#include "spi.h"
 #include "../lib/error.h"
 #include "../lib/logger.h"
+#include "sim.h"
+#include <errno.h>
 #include <fcntl.h>
 #include <linux/spi/spidev.h>
 #include <pthread.h>
 #include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
 #include <sys/ioctl.h>
+#include <unistd.h>
 
-pthread_mutex_t spi_mutex = PTHREAD_MUTEX_INITIALIZER;
+spi_buses_t spi_buses = {
+		.ptr = {NULL},
+		.lock = PTHREAD_MUTEX_INITIALIZER,
+};
 
-int spi_init(const char *device, const uint8_t mode, const uint32_t speed, const uint8_t word_len) {
-	int fd = open(device, O_RDWR);
+const uint8_t spi_buses_len = sizeof(spi_buses.ptr) / sizeof(*spi_buses.ptr);
 
-	if (fd == -1) {
-		error("failed to open %s because %s\n", device, errno_str());
+spi_bus_t *spi_bus_acquire(const char *device) {
+	const char *dot = strrchr(device, '.');
+	size_t name_len = dot == NULL ? strlen(device) : (size_t)(dot - device);
+	if (name_len >= sizeof(((spi_bus_t *)0)->name)) {
+		error("spi bus name %s exceeds %zu bytes\n", device, sizeof(((spi_bus_t *)0)->name) - 1);
+		return NULL;
+	}
+
+	spi_bus_t *bus = NULL;
+	pthread_mutex_lock(&spi_buses.lock);
+
+	for (uint8_t index = 0; index < spi_buses_len; index++) {
+		spi_bus_t *candidate = spi_buses.ptr[index];
+		if (candidate != NULL && strlen(candidate->name) == name_len && memcmp(candidate->name, device, name_len) == 0) {
+			bus = candidate;
+			bus->users++;
+			goto cleanup;
+		}
+	}
+
+	for (uint8_t index = 0; index < spi_buses_len; index++) {
+		if (spi_buses.ptr[index] == NULL) {
+			bus = malloc(sizeof(*bus));
+			if (bus == NULL) {
+				error("failed to allocate %zu bytes for spi bus because %s\n", sizeof(*bus), errno_str());
+				goto cleanup;
+			}
+			memcpy(bus->name, device, name_len);
+			bus->name[name_len] = '\0';
+			pthread_mutex_init(&bus->lock, NULL);
+			bus->users = 1;
+			spi_buses.ptr[index] = bus;
+			trace("opened spi bus %s\n", bus->name);
+			goto cleanup;
+		}
+	}
+
+	error("spi buses exceed %hhu\n", spi_buses_len);
+
+cleanup:
+	pthread_mutex_unlock(&spi_buses.lock);
+	return bus;
+}
+
+void spi_bus_release(spi_bus_t *bus) {
+	pthread_mutex_lock(&spi_buses.lock);
+
+	bus->users--;
+	if (bus->users == 0) {
+		for (uint8_t index = 0; index < spi_buses_len; index++) {
+			if (spi_buses.ptr[index] == bus) {
+				spi_buses.ptr[index] = NULL;
+			}
+		}
+		trace("closed spi bus %s\n", bus->name);
+		pthread_mutex_destroy(&bus->lock);
+		free(bus);
+	}
+
+	pthread_mutex_unlock(&spi_buses.lock);
+}
+
+int spi_init(spi_t *spi, const char *device, const uint8_t mode, const uint32_t speed, const uint8_t word_len) {
+	spi->fd = -1;
+	spi->sim = NULL;
+	spi->mode = mode;
+	spi->speed = speed;
+	spi->word_len = word_len;
+
+	spi->bus = spi_bus_acquire(device);
+	if (spi->bus == NULL) {
 		return -1;
 	}
 
-	if (ioctl(fd, SPI_IOC_WR_MODE, &mode) == -1) {
+	if (strncmp(device, "sim", 3) == 0) {
+		spi->sim = sim_init(device);
+		if (spi->sim == NULL) {
+			goto cleanup;
+		}
+		spi->transfer = &sim_transfer;
+		spi->batch = &sim_batch;
+		return 0;
+	}
+
+	spi->fd = open(device, O_RDWR);
+	spi->transfer = &spi_transfer;
+	spi->batch = &spi_batch;
+
+	if (spi->fd == -1) {
+		error("failed to open %s because %s\n", device, errno_str());
+		goto cleanup;
+	}
+
+	if (ioctl(spi->fd, SPI_IOC_WR_MODE, &mode) == -1) {
 		error("failed to set spi mode because %s\n", errno_str());
-		return -1;
+		goto cleanup;
 	}
 
-	if (ioctl(fd, SPI_IOC_WR_MAX_SPEED_HZ, &speed) == -1) {
+	if (ioctl(spi->fd, SPI_IOC_WR_MAX_SPEED_HZ, &speed) == -1) {
 		error("failed to set spi speed because %s\n", errno_str());
-		return -1;
+		goto cleanup;
 	}
 
-	if (ioctl(fd, SPI_IOC_WR_BITS_PER_WORD, &word_len) == -1) {
+	if (ioctl(spi->fd, SPI_IOC_WR_BITS_PER_WORD, &word_len) == -1) {
 		error("failed to set spi word len because %s\n", errno_str());
-		return -1;
+		goto cleanup;
 	}
 
-	return fd;
+	return 0;
+
+cleanup:
+	spi_close(spi);
+	return -1;
 }
 
-int spi_read_register(int fd, uint8_t reg, uint8_t *value) {
-	int status;
+void spi_close(spi_t *spi) {
+	if (spi->sim != NULL) {
+		sim_free(spi->sim);
+		spi->sim = NULL;
+	}
 
-	pthread_mutex_lock(&spi_mutex);
+	if (spi->fd != -1 && close(spi->fd) == -1) {
+		error("failed to close ioctl because %s\n", errno_str());
+	}
+	spi->fd = -1;
 
-	uint8_t tx_buf[2] = {reg & 0x7f, 0x00};
-	uint8_t rx_buf[2];
+	if (spi->bus != NULL) {
+		spi_bus_release(spi->bus);
+		spi->bus = NULL;
+	}
+}
 
+int spi_transfer(spi_t *spi, const uint8_t *tx_buf, uint8_t *rx_buf, uint16_t len) {
 	struct spi_ioc_transfer transfer = {
 			.tx_buf = (uint64_t)tx_buf,
 			.rx_buf = (uint64_t)rx_buf,
-			.len = sizeof(tx_buf),
+			.len = len,
+			.speed_hz = spi->speed,
+			.bits_per_word = spi->word_len,
 	};
 
-	if (ioctl(fd, SPI_IOC_MESSAGE(1), &transfer) == -1) {
+	return ioctl(spi->fd, SPI_IOC_MESSAGE(1), &transfer) == -1 ? -1 : 0;
+}
+
+int spi_batch(spi_t *spi, const uint8_t (*writes)[2], uint8_t len) {
+	uint8_t tx_bufs[32][2];
+	struct spi_ioc_transfer transfers[32];
+	if (len > sizeof(transfers) / sizeof(*transfers)) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	memset(transfers, 0, len * sizeof(*transfers));
+	for (uint8_t index = 0; index < len; index++) {
+		tx_bufs[index][0] = writes[index][0] | 0x80;
+		tx_bufs[index][1] = writes[index][1];
+		transfers[index].tx_buf = (uint64_t)tx_bufs[index];
+		transfers[index].len = sizeof(tx_bufs[index]);
+		transfers[index].speed_hz = spi->speed;
+		transfers[index].bits_per_word = spi->word_len;
+		transfers[index].cs_change = index + 1 < len;
+	}
+
+	return ioctl(spi->fd, SPI_IOC_MESSAGE(len), transfers) == -1 ? -1 : 0;
+}
+
+int spi_read_register(spi_t *spi, uint8_t reg, uint8_t *value) {
+	int status;
+
+	pthread_mutex_lock(&spi->bus->lock);
+
+	uint8_t tx_buf[2] = {reg & 0x7f, 0x00};
+	uint8_t rx_buf[2];
+
+	if (spi->transfer(spi, tx_buf, rx_buf, sizeof(tx_buf)) == -1) {
 		error("failed to read register %02x because %s\n", reg, errno_str());
 		status = -1;
 		goto cleanup;
@@ -58,25 +203,19 @@ int spi_read_register(int fd, uint8_t reg, uint8_t *value) {
 	status = 0;
 
 cleanup:
-	pthread_mutex_unlock(&spi_mutex);
+	pthread_mutex_unlock(&spi->bus->lock);
 	return status;
 }
 
-int spi_write_register(int fd, uint8_t reg, uint8_t value) {
+int spi_write_register(spi_t *spi, uint8_t reg, uint8_t value) {
 	int status;
 
-	pthread_mutex_lock(&spi_mutex);
+	pthread_mutex_lock(&spi->bus->lock);
 
 	uint8_t tx_buf[2] = {reg | 0x80, value};
 	uint8_t rx_buf[2];
 
-	struct spi_ioc_transfer transfer = {
-			.tx_buf = (uint64_t)tx_buf,
-			.rx_buf = (uint64_t)rx_buf,
-			.len = sizeof(tx_buf),
-	};
-
-	if (ioctl(fd, SPI_IOC_MESSAGE(1), &transfer) == -1) {
+	if (spi->transfer(spi, tx_buf, rx_buf, sizeof(tx_buf)) == -1) {
 		error("failed to write register %02x because %s\n", reg, errno_str());
 		status = -1;
 		goto cleanup;
@@ -85,6 +224,68 @@ int spi_write_register(int fd, uint8_t reg, uint8_t value) {
 	status = 0;
 
 cleanup:
-	pthread_mutex_unlock(&spi_mutex);
+	pthread_mutex_unlock(&spi->bus->lock);
+	return status;
+}
+
+int spi_read_burst(spi_t *spi, uint8_t reg, uint8_t *data, uint8_t len) {
+	int status;
+
+	pthread_mutex_lock(&spi->bus->lock);
+
+	uint8_t tx_buf[256] = {reg & 0x7f};
+	uint8_t rx_buf[256];
+
+	if (spi->transfer(spi, tx_buf, rx_buf, (uint16_t)(len + 1)) == -1) {
+		error("failed to read %hhu bytes from register %02x because %s\n", len, reg, errno_str());
+		status = -1;
+		goto cleanup;
+	}
+
+	memcpy(data, &rx_buf[1], len);
+	status = 0;
+
+cleanup:
+	pthread_mutex_unlock(&spi->bus->lock);
+	return status;
+}
+
+int spi_write_burst(spi_t *spi, uint8_t reg, const uint8_t *data, uint8_t len) {
+	int status;
+
+	pthread_mutex_lock(&spi->bus->lock);
+
+	uint8_t tx_buf[256] = {reg | 0x80};
+	uint8_t rx_buf[256];
+	memcpy(&tx_buf[1], data, len);
+
+	if (spi->transfer(spi, tx_buf, rx_buf, (uint16_t)(len + 1)) == -1) {
+		error("failed to write %hhu bytes to register %02x because %s\n", len, reg, errno_str());
+		status = -1;
+		goto cleanup;
+	}
+
+	status = 0;
+
+cleanup:
+	pthread_mutex_unlock(&spi->bus->lock);
+	return status;
+}
+
+int spi_write_batch(spi_t *spi, const uint8_t (*writes)[2], uint8_t len) {
+	int status;
+
+	pthread_mutex_lock(&spi->bus->lock);
+
+	if (spi->batch(spi, writes, len) == -1) {
+		error("failed to write %hhu registers in one message because %s\n", len, errno_str());
+		status = -1;
+		goto cleanup;
+	}
+
+	status = 0;
+
+cleanup:
+	pthread_mutex_unlock(&spi->bus->lock);
 	return status;
 }
@@ -1,8 +1,48 @@
 #pragma once
 
+#include <pthread.h>
 #include <stdint.h>
 
-int spi_init(const char *device, const uint8_t mode, const uint32_t speed, const uint8_t word_len);
+typedef struct sim_t sim_t;
 
-int spi_read_register(int fd, uint8_t reg, uint8_t *value);
-int spi_write_register(int fd, uint8_t reg, uint8_t value);
+typedef struct spi_bus_t {
+	char name[32];
+	pthread_mutex_t lock;
+	uint8_t users;
+} spi_bus_t;
+
+typedef struct spi_buses_t {
+	spi_bus_t *ptr[32];
+	pthread_mutex_t lock;
+} spi_buses_t;
+
+typedef struct spi_t {
+	int fd;
+	sim_t *sim;
+	spi_bus_t *bus;
+	uint8_t mode;
+	uint32_t speed;
+	uint8_t word_len;
+	int (*transfer)(struct spi_t *spi, const uint8_t *tx_buf, uint8_t *rx_buf, uint16_t len);
+	int (*batch)(struct spi_t *spi, const uint8_t (*writes)[2], uint8_t len);
+} spi_t;
+
+extern struct spi_buses_t spi_buses;
+extern const uint8_t spi_buses_len;
+
+int spi_init(spi_t *spi, const char *device, const uint8_t mode, const uint32_t speed, const uint8_t word_len);
+void spi_close(spi_t *spi);
+
+spi_bus_t *spi_bus_acquire(const char *device);
+void spi_bus_release(spi_bus_t *bus);
+
+int spi_transfer(spi_t *spi, const uint8_t *tx_buf, uint8_t *rx_buf, uint16_t len);
+int spi_batch(spi_t *spi, const uint8_t (*writes)[2], uint8_t len);
+
+int spi_read_register(spi_t *spi, uint8_t reg, uint8_t *value);
+int spi_write_register(spi_t *spi, uint8_t reg, uint8_t value);
+
+int spi_read_burst(spi_t *spi, uint8_t reg, uint8_t *data, uint8_t len);
+int spi_write_burst(spi_t *spi, uint8_t reg, const uint8_t *data, uint8_t len);
+
+int spi_write_batch(spi_t *spi, const uint8_t (*writes)[2], uint8_t len);
@@ -1,9 +1,16 @@
 #include "../lib/format.h"
 #include "../lib/logger.h"
+#include "../lib/metrics.h"
+#include "gpio.h"
 #include "spi.h"
+#include "sx1278.h"
+#include <errno.h>
+#include <inttypes.h>
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <string.h>
+#include <time.h>
 #include <unistd.h>
 
 const uint8_t reg_fifo = 0x00;
@@ -25,110 +32,284 @@ const uint8_t reg_payload_len = 0x22;
 const uint8_t reg_modem_config_1 = 0x1d;
 const uint8_t reg_modem_config_2 = 0x1e;
 const uint8_t reg_sync_word = 0x39;
+const uint8_t reg_dio_mapping_1 = 0x40;
 
-int sx1278_sleep(int fd) {
-	if (spi_write_register(fd, reg_op_mode, 0x80) == -1) {
+const uint8_t shadow_regs[] = {0x06, 0x07, 0x08, 0x09, 0x0e, 0x0f, 0x1d, 0x1e, 0x20, 0x21, 0x22, 0x39, 0x40};
+const uint8_t shadow_regs_len = sizeof(shadow_regs) / sizeof(*shadow_regs);
+
+const uint64_t tx_guard = 2000000;
+
+bool sx1278_cacheable(sx1278_t *sx1278, uint8_t reg) {
+	if (reg >= 0x0d && reg <= 0x3f && sx1278->lora == false) {
+		return false;
+	}
+	for (uint8_t index = 0; index < shadow_regs_len; index++) {
+		if (shadow_regs[index] == reg) {
+			return true;
+		}
+	}
+	return false;
+}
+
+int sx1278_init(sx1278_t *sx1278, const char *device) {
+	sx1278->spi = (spi_t){.fd = -1, .sim = NULL, .bus = NULL};
+	sx1278->dio0 = (gpio_t){.fd = -1, .simulated = false};
+
+	char spi[64];
+	const char *at = strchr(device, '@');
+	snprintf(spi, sizeof(spi), "%.*s", at == NULL ? (int)strlen(device) : (int)(at - device), device);
+
+	if (spi_init(&sx1278->spi, spi, 0, 8 * 1000 * 1000, 8) == -1) {
 		return -1;
-	};
+	}
 
-	uint8_t op_mode;
-	while (true) {
-		if (spi_read_register(fd, reg_op_mode, &op_mode) == -1) {
+	memset(sx1278->cached, false, sizeof(sx1278->cached));
+	sx1278->pending_len = 0;
+	sx1278->batching = false;
+	if (spi_read_burst(&sx1278->spi, reg_op_mode, &sx1278->shadow[reg_op_mode], reg_dio_mapping_1) == -1) {
+		sx1278_close(sx1278);
+		return -1;
+	}
+	sx1278->mode = sx1278->shadow[reg_op_mode] & 0x07;
+	sx1278->lora = (sx1278->shadow[reg_op_mode] & 0xc0) == 0x80;
+	sx1278->armed_at = 0;
+	for (uint8_t index = 0; index < shadow_regs_len; index++) {
+		sx1278->cached[shadow_regs[index]] = sx1278_cacheable(sx1278, shadow_regs[index]);
+	}
+
+	if (at != NULL && gpio_init(&sx1278->dio0, at + 1, sx1278->spi.sim) == -1) {
+		sx1278_close(sx1278);
+		return -1;
+	}
+
+	return 0;
+}
+
+void sx1278_close(sx1278_t *sx1278) {
+	gpio_close(&sx1278->dio0);
+	spi_close(&sx1278->spi);
+}
+
+
+int sx1278_flush(sx1278_t *sx1278) {
+	if (sx1278->pending_len == 0) {
+		return 0;
+	}
+
+	uint8_t pending_len = sx1278->pending_len;
+	sx1278->pending_len = 0;
+	if (spi_write_batch(&sx1278->spi, (const uint8_t (*)[2])sx1278->pending, pending_len) == -1) {
+		memset(sx1278->cached, false, sizeof(sx1278->cached));
+		return -1;
+	}
+
+	trace("flushed %hhu register writes\n", pending_len);
+	return 0;
+}
+
+int sx1278_read(sx1278_t *sx1278, uint8_t reg, uint8_t *value) {
+	if (sx1278->cached[reg] == true) {
+		*value = sx1278->shadow[reg];
+		return 0;
+	}
+
+	if (sx1278->batching == true && sx1278_flush(sx1278) == -1) {
+		return -1;
+	}
+
+	if (spi_read_register(&sx1278->spi, reg, value) == -1) {
+		return -1;
+	}
+
+	if (sx1278_cacheable(sx1278, reg) == true) {
+		sx1278->shadow[reg] = *value;
+		sx1278->cached[reg] = true;
+	}
+	return 0;
+}
+
+int sx1278_write(sx1278_t *sx1278, uint8_t reg, uint8_t value) {
+	if (sx1278->cached[reg] == true && sx1278->shadow[reg] == value) {
+		return 0;
+	}
+
+	if (sx1278_cacheable(sx1278, reg) == false) {
+		if (sx1278->batching == true && sx1278_flush(sx1278) == -1) {
 			return -1;
-		};
-		if ((op_mode & 0x07) == 0x00) {
-			break;
 		}
-		usleep(500);
+		return spi_write_register(&sx1278->spi, reg, value);
 	}
 
-	trace("sleep op_mode 0x%02x\n", op_mode);
+	sx1278->shadow[reg] = value;
+	sx1278->cached[reg] = true;
+
+	if (sx1278->batching == false) {
+		if (spi_write_register(&sx1278->spi, reg, value) == -1) {
+			sx1278->cached[reg] = false;
+			return -1;
+		}
+		return 0;
+	}
+
+	for (uint8_t index = 0; index < sx1278->pending_len; index++) {
+		if (sx1278->pending[index][0] == reg) {
+			sx1278->pending[index][1] = value;
+			return 0;
+		}
+	}
+
+	if (sx1278->pending_len == sizeof(sx1278->pending) / sizeof(*sx1278->pending) && sx1278_flush(sx1278) == -1) {
+		return -1;
+	}
+	sx1278->pending[sx1278->pending_len][0] = reg;
+	sx1278->pending[sx1278->pending_len][1] = value;
+	sx1278->pending_len++;
 	return 0;
 }
 
-int sx1278_standby(int fd) {
-	if (spi_write_register(fd, reg_op_mode, 0x81) == -1) {
+void sx1278_begin(sx1278_t *sx1278) {
+	sx1278->batching = true;
+}
+
+int sx1278_commit(sx1278_t *sx1278) {
+	sx1278->batching = false;
+	return sx1278_flush(sx1278);
+}
+
+int sx1278_mode(sx1278_t *sx1278, uint8_t mode, const char *name) {
+	if (sx1278_write(sx1278, reg_op_mode, mode) == -1) {
 		return -1;
 	};
 
 	uint8_t op_mode;
+	useconds_t delay = 50;
 	while (true) {
-		if (spi_read_register(fd, reg_op_mode, &op_mode) == -1) {
+		if (sx1278_read(sx1278, reg_op_mode, &op_mode) == -1) {
 			return -1;
 		};
-		if ((op_mode & 0x07) == 0x01) {
+		if ((op_mode & 0x07) == (mode & 0x07)) {
 			break;
 		}
-		usleep(500);
+		usleep(delay);
+		delay = delay * 2 > 500 ? 500 : delay * 2;
 	}
 
-	trace("standby op_mode 0x%02x\n", op_mode);
+	sx1278->mode = op_mode & 0x07;
+	bool lora = (op_mode & 0xc0) == 0x80;
+	if (lora != sx1278->lora) {
+		trace("switched to %s register bank\n", lora == true ? "lora" : "fsk");
+		memset(&sx1278->cached[0x0d], false, 0x3f - 0x0d + 1);
+		sx1278->lora = lora;
+	}
+	trace("%s op_mode 0x%02x\n", name, op_mode);
 	return 0;
 }
 
-int sx1278_tx(int fd) {
-	if (spi_write_register(fd, reg_op_mode, 0x83) == -1) {
+uint64_t sx1278_now(void) {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t)now.tv_sec * 1000000000 + (uint64_t)now.tv_nsec;
+}
+
+int sx1278_await(sx1278_t *sx1278, uint8_t mask, uint8_t *irq_flags, uint64_t *done_at) {
+	useconds_t delay = 500;
+	uint64_t edge_at = 0;
+	if (sx1278->dio0.fd != -1 && gpio_drain(&sx1278->dio0, sx1278->armed_at, &edge_at) == -1) {
 		return -1;
-	};
+	}
 
-	uint8_t op_mode;
 	while (true) {
-		if (spi_read_register(fd, reg_op_mode, &op_mode) == -1) {
+		if (sx1278_read(sx1278, reg_irq_flags, irq_flags) == -1) {
 			return -1;
 		};
-		if ((op_mode & 0x07) == 0x03) {
-			break;
+		if (*irq_flags & mask) {
+			*done_at = edge_at != 0 ? edge_at : sx1278_now();
+			return 0;
 		}
-		usleep(500);
-	}
 
-	trace("transmit op_mode 0x%02x\n", op_mode);
-	return 0;
+		if (sx1278->dio0.fd != -1) {
+			if (gpio_wait(&sx1278->dio0, 1000, sx1278->armed_at, &edge_at) == -1) {
+				return -1;
+			}
+			continue;
+		}
+
+		usleep(*irq_flags & 0x10 ? 500 : delay);
+		delay = delay * 2 > 4000 ? 4000 : delay * 2;
+	}
 }
 
-int sx1278_rx(int fd) {
-	if (spi_write_register(fd, reg_op_mode, 0x85) == -1) {
-		return -1;
-	};
+int sx1278_predict(sx1278_t *sx1278, uint64_t predicted_at, uint8_t *irq_flags, uint64_t *done_at) {
+	uint64_t wake_at = predicted_at - tx_guard;
+	struct timespec deadline = {.tv_sec = (time_t)(wake_at / 1000000000), .tv_nsec = (long)(wake_at % 1000000000)};
+	while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL) == EINTR) {
+	}
 
-	uint8_t op_mode;
 	while (true) {
-		if (spi_read_register(fd, reg_op_mode, &op_mode) == -1) {
+		if (sx1278_read(sx1278, reg_irq_flags, irq_flags) == -1) {
 			return -1;
 		};
-		if ((op_mode & 0x07) == 0x05) {
-			break;
+		uint64_t now = sx1278_now();
+		if (*irq_flags & 0x08) {
+			*done_at = now;
+			return 0;
 		}
-		usleep(500);
+		if (now >= predicted_at + tx_guard * 8) {
+			debug("transmit overran predicted airtime by %" PRIu64 "us\n", (now - predicted_at) / 1000);
+			return 0;
+		}
+		usleep(100);
 	}
+}
 
-	trace("receive op_mode 0x%02x\n", op_mode);
-	return 0;
+int sx1278_sleep(sx1278_t *sx1278) {
+	return sx1278_mode(sx1278, 0x80, "sleep");
+}
+
+int sx1278_standby(sx1278_t *sx1278) {
+	return sx1278_mode(sx1278, 0x81, "standby");
+}
+
+int sx1278_tx(sx1278_t *sx1278) {
+	return sx1278_mode(sx1278, 0x83, "transmit");
+}
+
+int sx1278_rx(sx1278_t *sx1278) {
+	return sx1278_mode(sx1278, 0x85, "receive");
+}
+
+int sx1278_listen(sx1278_t *sx1278) {
+	if (sx1278->dio0.fd != -1 && sx1278_write(sx1278, reg_dio_mapping_1, 0x00) == -1) {
+		return -1;
+	}
+
+	sx1278->armed_at = sx1278_now();
+	return sx1278_rx(sx1278);
 }
 
-int sx1278_frequency(int fd, uint32_t frequency) {
+int sx1278_frequency(sx1278_t *sx1278, uint32_t frequency) {
 	uint32_t frf = (uint32_t)(frequency * (1ull << 19) / (32 * 1000 * 1000));
 
-	if (spi_write_register(fd, reg_frf_msb, (frf >> 16) & 0xff) == -1) {
+	if (sx1278_write(sx1278, reg_frf_msb, (frf >> 16) & 0xff) == -1) {
 		return -1;
 	}
-	if (spi_write_register(fd, reg_frf_mid, (frf >> 8) & 0xff) == -1) {
+	if (sx1278_write(sx1278, reg_frf_mid, (frf >> 8) & 0xff) == -1) {
 		return -1;
 	}
-	if (spi_write_register(fd, reg_frf_lsb, frf & 0xff) == -1) {
+	if (sx1278_write(sx1278, reg_frf_lsb, frf & 0xff) == -1) {
 		return -1;
 	}
 
 	uint8_t frf_msb;
 	uint8_t frf_mid;
 	uint8_t frf_lsb;
-	if (spi_read_register(fd, reg_frf_msb, &frf_msb) == -1) {
+	if (sx1278_read(sx1278, reg_frf_msb, &frf_msb) == -1) {
 		return -1;
 	}
-	if (spi_read_register(fd, reg_frf_mid, &frf_mid) == -1) {
+	if (sx1278_read(sx1278, reg_frf_mid, &frf_mid) == -1) {
 		return -1;
 	}
-	if (spi_read_register(fd, reg_frf_lsb, &frf_lsb) == -1) {
+	if (sx1278_read(sx1278, reg_frf_lsb, &frf_lsb) == -1) {
 		return -1;
 	}
 
@@ -136,19 +317,19 @@ int sx1278_frequency(int fd, uint32_t frequency) {
 	return 0;
 }
 
-int sx1278_tx_power(int fd, uint8_t power) {
+int sx1278_tx_power(sx1278_t *sx1278, uint8_t power) {
 	if (power < 2 || power > 17) {
 		error("tx power must be between %d and %d\n", 2, 17);
 		return -1;
 	}
 
 	uint8_t pa_config = 0x80 | (power - 2);
-	if (spi_write_register(fd, reg_pa_config, pa_config) == -1) {
+	if (sx1278_write(sx1278, reg_pa_config, pa_config) == -1) {
 		return -1;
 	}
 
 	uint8_t value;
-	if (spi_read_register(fd, reg_pa_config, &value) == -1) {
+	if (sx1278_read(sx1278, reg_pa_config, &value) == -1) {
 		return -1;
 	}
 
@@ -156,7 +337,7 @@ int sx1278_tx_power(int fd, uint8_t power) {
 	return 0;
 }
 
-int sx1278_preamble_length(int fd, uint16_t len) {
+int sx1278_preamble_length(sx1278_t *sx1278, uint16_t len) {
 	if (len < 6 || len > 21) {
 		error("preamble length must be between %d and %d\n", 6, 21);
 		return -1;
@@ -165,17 +346,17 @@ int sx1278_preamble_length(int fd, uint16_t len) {
 	uint8_t msb = (uint8_t)((len >> 8) & 0xff);
 	uint8_t lsb = (uint8_t)(len & 0xff);
 
-	if (spi_write_register(fd, reg_preamble_msb, msb) == -1) {
+	if (sx1278_write(sx1278, reg_preamble_msb, msb) == -1) {
 		return -1;
 	}
-	if (spi_write_register(fd, reg_preamble_lsb, lsb) == -1) {
+	if (sx1278_write(sx1278, reg_preamble_lsb, lsb) == -1) {
 		return -1;
 	}
 
-	if (spi_read_register(fd, reg_preamble_msb, &msb) == -1) {
+	if (sx1278_read(sx1278, reg_preamble_msb, &msb) == -1) {
 		return -1;
 	}
-	if (spi_read_register(fd, reg_preamble_lsb, &lsb) == -1) {
+	if (sx1278_read(sx1278, reg_preamble_lsb, &lsb) == -1) {
 		return -1;
 	}
 
@@ -183,25 +364,25 @@ int sx1278_preamble_length(int fd, uint16_t len) {
 	return 0;
 }
 
-int sx1278_coding_rate(int fd, uint8_t cr) {
+int sx1278_coding_rate(sx1278_t *sx1278, uint8_t cr) {
 	if (cr < 5 || cr > 8) {
 		error("coding rate must be between %d and %d\n", 5, 8);
 		return -1;
 	}
 
 	uint8_t modem_config_1;
-	if (spi_read_register(fd, reg_modem_config_1, &modem_config_1) == -1) {
+	if (sx1278_read(sx1278, reg_modem_config_1, &modem_config_1) == -1) {
 		return -1;
 	}
 
 	modem_config_1 = (uint8_t)((modem_config_1 & 0xf1) | ((cr - 4) << 1));
 
-	if (spi_write_register(fd, reg_modem_config_1, modem_config_1) == -1) {
+	if (sx1278_write(sx1278, reg_modem_config_1, modem_config_1) == -1) {
 		return -1;
 	}
 
 	uint8_t value;
-	if (spi_read_register(fd, reg_modem_config_1, &value) == -1) {
+	if (sx1278_read(sx1278, reg_modem_config_1, &value) == -1) {
 		return -1;
 	}
 
@@ -209,7 +390,7 @@ int sx1278_coding_rate(int fd, uint8_t cr) {
 	return 0;
 }
 
-int sx1278_bandwidth(int fd, uint32_t bandwidth) {
+int sx1278_bandwidth(sx1278_t *sx1278, uint32_t bandwidth) {
 	uint8_t bw_bits;
 
 	switch (bandwidth) {
@@ -249,18 +430,18 @@ int sx1278_bandwidth(int fd, uint32_t bandwidth) {
 	}
 
 	uint8_t modem_config_1;
-	if (spi_read_register(fd, reg_modem_config_1, &modem_config_1) == -1) {
+	if (sx1278_read(sx1278, reg_modem_config_1, &modem_config_1) == -1) {
 		return -1;
 	}
 
 	modem_config_1 = (modem_config_1 & 0x0f) | (uint8_t)(bw_bits << 4);
 
-	if (spi_write_register(fd, reg_modem_config_1, modem_config_1) == -1) {
+	if (sx1278_write(sx1278, reg_modem_config_1, modem_config_1) == -1) {
 		return -1;
 	}
 
 	uint8_t value;
-	if (spi_read_register(fd, reg_modem_config_1, &value) == -1) {
+	if (sx1278_read(sx1278, reg_modem_config_1, &value) == -1) {
 		return -1;
 	}
 
@@ -268,25 +449,25 @@ int sx1278_bandwidth(int fd, uint32_t bandwidth) {
 	return 0;
 }
 
-int sx1278_spreading_factor(int fd, uint8_t sf) {
+int sx1278_spreading_factor(sx1278_t *sx1278, uint8_t sf) {
 	if (sf < 6 || sf > 12) {
 		error("spreading factor must be between %d and %d\n", 6, 12);
 		return -1;
 	}
 
 	uint8_t modem_config_2;
-	if (spi_read_register(fd, reg_modem_config_2, &modem_config_2) == -1) {
+	if (sx1278_read(sx1278, reg_modem_config_2, &modem_config_2) == -1) {
 		return -1;
 	}
 
 	modem_config_2 = (modem_config_2 & 0x0f) | (uint8_t)(sf << 4);
 
-	if (spi_write_register(fd, reg_modem_config_2, modem_config_2) == -1) {
+	if (sx1278_write(sx1278, reg_modem_config_2, modem_config_2) == -1) {
 		return -1;
 	}
 
 	uint8_t value;
-	if (spi_read_register(fd, reg_modem_config_2, &value) == -1) {
+	if (sx1278_read(sx1278, reg_modem_config_2, &value) == -1) {
 		return -1;
 	}
 
@@ -294,20 +475,20 @@ int sx1278_spreading_factor(int fd, uint8_t sf) {
 	return 0;
 }
 
-int sx1278_checksum(int fd, bool crc) {
+int sx1278_checksum(sx1278_t *sx1278, bool crc) {
 	uint8_t modem_config_2;
-	if (spi_read_register(fd, reg_modem_config_2, &modem_config_2) == -1) {
+	if (sx1278_read(sx1278, reg_modem_config_2, &modem_config_2) == -1) {
 		return -1;
 	}
 
 	modem_config_2 = (modem_config_2 & (uint8_t)~0x04) | (uint8_t)((crc & 1) << 2);
 
-	if (spi_write_register(fd, reg_modem_config_2, modem_config_2) == -1) {
+	if (sx1278_write(sx1278, reg_modem_config_2, modem_config_2) == -1) {
 		return -1;
 	}
 
 	uint8_t value;
-	if (spi_read_register(fd, reg_modem_config_2, &value) == -1) {
+	if (sx1278_read(sx1278, reg_modem_config_2, &value) == -1) {
 		return -1;
 	}
 
@@ -315,13 +496,13 @@ int sx1278_checksum(int fd, bool crc) {
 	return 0;
 }
 
-int sx1278_sync_word(int fd, uint8_t word) {
-	if (spi_write_register(fd, reg_sync_word, word) == -1) {
+int sx1278_sync_word(sx1278_t *sx1278, uint8_t word) {
+	if (sx1278_write(sx1278, reg_sync_word, word) == -1) {
 		return -1;
 	};
 
 	uint8_t sync_word;
-	if (spi_read_register(fd, reg_sync_word, &sync_word) == -1) {
+	if (sx1278_read(sx1278, reg_sync_word, &sync_word) == -1) {
 		return -1;
 	}
 
@@ -329,9 +510,9 @@ int sx1278_sync_word(int fd, uint8_t word) {
 	return 0;
 }
 
-int sx1278_snr(int fd, int8_t *snr) {
+int sx1278_snr(sx1278_t *sx1278, int8_t *snr) {
 	uint8_t packet_snr;
-	if (spi_read_register(fd, reg_packet_snr, &packet_snr) == -1) {
+	if (sx1278_read(sx1278, reg_packet_snr, &packet_snr) == -1) {
 		return -1;
 	}
 
@@ -341,9 +522,9 @@ int sx1278_snr(int fd, int8_t *snr) {
 	return 0;
 }
 
-int sx1278_rssi(int fd, int16_t *rssi) {
+int sx1278_rssi(sx1278_t *sx1278, int16_t *rssi) {
 	uint8_t packet_rssi;
-	if (spi_read_register(fd, reg_packet_rssi, &packet_rssi) == -1) {
+	if (sx1278_read(sx1278, reg_packet_rssi, &packet_rssi) == -1) {
 		return -1;
 	}
 
@@ -353,112 +534,103 @@ int sx1278_rssi(int fd, int16_t *rssi) {
 	return 0;
 }
 
-int sx1278_transmit(int fd, uint8_t (*data)[256], uint8_t length) {
-	if (spi_write_register(fd, reg_fifo_addr, 0x80) == -1) {
+int sx1278_transmit(sx1278_t *sx1278, uint8_t (*data)[256], uint8_t length, uint64_t airtime) {
+	if (sx1278_write(sx1278, reg_fifo_addr, 0x80) == -1) {
 		return -1;
 	}
 
-	if (spi_write_register(fd, reg_tx_addr, 0x80) == -1) {
+	if (sx1278_write(sx1278, reg_tx_addr, 0x80) == -1) {
 		return -1;
 	}
-	char buffer[512];
-	uint16_t buffer_len = 0;
-	for (uint8_t index = 0; index < length; index++) {
-		if (spi_write_register(fd, reg_fifo, (*data)[index]) == -1) {
-			return -1;
-		}
-		buffer_len += (uint16_t)sprintf(&buffer[buffer_len], "%02x", (*data)[index]);
+	if (spi_write_burst(&sx1278->spi, reg_fifo, *data, length) == -1) {
+		return -1;
 	}
 
-	if (spi_write_register(fd, reg_payload_len, length) == -1) {
+	if (sx1278_write(sx1278, reg_payload_len, length) == -1) {
 		return -1;
 	}
 
-	if (sx1278_tx(fd) == -1) {
+	if (sx1278->dio0.fd != -1 && sx1278_write(sx1278, reg_dio_mapping_1, 0x40) == -1) {
 		return -1;
 	}
 
-	uint8_t irq_flags;
-	while (true) {
-		if (spi_read_register(fd, reg_irq_flags, &irq_flags) == -1) {
-			return -1;
-		};
-		if (irq_flags & 0x08) {
-			trace("transmitting completed irq_flags 0x%02x\n", irq_flags);
-			break;
-		}
-		usleep(500);
+	uint64_t started_at = sx1278_now();
+	sx1278->armed_at = started_at;
+	if (sx1278_tx(sx1278) == -1) {
+		return -1;
 	}
-	trace("transmitted data %.*s\n", buffer_len, buffer);
 
-	if (spi_write_register(fd, reg_irq_flags, 0xff) == -1) {
+	uint8_t irq_flags = 0x00;
+	uint64_t done_at = 0;
+	if (sx1278->dio0.fd == -1 && airtime > tx_guard &&
+			sx1278_predict(sx1278, started_at + airtime, &irq_flags, &done_at) == -1) {
+		return -1;
+	}
+	if (!(irq_flags & 0x08) && sx1278_await(sx1278, 0x08, &irq_flags, &done_at) == -1) {
 		return -1;
 	}
 
-	if (spi_read_register(fd, reg_irq_flags, &irq_flags) == -1) {
+	int64_t airtime_error = ((int64_t)(done_at - started_at) - (int64_t)airtime) / 1000;
+	metric_spread(&metric_shard()->airtime_error, (int32_t)airtime_error, airtime_error_origin, airtime_error_step);
+	trace("transmitting completed irq_flags 0x%02x airtime error %" PRId64 "us\n", irq_flags, airtime_error);
+	trace_hex("transmitted data ", *data, length);
+
+	if (sx1278_write(sx1278, reg_irq_flags, 0xff) == -1) {
+		return -1;
+	}
+
+	if (sx1278_read(sx1278, reg_irq_flags, &irq_flags) == -1) {
 		return -1;
 	};
 
 	trace("acknowledged irq_flags 0x%02x\n", irq_flags);
-	return 0;
+
+	sx1278->mode = 0x01;
+	return sx1278_listen(sx1278);
 }
 
-int sx1278_receive(int fd, uint8_t (*data)[256], uint8_t *length) {
-	if (sx1278_rx(fd) == -1) {
+int sx1278_receive(sx1278_t *sx1278, uint8_t (*data)[256], uint8_t *length, uint64_t *received_at) {
+	if (sx1278->mode != 0x05 && sx1278_listen(sx1278) == -1) {
 		return -1;
 	}
 
 	uint8_t irq_flags;
-	while (true) {
-		if (spi_read_register(fd, reg_irq_flags, &irq_flags) == -1) {
-			return -1;
-		};
-		if (irq_flags & 0x40) {
-			trace("receiving completed irq_flags 0x%02x\n", irq_flags);
-			break;
-		}
-		usleep(500);
+	if (sx1278_await(sx1278, 0x40, &irq_flags, received_at) == -1) {
+		return -1;
+	}
+	trace("receiving completed irq_flags 0x%02x\n", irq_flags);
+
+	if (sx1278_write(sx1278, reg_irq_flags, 0xff) == -1) {
+		return -1;
 	}
+	sx1278->armed_at = sx1278_now();
 
 	uint8_t rx_addr;
-	if (spi_read_register(fd, reg_rx_addr, &rx_addr) == -1) {
+	if (sx1278_read(sx1278, reg_rx_addr, &rx_addr) == -1) {
 		return -1;
 	}
 
 	uint8_t packet_len;
-	if (spi_read_register(fd, reg_packet_len, &packet_len) == -1) {
+	if (sx1278_read(sx1278, reg_packet_len, &packet_len) == -1) {
 		return -1;
 	}
 
-	if (spi_write_register(fd, reg_fifo_addr, rx_addr) == -1) {
+	if (sx1278_write(sx1278, reg_fifo_addr, rx_addr) == -1) {
 		return -1;
 	}
 
-	char buffer[512];
-	uint16_t buffer_len = 0;
-	for (uint8_t index = 0; index < packet_len; index++) {
-		if (spi_read_register(fd, reg_fifo, &(*data)[index]) == -1) {
-			return -1;
-		}
-		buffer_len += (uint16_t)sprintf(&buffer[buffer_len], "%02x", (*data)[index]);
+	if (spi_read_burst(&sx1278->spi, reg_fifo, *data, packet_len) == -1) {
+		return -1;
 	}
-	trace("received data %.*s\n", buffer_len, buffer);
+	trace_hex("received data ", *data, packet_len);
 
 	*length = packet_len;
 
 	if (irq_flags & 0x20) {
 		warn("checksum failed discarding packet length %hhu\n", packet_len);
+		metric_count(&metric_shard()->corrupts, 1);
 		*length = 0;
 	}
 
-	if (spi_write_register(fd, reg_irq_flags, 0xff) == -1) {
-		return -1;
-	}
-
-	if (spi_read_register(fd, reg_irq_flags, &irq_flags) == -1) {
-		return -1;
-	};
-
-	trace("acknowledged irq_flags 0x%02x\n", irq_flags);
 	return 0;
 }
@@ -1,22 +1,44 @@
 #pragma once
 
+#include "gpio.h"
+#include "spi.h"
 #include <stdbool.h>
 #include <stdint.h>
 
-int sx1278_sleep(int fd);
-int sx1278_standby(int fd);
+typedef struct sx1278_t {
+	spi_t spi;
+	gpio_t dio0;
+	uint8_t shadow[128];
+	bool cached[128];
+	uint8_t pending[32][2];
+	uint8_t pending_len;
+	bool batching;
+	uint8_t mode;
+	bool lora;
+	uint64_t armed_at;
+} sx1278_t;
 
-int sx1278_frequency(int fd, uint32_t frequency);
-int sx1278_tx_power(int fd, uint8_t power);
-int sx1278_preamble_length(int fd, uint16_t len);
-int sx1278_coding_rate(int fd, uint8_t cr);
-int sx1278_bandwidth(int fd, uint32_t bandwidth);
-int sx1278_spreading_factor(int fd, uint8_t sf);
-int sx1278_checksum(int fd, bool crc);
-int sx1278_sync_word(int fd, uint8_t word);
+int sx1278_init(sx1278_t *sx1278, const char *device);
+void sx1278_close(sx1278_t *sx1278);
+uint64_t sx1278_now(void);
 
-int sx1278_snr(int fd, int8_t *snr);
-int sx1278_rssi(int fd, int16_t *rssi);
+void sx1278_begin(sx1278_t *sx1278);
+int sx1278_commit(sx1278_t *sx1278);
 
-int sx1278_transmit(int fd, uint8_t (*data)[256], uint8_t length);
-int sx1278_receive(int fd, uint8_t (*data)[256], uint8_t *length);
+int sx1278_sleep(sx1278_t *sx1278);
+int sx1278_standby(sx1278_t *sx1278);
+
+int sx1278_frequency(sx1278_t *sx1278, uint32_t frequency);
+int sx1278_tx_power(sx1278_t *sx1278, uint8_t power);
+int sx1278_preamble_length(sx1278_t *sx1278, uint16_t len);
+int sx1278_coding_rate(sx1278_t *sx1278, uint8_t cr);
+int sx1278_bandwidth(sx1278_t *sx1278, uint32_t bandwidth);
+int sx1278_spreading_factor(sx1278_t *sx1278, uint8_t sf);
+int sx1278_checksum(sx1278_t *sx1278, bool crc);
+int sx1278_sync_word(sx1278_t *sx1278, uint8_t word);
+
+int sx1278_snr(sx1278_t *sx1278, int8_t *snr);
+int sx1278_rssi(sx1278_t *sx1278, int16_t *rssi);
+
+int sx1278_transmit(sx1278_t *sx1278, uint8_t (*data)[256], uint8_t length, uint64_t airtime);
+int sx1278_receive(sx1278_t *sx1278, uint8_t (*data)[256], uint8_t *length, uint64_t *received_at);
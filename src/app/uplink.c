@@ -4,6 +4,7 @@
 #include "../lib/endian.h"
 #include "../lib/error.h"
 #include "../lib/logger.h"
+#include "../lib/metrics.h"
 #include "../lib/request.h"
 #include "../lib/response.h"
 #include "auth.h"
@@ -154,6 +155,9 @@ void *uplink_thread(void *args) {
 		uplink_t uplink = uplinks.ptr[uplinks.head];
 		pthread_mutex_unlock(&uplinks.lock);
 
+		shard_t *shard = metric_shard();
+		metric_observe(&shard->uplink_wait, metric_elapsed(&uplink.queued_at));
+
 		while (true) {
 			host_t *host = NULL;
 			if (arg->hosts_len == 0) {
@@ -169,7 +173,10 @@ void *uplink_thread(void *args) {
 				}
 			}
 
+			struct timespec start;
+			clock_gettime(CLOCK_MONOTONIC, &start);
 			if (uplink_create(&uplink, host, &cookie) != -1) {
+				metric_observe(&shard->uplink_forward, metric_elapsed(&start));
 				break;
 			}
 
@@ -248,8 +255,7 @@ int uplink_create(uplink_t *uplink, host_t *host, cookie_t *cookie) {
 	request.body.len += sizeof(uplink->tx_power);
 	memcpy(&request.body.ptr[request.body.len], &uplink->preamble_len, sizeof(uplink->preamble_len));
 	request.body.len += sizeof(uplink->preamble_len);
-	memcpy(&request.body.ptr[request.body.len], (time_t[]){(time_t)hton64((uint64_t)uplink->received_at)},
-				 sizeof(uplink->received_at));
+	memcpy(&request.body.ptr[request.body.len], (uint64_t[]){hton64(uplink->received_at)}, sizeof(uplink->received_at));
 	request.body.len += sizeof(uplink->received_at);
 	memcpy(&request.body.ptr[request.body.len], uplink->device_id, sizeof(uplink->device_id));
 	request.body.len += sizeof(uplink->device_id);
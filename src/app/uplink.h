@@ -21,7 +21,8 @@ typedef struct uplink_t {
 	uint8_t coding_rate;
 	uint8_t tx_power;
 	uint8_t preamble_len;
-	time_t received_at;
+	uint64_t received_at;
+	struct timespec queued_at;
 	uint8_t device_id[16];
 } uplink_t;
 
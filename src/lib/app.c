@@ -3,177 +3,155 @@
 #include "error.h"
 #include "format.h"
 #include "logger.h"
+#include "loop.h"
+#include "metrics.h"
 #include "request.h"
 #include "response.h"
 #include "strn.h"
 #include <arpa/inet.h>
+#include <errno.h>
 #include <sqlite3.h>
+#include <stdbool.h>
 #include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
 #include <time.h>
 #include <unistd.h>
 
-void handle(sqlite3 *database, char *request_buffer, char *response_buffer, int *client_sock, struct sockaddr_in *client_addr) {
-	struct request_t reqs;
-	struct response_t resp;
-
-	request_init(&reqs, client_sock);
-	response_init(&resp, response_buffer);
-
-	if (setsockopt(*client_sock, SOL_SOCKET, SO_RCVTIMEO, &(struct timeval){.tv_sec = receive_timeout, .tv_usec = 0},
-								 sizeof(struct timeval)) == -1) {
-		error("failed to set socket receive timeout because %s\n", errno_str());
-		goto cleanup;
+bool persist(request_t *request, response_t *response, uint8_t served) {
+	if (response->status == 400 || response->status == 414 || response->status == 431 || response->status == 501 ||
+			response->status == 505) {
+		return false;
 	}
 
-	if (setsockopt(*client_sock, SOL_SOCKET, SO_SNDTIMEO, &(struct timeval){.tv_sec = send_timeout, .tv_usec = 0},
-								 sizeof(struct timeval)) == -1) {
-		error("failed to set socket send timeout because %s\n", errno_str());
-		goto cleanup;
+	if (served + 1 >= alive_requests) {
+		return false;
 	}
 
-	size_t request_length = 0;
-
-	size_t received_bytes = 0;
-	uint8_t received_packets = 0;
-	ssize_t received =
-			recv(*client_sock, request_buffer,
-					 (size_t)(reqs.method.cap + reqs.pathname.cap + reqs.search.cap + reqs.protocol.cap + reqs.header.cap), 0);
-
-	if (received == -1) {
-		error("failed to receive data from client because %s\n", errno_str());
-		goto cleanup;
-	}
-	if (received == 0) {
-		warn("client did not send any data\n");
-		goto cleanup;
-	}
-
-	received_bytes += (size_t)received;
-	received_packets++;
-
-	const char *length_index = strncasestrn(request_buffer, received_bytes, "content-length:", 15);
-	const char *body_index = strncasestrn(request_buffer, received_bytes, "\r\n\r\n", 4);
+	bool persistent = request->protocol.len == 8 && memcmp(request->protocol.ptr, "http/1.1", request->protocol.len) == 0;
 
-	if (length_index && body_index) {
-		length_index += 15;
-		body_index += 4;
-
-		const size_t content_length = (size_t)atoi(length_index);
-		if (content_length > 0) {
-			request_length = (size_t)(body_index - request_buffer) + content_length;
+	uint16_t connection_len;
+	const char *connection = header_find(request, "connection", &connection_len);
+	if (connection != NULL) {
+		if (strncasestrn(connection, connection_len, "close", 5) != NULL) {
+			persistent = false;
+		} else if (strncasestrn(connection, connection_len, "keep-alive", 10) != NULL) {
+			persistent = true;
 		}
 	}
 
-	while (received_bytes < request_length) {
-		if (received_packets + 1 > receive_packets) {
-			warn("packets received %hhu exceeds allowed packets %hhu\n", received_packets, receive_packets);
-			break;
-		}
-
-		if (request_length > receive_buffer) {
-			warn("request length %zu exceeds buffer length %u\n", request_length, receive_buffer);
-			break;
-		}
-
-		ssize_t received_further = recv(*client_sock, &request_buffer[received_bytes], receive_buffer - received_bytes, 0);
-
-		if (received_further == -1) {
-			error("failed to receive further data from client because %s\n", errno_str());
-			goto cleanup;
-		}
-		if (received_further == 0) {
-			warn("client did not send any further data\n");
-			goto cleanup;
-		}
+	return persistent;
+}
 
-		received_bytes += (size_t)received_further;
-		received_packets++;
-	}
+void handle(sqlite3 *database, char *response_buffer, conn_t *conn) {
+	struct request_t reqs;
+	struct response_t resp;
 
-	trace("received %zu bytes in %hhu packets from %s:%d\n", received_bytes, received_packets, inet_ntoa(client_addr->sin_addr),
-				ntohs(client_addr->sin_port));
+	request_init(&reqs, &conn->sock);
+	response_init(&resp, response_buffer);
 
-	if (shutdown(*client_sock, SHUT_RD) == -1) {
-		error("failed to shutdown client socket reading because %s\n", errno_str());
-	}
+	trace("received %u bytes in %hhu packets from %s:%d\n", conn->request_length, conn->received_packets,
+				inet_ntoa(conn->addr.sin_addr), ntohs(conn->addr.sin_port));
 
 	struct timespec start;
 	clock_gettime(CLOCK_MONOTONIC, &start);
 
-	char bytes_buffer[8];
-	human_bytes(&bytes_buffer, received_bytes);
-
-	request(request_buffer, received_bytes, &reqs, &resp);
+	request(conn->request_buffer, conn->request_length, &conn->parser, &reqs, &resp);
 	trace("method %hhub pathname %hhub search %hub header %hub body %ub\n", reqs.method.len, reqs.pathname.len, reqs.search.len,
 				reqs.header.len, reqs.body.len);
-	req("%.*s %.*s %s\n", (int)reqs.method.len, reqs.method.ptr, (int)reqs.pathname.len, reqs.pathname.ptr, bytes_buffer);
-
-	route(database, &reqs, &resp);
 
-	size_t response_length = response(&reqs, &resp, response_buffer);
+	if (log_requests == true) {
+		char bytes_buffer[8];
+		human_bytes(&bytes_buffer, conn->request_length);
+		req("%.*s %.*s %s\n", (int)reqs.method.len, reqs.method.ptr, (int)reqs.pathname.len, reqs.pathname.ptr, bytes_buffer);
+	}
 
-	struct timespec stop;
-	clock_gettime(CLOCK_MONOTONIC, &stop);
+	int8_t endpoint = route(database, &reqs, &resp);
 
-	char duration_buffer[8];
-	human_duration(&duration_buffer, &start, &stop);
-	human_bytes(&bytes_buffer, response_length);
+	resp.keep_alive = conn->keep_alive == true && persist(&reqs, &resp, conn->served);
+	conn->keep_alive = resp.keep_alive;
 
-	res("%d %s %s\n", resp.status, duration_buffer, bytes_buffer);
-	trace("head %hhub header %hub body %ub\n", resp.head.len, resp.header.len, resp.body.len);
-
-	size_t sent_bytes = 0;
-	uint8_t sent_packets = 0;
-	ssize_t sent = send(*client_sock, response_buffer, resp.head.len + resp.header.len, MSG_NOSIGNAL);
+	size_t response_length = response(&reqs, &resp, response_buffer);
 
-	if (sent == -1) {
-		error("failed to send data to client because %s\n", errno_str());
-		goto cleanup;
-	}
-	if (sent == 0) {
-		warn("server did not send any data\n");
-		goto cleanup;
+	shard_t *shard = metric_shard();
+	uint8_t metered = endpoint == -1 ? endpoints_len : (uint8_t)endpoint;
+	metric_count(&shard->requests[metered], 1);
+	metric_count(&shard->received_bytes[metered], conn->request_length);
+	metric_count(&shard->sent_bytes[metered], response_length);
+	metric_observe(&shard->latency[metered], metric_elapsed(&start));
+
+	if (log_responses == true) {
+		struct timespec stop;
+		clock_gettime(CLOCK_MONOTONIC, &stop);
+
+		char duration_buffer[8];
+		char bytes_buffer[8];
+		human_duration(&duration_buffer, &start, &stop);
+		human_bytes(&bytes_buffer, response_length);
+		res("%d %s %s\n", resp.status, duration_buffer, bytes_buffer);
 	}
+	trace("head %hhub header %hub body %ub\n", resp.head.len, resp.header.len, resp.body.len);
 
-	sent_bytes += (size_t)sent;
-	sent_packets++;
+	conn->stream = resp.stream;
 
-	while ((size_t)sent_bytes < response_length) {
-		if (sent_packets + 1 > send_packets) {
-			warn("packets sent %hhu exceeds allowed packets %hhu\n\n", sent_packets, send_packets);
-			break;
-		}
+	struct iovec iov[2] = {
+			{.iov_base = response_buffer, .iov_len = resp.head.len + resp.header.len},
+			{.iov_base = resp.body.ptr, .iov_len = resp.body.len},
+	};
 
-		if (response_length > send_buffer) {
-			warn("response length %zu exceeds buffer length %u\n", response_length, send_buffer);
-			break;
+	size_t sent_bytes = 0;
+	while (sent_bytes < response_length) {
+		if (conn->sent_packets + 1 > send_packets) {
+			warn("packets sent %hhu exceeds allowed packets %hhu\n", conn->sent_packets, send_packets);
+			conn->closing = true;
+			return;
 		}
 
-		ssize_t sent_further = send(*client_sock, &resp.body.ptr[sent_bytes - resp.head.len - resp.header.len],
-																resp.body.len - (sent_bytes - resp.head.len - resp.header.len), MSG_NOSIGNAL);
+		ssize_t sent = sendmsg(conn->sock, &(struct msghdr){.msg_iov = iov, .msg_iovlen = 2}, MSG_NOSIGNAL);
 
-		if (sent_further == -1) {
-			error("failed to send further data to client because %s\n", errno_str());
-			goto cleanup;
+		if (sent == -1) {
+			if (errno == EAGAIN || errno == EWOULDBLOCK) {
+				break;
+			}
+			error("failed to send data to client because %s\n", errno_str());
+			conn->closing = true;
+			return;
 		}
-		if (sent_further == 0) {
-			warn("server did not send any further data\n");
-			goto cleanup;
+		if (sent == 0) {
+			warn("server did not send any data\n");
+			conn->closing = true;
+			return;
 		}
 
-		sent_bytes += (size_t)sent_further;
-		sent_packets++;
-	}
+		sent_bytes += (size_t)sent;
+		conn->sent_packets++;
 
-	trace("sent %zu bytes in %hhu packets to %s:%d\n", sent_bytes, sent_packets, inet_ntoa(client_addr->sin_addr),
-				ntohs(client_addr->sin_port));
+		for (uint8_t index = 0; index < 2; index++) {
+			size_t advance = (size_t)sent < iov[index].iov_len ? (size_t)sent : iov[index].iov_len;
+			iov[index].iov_base = (char *)iov[index].iov_base + advance;
+			iov[index].iov_len -= advance;
+			sent -= (ssize_t)advance;
+		}
+	}
 
-	if (resp.stream == false && shutdown(*client_sock, SHUT_WR) == -1) {
-		error("failed to shutdown client socket writing because %s\n", errno_str());
+	if (sent_bytes == response_length) {
+		trace("sent %zu bytes in %hhu packets to %s:%d\n", sent_bytes, conn->sent_packets, inet_ntoa(conn->addr.sin_addr),
+					ntohs(conn->addr.sin_port));
+		return;
 	}
 
-cleanup:
-	if (resp.stream == false && close(*client_sock) == -1) {
-		error("failed to close client socket because %s\n", errno_str());
+	conn->response_len = (uint32_t)(response_length - sent_bytes);
+	conn->response_buffer = malloc(conn->response_len);
+	if (conn->response_buffer == NULL) {
+		error("failed to allocate %u bytes because %s\n", conn->response_len, errno_str());
+		conn->response_len = 0;
+		conn->closing = true;
+		return;
 	}
+
+	memcpy(conn->response_buffer, iov[0].iov_base, iov[0].iov_len);
+	memcpy(&conn->response_buffer[iov[0].iov_len], iov[1].iov_base, iov[1].iov_len);
+	conn->response_pos = 0;
+
+	trace("deferred %u bytes to loop thread %hhu\n", conn->response_len, conn->loop->id);
 }
@@ -1,6 +1,6 @@
 #pragma once
 
-#include <arpa/inet.h>
+#include "loop.h"
 #include <sqlite3.h>
 
-void handle(sqlite3 *database, char *request_buffer, char *response_buffer, int *client_sock, struct sockaddr_in *client_addr);
+void handle(sqlite3 *database, char *response_buffer, conn_t *conn);
@@ -6,10 +6,91 @@
 #include "logger.h"
 #include "sha256.h"
 #include "string.h"
+#include "error.h"
 #include "strn.h"
+#include <errno.h>
+#include <pthread.h>
+#include <stdbool.h>
 #include <stdint.h>
+#include <stdlib.h>
 #include <time.h>
 
+tokens_t tokens = {.ptr = NULL, .cap = 0, .hits = 0, .misses = 0};
+
+int bwt_init(void) {
+	sha256_hmac_key((uint8_t *)bwt_key, strlen(bwt_key), &tokens.key);
+
+	if (bwt_cache == 0) {
+		return 0;
+	}
+
+	tokens.ptr = calloc(bwt_cache, sizeof(*tokens.ptr));
+	if (tokens.ptr == NULL) {
+		fatal("failed to allocate %zu bytes for tokens because %s\n", bwt_cache * sizeof(*tokens.ptr), errno_str());
+		return -1;
+	}
+
+	for (uint16_t index = 0; index < bwt_cache; index++) {
+		if ((errno = pthread_mutex_init(&tokens.ptr[index].lock, NULL)) != 0) {
+			fatal("failed to initialise token lock because %s\n", errno_str());
+			return -1;
+		}
+	}
+	tokens.cap = bwt_cache;
+
+	return 0;
+}
+
+void bwt_free(void) {
+	for (uint16_t index = 0; index < tokens.cap; index++) {
+		pthread_mutex_destroy(&tokens.ptr[index].lock);
+	}
+
+	free(tokens.ptr);
+	tokens.ptr = NULL;
+	tokens.cap = 0;
+}
+
+bool bwt_equal(const void *left, const void *right, size_t len) {
+	uint8_t difference = 0;
+	for (size_t index = 0; index < len; index++) {
+		difference |= ((const uint8_t *)left)[index] ^ ((const uint8_t *)right)[index];
+	}
+	return difference == 0;
+}
+
+token_t *bwt_slot(const char *buffer, size_t buffer_len) {
+	if (tokens.cap == 0 || buffer_len != sizeof(tokens.ptr->buffer)) {
+		return NULL;
+	}
+
+	uint32_t hash = 2166136261;
+	for (size_t index = 0; index < buffer_len; index++) {
+		hash = (hash ^ (uint8_t)buffer[index]) * 16777619;
+	}
+
+	return &tokens.ptr[hash % tokens.cap];
+}
+
+bool bwt_cached(token_t *token, const char *buffer, bwt_t *bwt) {
+	pthread_mutex_lock(&token->lock);
+	bool cached = token->bwt.exp >= time(NULL) && bwt_equal(token->buffer, buffer, sizeof(token->buffer));
+	if (cached == true) {
+		memcpy(bwt, &token->bwt, sizeof(*bwt));
+	}
+	pthread_mutex_unlock(&token->lock);
+
+	atomic_fetch_add_explicit(cached == true ? &tokens.hits : &tokens.misses, 1, memory_order_relaxed);
+	return cached;
+}
+
+void bwt_remember(token_t *token, const char *buffer, bwt_t *bwt) {
+	pthread_mutex_lock(&token->lock);
+	memcpy(token->buffer, buffer, sizeof(token->buffer));
+	memcpy(&token->bwt, bwt, sizeof(token->bwt));
+	pthread_mutex_unlock(&token->lock);
+}
+
 int bwt_sign(char (*buffer)[109], uint8_t (*id)[16], uint8_t (*data)[4]) {
 	const time_t iat = time(NULL);
 	const time_t exp = iat + bwt_ttl;
@@ -26,7 +107,7 @@ int bwt_sign(char (*buffer)[109], uint8_t (*id)[16], uint8_t (*data)[4]) {
 	offset += sizeof(*data);
 
 	uint8_t hmac[32];
-	sha256_hmac((uint8_t *)bwt_key, strlen(bwt_key), binary, offset, &hmac);
+	sha256_hmac_keyed(&tokens.key, binary, offset, &hmac);
 	memcpy(&binary[offset], hmac, sizeof(hmac));
 
 	if (base32_encode((char *)buffer, sizeof(*buffer), binary, sizeof(binary)) == -1) {
@@ -45,6 +126,12 @@ int bwt_verify(const char *cookie, const size_t cookie_len, bwt_t *bwt) {
 		return -1;
 	}
 
+	token_t *token = bwt_slot(buffer, buffer_len);
+	if (token != NULL && bwt_cached(token, buffer, bwt) == true) {
+		trace("bwt %.8s verified from cache\n", buffer);
+		return 0;
+	}
+
 	uint8_t binary[68];
 	if (base32_decode(binary, sizeof(binary), buffer, buffer_len) == -1) {
 		error("failed to decode bwt from base 32\n");
@@ -62,9 +149,9 @@ int bwt_verify(const char *cookie, const size_t cookie_len, bwt_t *bwt) {
 	offset += sizeof(bwt->data);
 
 	uint8_t hmac[32];
-	sha256_hmac((uint8_t *)bwt_key, strlen(bwt_key), binary, offset, &hmac);
+	sha256_hmac_keyed(&tokens.key, binary, offset, &hmac);
 
-	if (memcmp(binary + offset, hmac, sizeof(hmac)) != 0) {
+	if (bwt_equal(binary + offset, hmac, sizeof(hmac)) == false) {
 		warn("bwt %.8s has invalid signature\n", buffer);
 		return -1;
 	}
@@ -80,5 +167,9 @@ int bwt_verify(const char *cookie, const size_t cookie_len, bwt_t *bwt) {
 		return -1;
 	}
 
+	if (token != NULL) {
+		bwt_remember(token, buffer, bwt);
+	}
+
 	return 0;
 }
@@ -1,5 +1,8 @@
 #pragma once
 
+#include "sha256.h"
+#include <pthread.h>
+#include <stdatomic.h>
 #include <stdint.h>
 #include <time.h>
 
@@ -10,5 +13,24 @@ typedef struct bwt_t {
 	uint8_t data[4];
 } bwt_t;
 
+typedef struct token_t {
+	char buffer[109];
+	bwt_t bwt;
+	pthread_mutex_t lock;
+} token_t;
+
+typedef struct tokens_t {
+	sha256_key_t key;
+	token_t *ptr;
+	uint16_t cap;
+	atomic_uint hits;
+	atomic_uint misses;
+} tokens_t;
+
+extern struct tokens_t tokens;
+
+int bwt_init(void);
+void bwt_free(void);
+
 int bwt_sign(char (*buffer)[109], uint8_t (*id)[16], uint8_t (*data)[4]);
 int bwt_verify(const char *cookie, const size_t cookie_len, bwt_t *bwt);
@@ -10,9 +10,11 @@ const char *address = "0.0.0.0";
 uint16_t port = 2254;
 
 uint8_t backlog = 16;
-uint8_t queue_size = 8;
+uint16_t queue_size = 64;
 uint8_t least_workers = 4;
 uint8_t most_workers = 64;
+uint8_t io_threads = 2;
+bool reuse_port = false;
 
 uint8_t streams_size = 128;
 uint8_t transmissions_size = 64;
@@ -20,14 +22,22 @@ uint8_t uplinks_size = 16;
 uint8_t downlinks_size = 16;
 uint8_t schedules_size = 16;
 
+uint16_t reply_deadline = 1000;
+
+uint16_t sim_interval = 1000;
+bool sim_airtime = true;
+
 const char *bwt_key = "n6ee65x78u75s73";
 uint32_t bwt_ttl = 2764800;
+uint16_t bwt_cache = 256;
 
 const char *database_file = "nexus.sqlite";
 uint16_t database_timeout = 500;
 
 uint8_t receive_timeout = 60;
 uint8_t send_timeout = 60;
+uint8_t alive_timeout = 8;
+uint8_t alive_requests = 128;
 uint8_t receive_packets = 16;
 uint8_t send_packets = 16;
 uint32_t receive_buffer = 262144;
@@ -38,6 +48,7 @@ bool log_receives = true;
 bool log_transmits = true;
 bool log_requests = true;
 bool log_responses = true;
+bool log_async = false;
 
 bool match_arg(const char *flag, const char *verbose, const char *concise) {
 	return strcmp(flag, verbose) == 0 || strcmp(flag, concise) == 0;
@@ -204,19 +215,28 @@ int configure(int argc, char *argv[], uint8_t *cmds) {
 			errors += parse_uint8(value, "backlog", 0, 255, &backlog);
 		} else if (match_arg(flag, "--queue-size", "-qs")) {
 			const char *value = next_arg(argc, argv, &ind);
-			errors += parse_uint8(value, "queue size", 1, 127, &queue_size);
+			errors += parse_uint16(value, "queue size", 2, 4096, &queue_size);
 		} else if (match_arg(flag, "--least-workers", "-lw")) {
 			const char *value = next_arg(argc, argv, &ind);
 			errors += parse_uint8(value, "least-workers", 1, 63, &least_workers);
 		} else if (match_arg(flag, "--most-workers", "-mw")) {
 			const char *value = next_arg(argc, argv, &ind);
 			errors += parse_uint8(value, "most-workers", 3, 255, &most_workers);
+		} else if (match_arg(flag, "--io-threads", "-it")) {
+			const char *value = next_arg(argc, argv, &ind);
+			errors += parse_uint8(value, "io threads", 1, 64, &io_threads);
+		} else if (match_arg(flag, "--reuse-port", "-ru")) {
+			const char *value = next_arg(argc, argv, &ind);
+			errors += parse_bool(value, "reuse port", &reuse_port);
 		} else if (match_arg(flag, "--bwt-key", "-bk")) {
 			const char *value = next_arg(argc, argv, &ind);
 			errors += parse_str(value, "bwt key", 16, 64, &bwt_key);
 		} else if (match_arg(flag, "--bwt-ttl", "-bt")) {
 			const char *value = next_arg(argc, argv, &ind);
 			errors += parse_uint32(value, "bwt ttl", 3600, 15768000, &bwt_ttl);
+		} else if (match_arg(flag, "--bwt-cache", "-bc")) {
+			const char *value = next_arg(argc, argv, &ind);
+			errors += parse_uint16(value, "bwt cache", 0, 4096, &bwt_cache);
 		} else if (match_arg(flag, "--database-file", "-df")) {
 			const char *value = next_arg(argc, argv, &ind);
 			errors += parse_str(value, "database file", 4, 64, &database_file);
@@ -229,6 +249,12 @@ int configure(int argc, char *argv[], uint8_t *cmds) {
 		} else if (match_arg(flag, "--send-timeout", "-st")) {
 			const char *value = next_arg(argc, argv, &ind);
 			errors += parse_uint8(value, "send timeout", 2, 240, &send_timeout);
+		} else if (match_arg(flag, "--alive-timeout", "-at")) {
+			const char *value = next_arg(argc, argv, &ind);
+			errors += parse_uint8(value, "alive timeout", 1, 240, &alive_timeout);
+		} else if (match_arg(flag, "--alive-requests", "-ar")) {
+			const char *value = next_arg(argc, argv, &ind);
+			errors += parse_uint8(value, "alive requests", 1, 255, &alive_requests);
 		} else if (match_arg(flag, "--receive-packets", "-rp")) {
 			const char *value = next_arg(argc, argv, &ind);
 			errors += parse_uint8(value, "receive packets", 1, 128, &receive_packets);
@@ -241,6 +267,15 @@ int configure(int argc, char *argv[], uint8_t *cmds) {
 		} else if (match_arg(flag, "--send-buffer", "-sb")) {
 			const char *value = next_arg(argc, argv, &ind);
 			errors += parse_uint32(value, "send buffer", 16384, 1048576, &send_buffer);
+		} else if (match_arg(flag, "--reply-deadline", "-rd")) {
+			const char *value = next_arg(argc, argv, &ind);
+			errors += parse_uint16(value, "reply deadline", 1, 60000, &reply_deadline);
+		} else if (match_arg(flag, "--sim-interval", "-si")) {
+			const char *value = next_arg(argc, argv, &ind);
+			errors += parse_uint16(value, "sim interval", 1, 60000, &sim_interval);
+		} else if (match_arg(flag, "--sim-airtime", "-sa")) {
+			const char *value = next_arg(argc, argv, &ind);
+			errors += parse_bool(value, "sim airtime", &sim_airtime);
 		} else if (match_arg(flag, "--log-level", "-ll")) {
 			const char *value = next_arg(argc, argv, &ind);
 			errors += parse_log_level(value, &log_level);
@@ -250,6 +285,9 @@ int configure(int argc, char *argv[], uint8_t *cmds) {
 		} else if (match_arg(flag, "--log-responses", "-ls")) {
 			const char *value = next_arg(argc, argv, &ind);
 			errors += parse_bool(value, "log responses", &log_responses);
+		} else if (match_arg(flag, "--log-async", "-la")) {
+			const char *value = next_arg(argc, argv, &ind);
+			errors += parse_bool(value, "log async", &log_async);
 		} else {
 			errors++;
 			error("unknown argument %s\n", flag);
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
 extern const char *name;
@@ -9,9 +10,11 @@ extern const char *address;
 extern uint16_t port;
 
 extern uint8_t backlog;
-extern uint8_t queue_size;
+extern uint16_t queue_size;
 extern uint8_t least_workers;
 extern uint8_t most_workers;
+extern uint8_t io_threads;
+extern bool reuse_port;
 
 extern uint8_t streams_size;
 extern uint8_t transmissions_size;
@@ -19,14 +22,22 @@ extern uint8_t uplinks_size;
 extern uint8_t downlinks_size;
 extern uint8_t schedules_size;
 
+extern uint16_t reply_deadline;
+
+extern uint16_t sim_interval;
+extern bool sim_airtime;
+
 extern const char *bwt_key;
 extern uint32_t bwt_ttl;
+extern uint16_t bwt_cache;
 
 extern const char *database_file;
 extern uint16_t database_timeout;
 
 extern uint8_t receive_timeout;
 extern uint8_t send_timeout;
+extern uint8_t alive_timeout;
+extern uint8_t alive_requests;
 extern uint8_t receive_packets;
 extern uint8_t send_packets;
 extern uint32_t receive_buffer;
@@ -37,5 +48,16 @@ extern bool log_receives;
 extern bool log_transmits;
 extern bool log_requests;
 extern bool log_responses;
+extern bool log_async;
+
+bool match_arg(const char *flag, const char *verbose, const char *concise);
+const char *next_arg(const int argc, char *argv[], int *ind);
+
+int parse_bool(const char *arg, const char *key, bool *value);
+int parse_uint8(const char *arg, const char *key, const uint8_t min, const uint8_t max, uint8_t *value);
+int parse_uint16(const char *arg, const char *key, const uint16_t min, const uint16_t max, uint16_t *value);
+int parse_uint32(const char *arg, const char *key, const uint32_t min, const uint32_t max, uint32_t *value);
+int parse_str(const char *arg, const char *key, size_t min, size_t max, const char **value);
+int parse_log_level(const char *arg, uint8_t *value);
 
 int configure(int argc, char *argv[], uint8_t *cmds);
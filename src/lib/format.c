@@ -79,3 +79,14 @@ void human_time(char (*buffer)[8], time_t seconds) {
 		sprintf(*buffer, "%lud", seconds / 86400);
 	}
 }
+
+uint16_t human_hex(char *buffer, size_t buffer_len, const uint8_t *bytes, uint16_t len) {
+	const char *digits = "0123456789abcdef";
+
+	uint16_t index = 0;
+	for (; index < len && (size_t)(index * 2 + 2) <= buffer_len; index++) {
+		buffer[index * 2] = digits[bytes[index] >> 4];
+		buffer[index * 2 + 1] = digits[bytes[index] & 0x0f];
+	}
+	return (uint16_t)(index * 2);
+}
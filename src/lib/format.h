@@ -11,3 +11,4 @@ const char *human_log_level(uint8_t level);
 void human_bytes(char (*buffer)[8], size_t bytes);
 void human_duration(char (*buffer)[8], struct timespec *start, struct timespec *stop);
 void human_time(char (*buffer)[8], time_t seconds);
+uint16_t human_hex(char *buffer, size_t buffer_len, const uint8_t *bytes, uint16_t len);
@@ -1,7 +1,15 @@
+#include "logger.h"
 #include "config.h"
+#include "error.h"
+#include "format.h"
+#include "thread.h"
+#include <errno.h>
 #include <stdarg.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/uio.h>
 #include <time.h>
 #include <unistd.h>
 
@@ -15,6 +23,16 @@ static const char *bold = "\x1b[1m";
 static const char *normal = "\x1b[22m";
 static const char *reset = "\x1b[39m";
 
+static const char *labels[10] = {"rx", "tx", "req", "res", "trace", "debug", "info", "warn", "error", "fatal"};
+static const char **colors[10] = {&bold, &bold, &bold, &bold, &blue, &cyan, &green, &yellow, &red, &purple};
+
+const uint16_t ring_cap = 256;
+
+logs_t logs;
+
+static _Thread_local ring_t *owned = NULL;
+static _Thread_local bool busy = false;
+
 void logger_init(void) {
 	if (isatty(fileno(stdout)) == 0 || isatty(fileno(stderr)) == 0) {
 		purple = "";
@@ -53,112 +71,405 @@ void print(FILE *file, const char *time, const char *level, const char *color, c
 	funlockfile(file);
 }
 
-void rx(const char *message, ...) {
+void logger_release(void *ring) { atomic_store_explicit(&((ring_t *)ring)->claimed, false, memory_order_release); }
+
+ring_t *logger_ring(void) {
+	if (owned != NULL) {
+		return owned;
+	}
+
+	for (uint8_t index = 0; index < sizeof(logs.rings) / sizeof(*logs.rings); index++) {
+		bool claimed = false;
+		if (atomic_compare_exchange_strong(&logs.rings[index].claimed, &claimed, true)) {
+			owned = &logs.rings[index];
+			pthread_setspecific(logs.key, owned);
+			return owned;
+		}
+	}
+
+	return NULL;
+}
+
+void logger_publish(ring_t *ring, uint_fast32_t head, uint_fast32_t tail) {
+	atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+
+	if (head - tail + 1 == ring_cap / 2) {
+		atomic_fetch_add_explicit(&logs.wake, 1, memory_order_release);
+		futex_wake(&logs.wake, 1);
+	}
+}
+
+bool logger_push(ring_t *ring, uint8_t level, const char *message, va_list args) {
+	uint_fast32_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+	uint_fast32_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+	if (head - tail >= ring_cap) {
+		return false;
+	}
+
+	record_t *record = &ring->records[head & (ring_cap - 1)];
+
+	va_list copy;
+	va_copy(copy, args);
+	int len = vsnprintf(record->text, sizeof(record->text), message, copy);
+	va_end(copy);
+
+	if (len < 0) {
+		len = 0;
+	}
+	if ((size_t)len >= sizeof(record->text)) {
+		len = sizeof(record->text) - 1;
+		record->text[len - 1] = '\n';
+	}
+
+	record->level = level;
+	record->len = (uint16_t)len;
+	record->hex = 0;
+	logger_publish(ring, head, tail);
+	return true;
+}
+
+bool logger_push_hex(ring_t *ring, uint8_t level, const char *message, const uint8_t *bytes, uint16_t len) {
+	uint_fast32_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+	uint_fast32_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+	if (head - tail >= ring_cap) {
+		return false;
+	}
+
+	record_t *record = &ring->records[head & (ring_cap - 1)];
+
+	if (len > sizeof(record->text)) {
+		len = sizeof(record->text);
+	}
+	size_t message_len = strlen(message);
+	if (message_len > sizeof(record->text) - len) {
+		message_len = sizeof(record->text) - len;
+	}
+	memcpy(record->text, message, message_len);
+	memcpy(&record->text[message_len], bytes, len);
+
+	record->level = level;
+	record->len = (uint16_t)message_len;
+	record->hex = len;
+	logger_publish(ring, head, tail);
+	return true;
+}
+
+void direct(uint8_t level, const char *message, va_list args) {
+	char buffer[9];
+	timestamp(&buffer);
+	FILE *file = level >= 7 ? stderr : stdout;
+	print(file, buffer, labels[level], *colors[level], message, args);
+	if (atomic_load_explicit(&logs.running, memory_order_relaxed) == true) {
+		fflush(file);
+	}
+}
+
+void directf(uint8_t level, const char *message, ...) {
+	va_list args;
+	va_start(args, message);
+	direct(level, message, args);
+	va_end(args);
+}
+
+void emit(uint8_t level, const char *message, va_list args) {
+	if (atomic_load_explicit(&logs.running, memory_order_acquire) == true && busy == false) {
+		busy = true;
+		ring_t *ring = logger_ring();
+		bool queued = ring != NULL && logger_push(ring, level, message, args);
+		busy = false;
+		if (queued == true) {
+			return;
+		}
+		if (ring != NULL && level < 7) {
+			atomic_fetch_add_explicit(&ring->dropped, 1, memory_order_relaxed);
+			return;
+		}
+	}
+
+	direct(level, message, args);
+}
+
+void emit_hex(uint8_t level, const char *message, const uint8_t *bytes, uint16_t len) {
+	if (atomic_load_explicit(&logs.running, memory_order_acquire) == true && busy == false) {
+		busy = true;
+		ring_t *ring = logger_ring();
+		bool queued = ring != NULL && logger_push_hex(ring, level, message, bytes, len);
+		busy = false;
+		if (queued == true) {
+			return;
+		}
+		if (ring != NULL && level < 7) {
+			atomic_fetch_add_explicit(&ring->dropped, 1, memory_order_relaxed);
+			return;
+		}
+	}
+
+	char hex[512];
+	uint16_t hex_len = human_hex(hex, sizeof(hex), bytes, len);
+	directf(level, "%s%.*s\n", message, (int)hex_len, hex);
+}
+
+void logger_flush(int fd, struct iovec *iov, int iov_len) {
+	int index = 0;
+	while (index < iov_len) {
+		ssize_t written = writev(fd, &iov[index], iov_len - index);
+		if (written == -1) {
+			if (errno == EINTR) {
+				continue;
+			}
+			return;
+		}
+
+		while (index < iov_len && (size_t)written >= iov[index].iov_len) {
+			written -= (ssize_t)iov[index].iov_len;
+			index++;
+		}
+		if (index < iov_len) {
+			iov[index].iov_base = (char *)iov[index].iov_base + written;
+			iov[index].iov_len -= (size_t)written;
+		}
+	}
+}
+
+size_t logger_drain(void) {
+	static char prefixes[64][64];
+	static char hexes[64][512];
+	static struct iovec iov[2][192];
+	int iov_len[2] = {0, 0};
+	uint_fast32_t tails[sizeof(logs.rings) / sizeof(*logs.rings)];
+	uint8_t batch = 0;
+	size_t drained = 0;
+
+	char buffer[9];
+	timestamp(&buffer);
+
+	for (uint8_t index = 0; index < sizeof(logs.rings) / sizeof(*logs.rings); index++) {
+		ring_t *ring = &logs.rings[index];
+		uint_fast32_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+		uint_fast32_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+		tails[index] = tail;
+
+		for (; tail != head; tail++) {
+			if (batch == sizeof(prefixes) / sizeof(*prefixes)) {
+				logger_flush(fileno(stdout), iov[0], iov_len[0]);
+				logger_flush(fileno(stderr), iov[1], iov_len[1]);
+				for (uint8_t ind = 0; ind <= index; ind++) {
+					atomic_store_explicit(&logs.rings[ind].tail, tails[ind], memory_order_release);
+				}
+				iov_len[0] = 0;
+				iov_len[1] = 0;
+				batch = 0;
+			}
+
+			record_t *record = &ring->records[tail & (ring_cap - 1)];
+			uint8_t stream = record->level >= 7 ? 1 : 0;
+			int len = snprintf(prefixes[batch], sizeof(prefixes[batch]), "%s%s%s%s%s %s %s%s%s%s%s ", bold, blue, name, reset,
+												 normal, buffer, bold, *colors[record->level], labels[record->level], reset, normal);
+			iov[stream][iov_len[stream]++] = (struct iovec){.iov_base = prefixes[batch], .iov_len = (size_t)len};
+			iov[stream][iov_len[stream]++] = (struct iovec){.iov_base = record->text, .iov_len = record->len};
+			if (record->hex > 0) {
+				uint16_t hex_len = human_hex(hexes[batch], sizeof(hexes[batch]) - 1, (uint8_t *)&record->text[record->len], record->hex);
+				hexes[batch][hex_len] = '\n';
+				iov[stream][iov_len[stream]++] = (struct iovec){.iov_base = hexes[batch], .iov_len = hex_len + 1u};
+			}
+			tails[index] = tail + 1;
+			batch++;
+			drained++;
+		}
+	}
+
+	logger_flush(fileno(stdout), iov[0], iov_len[0]);
+	logger_flush(fileno(stderr), iov[1], iov_len[1]);
+	for (uint8_t index = 0; index < sizeof(logs.rings) / sizeof(*logs.rings); index++) {
+		atomic_store_explicit(&logs.rings[index].tail, tails[index], memory_order_release);
+	}
+
+	uint32_t dropped = 0;
+	for (uint8_t index = 0; index < sizeof(logs.rings) / sizeof(*logs.rings); index++) {
+		dropped += atomic_exchange_explicit(&logs.rings[index].dropped, 0, memory_order_relaxed);
+	}
+	if (dropped > 0) {
+		atomic_fetch_add_explicit(&logs.dropped, dropped, memory_order_relaxed);
+		char line[64];
+		int len = snprintf(line, sizeof(line), "dropped %u log records\n", dropped);
+		char prefix[64];
+		int prefix_len = snprintf(prefix, sizeof(prefix), "%s%s%s%s%s %s %s%s%s%s%s ", bold, blue, name, reset, normal, buffer,
+															bold, yellow, "warn", reset, normal);
+		struct iovec warning[2] = {
+				{.iov_base = prefix, .iov_len = (size_t)prefix_len},
+				{.iov_base = line, .iov_len = (size_t)len},
+		};
+		logger_flush(fileno(stderr), warning, 2);
+	}
+
+	return drained;
+}
+
+void *logger_thread(void *args) {
+	(void)args;
+
+	while (true) {
+		unsigned int wake = atomic_load_explicit(&logs.wake, memory_order_acquire);
+		bool stopping = atomic_load_explicit(&logs.stopping, memory_order_acquire);
+
+		if (logger_drain() > 0) {
+			continue;
+		}
+		if (stopping == true) {
+			break;
+		}
+
+		struct timespec timeout = {.tv_sec = 0, .tv_nsec = 10 * 1000 * 1000};
+		futex_wait(&logs.wake, wake, &timeout);
+	}
+
+	return NULL;
+}
+
+int logger_start(void) {
+	logs.records = calloc(sizeof(logs.rings) / sizeof(*logs.rings) * ring_cap, sizeof(record_t));
+	if (logs.records == NULL) {
+		error("failed to allocate %zu bytes for log records because %s\n",
+					sizeof(logs.rings) / sizeof(*logs.rings) * ring_cap * sizeof(record_t), errno_str());
+		return -1;
+	}
+
+	for (uint8_t index = 0; index < sizeof(logs.rings) / sizeof(*logs.rings); index++) {
+		logs.rings[index].records = &logs.records[index * ring_cap];
+		atomic_init(&logs.rings[index].head, 0);
+		atomic_init(&logs.rings[index].tail, 0);
+		atomic_init(&logs.rings[index].claimed, false);
+		atomic_init(&logs.rings[index].dropped, 0);
+	}
+
+	if (pthread_key_create(&logs.key, &logger_release) != 0) {
+		error("failed to create log ring key\n");
+		goto cleanup;
+	}
+
+	fflush(stdout);
+	fflush(stderr);
+	atomic_store(&logs.stopping, false);
+
+	if (pthread_create(&logs.thread, NULL, &logger_thread, NULL) != 0) {
+		error("failed to create log writer thread\n");
+		pthread_key_delete(logs.key);
+		goto cleanup;
+	}
+
+	atomic_store_explicit(&logs.running, true, memory_order_release);
+	atexit(&logger_stop);
+	return 0;
+
+cleanup:
+	free(logs.records);
+	logs.records = NULL;
+	return -1;
+}
+
+void logger_stop(void) {
+	if (atomic_exchange(&logs.running, false) == false) {
+		return;
+	}
+
+	atomic_store_explicit(&logs.stopping, true, memory_order_release);
+	atomic_fetch_add_explicit(&logs.wake, 1, memory_order_release);
+	futex_wake(&logs.wake, 1);
+	pthread_join(logs.thread, NULL);
+}
+
+void (rx)(const char *message, ...) {
 	if (log_requests == true) {
-		char buffer[9];
-		timestamp(&buffer);
 		va_list args;
 		va_start(args, message);
-		print(stdout, buffer, "rx", bold, message, args);
+		emit(0, message, args);
 		va_end(args);
 	}
 }
 
-void tx(const char *message, ...) {
+void (tx)(const char *message, ...) {
 	if (log_responses == true) {
-		char buffer[9];
-		timestamp(&buffer);
 		va_list args;
 		va_start(args, message);
-		print(stdout, buffer, "tx", bold, message, args);
+		emit(1, message, args);
 		va_end(args);
 	}
 }
 
-void req(const char *message, ...) {
+void (req)(const char *message, ...) {
 	if (log_requests == true) {
-		char buffer[9];
-		timestamp(&buffer);
 		va_list args;
 		va_start(args, message);
-		print(stdout, buffer, "req", bold, message, args);
+		emit(2, message, args);
 		va_end(args);
 	}
 }
 
-void res(const char *message, ...) {
+void (res)(const char *message, ...) {
 	if (log_responses == true) {
-		char buffer[9];
-		timestamp(&buffer);
 		va_list args;
 		va_start(args, message);
-		print(stdout, buffer, "res", bold, message, args);
+		emit(3, message, args);
 		va_end(args);
 	}
 }
 
-void trace(const char *message, ...) {
+void (trace)(const char *message, ...) {
 	if (log_level >= 6) {
-		char buffer[9];
-		timestamp(&buffer);
 		va_list args;
 		va_start(args, message);
-		print(stdout, buffer, "trace", blue, message, args);
+		emit(4, message, args);
 		va_end(args);
 	}
 }
 
-void debug(const char *message, ...) {
+void (debug)(const char *message, ...) {
 	if (log_level >= 5) {
-		char buffer[9];
-		timestamp(&buffer);
 		va_list args;
 		va_start(args, message);
-		print(stdout, buffer, "debug", cyan, message, args);
+		emit(5, message, args);
 		va_end(args);
 	}
 }
 
-void info(const char *message, ...) {
+void (trace_hex)(const char *message, const uint8_t *bytes, uint16_t len) {
+	if (log_level >= 6) {
+		emit_hex(4, message, bytes, len);
+	}
+}
+
+void (info)(const char *message, ...) {
 	if (log_level >= 4) {
-		char buffer[9];
-		timestamp(&buffer);
 		va_list args;
 		va_start(args, message);
-		print(stdout, buffer, "info", green, message, args);
+		emit(6, message, args);
 		va_end(args);
 	}
 }
 
 void warn(const char *message, ...) {
 	if (log_level >= 3) {
-		char buffer[9];
-		timestamp(&buffer);
 		va_list args;
 		va_start(args, message);
-		print(stderr, buffer, "warn", yellow, message, args);
+		emit(7, message, args);
 		va_end(args);
 	}
 }
 
 void error(const char *message, ...) {
 	if (log_level >= 2) {
-		char buffer[9];
-		timestamp(&buffer);
 		va_list args;
 		va_start(args, message);
-		print(stderr, buffer, "error", red, message, args);
+		emit(8, message, args);
 		va_end(args);
 	}
 }
 
 void fatal(const char *message, ...) {
 	if (log_level >= 1) {
-		char buffer[9];
-		timestamp(&buffer);
 		va_list args;
 		va_start(args, message);
-		print(stderr, buffer, "fatal", purple, message, args);
+		emit(9, message, args);
 		va_end(args);
 	}
 }
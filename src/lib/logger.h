@@ -1,6 +1,45 @@
 #pragma once
 
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef struct record_t {
+	uint8_t level;
+	uint16_t len;
+	uint16_t hex;
+	char text[506];
+} record_t;
+
+typedef struct ring_t {
+	record_t *records;
+	_Alignas(64) atomic_uint_fast32_t head;
+	_Alignas(64) atomic_uint_fast32_t tail;
+	atomic_bool claimed;
+	atomic_uint dropped;
+} ring_t;
+
+typedef struct logs_t {
+	ring_t rings[64];
+	record_t *records;
+	pthread_t thread;
+	pthread_key_t key;
+	atomic_bool running;
+	atomic_bool stopping;
+	atomic_uint wake;
+	atomic_uint_fast64_t dropped;
+} logs_t;
+
+extern struct logs_t logs;
+
+extern uint8_t log_level;
+extern bool log_requests;
+extern bool log_responses;
+
 void logger_init(void);
+int logger_start(void);
+void logger_stop(void);
 
 void rx(const char *message, ...) __attribute__((format(printf, 1, 2)));
 void tx(const char *message, ...) __attribute__((format(printf, 1, 2)));
@@ -14,3 +53,20 @@ void info(const char *message, ...) __attribute__((format(printf, 1, 2)));
 void warn(const char *message, ...) __attribute__((format(printf, 1, 2)));
 void error(const char *message, ...) __attribute__((format(printf, 1, 2)));
 void fatal(const char *message, ...) __attribute__((format(printf, 1, 2)));
+
+void trace_hex(const char *message, const uint8_t *bytes, uint16_t len);
+
+#if defined(strip_level)
+#define log_enabled(level) ((level) <= strip_level && log_level >= (level))
+#else
+#define log_enabled(level) (log_level >= (level))
+#endif
+
+#define rx(...) (log_requests == true ? (rx)(__VA_ARGS__) : (void)0)
+#define tx(...) (log_responses == true ? (tx)(__VA_ARGS__) : (void)0)
+#define req(...) (log_requests == true ? (req)(__VA_ARGS__) : (void)0)
+#define res(...) (log_responses == true ? (res)(__VA_ARGS__) : (void)0)
+#define trace(...) (log_enabled(6) ? (trace)(__VA_ARGS__) : (void)0)
+#define debug(...) (log_enabled(5) ? (debug)(__VA_ARGS__) : (void)0)
+#define info(...) (log_enabled(4) ? (info)(__VA_ARGS__) : (void)0)
+#define trace_hex(...) (log_enabled(6) ? (trace_hex)(__VA_ARGS__) : (void)0)
@@ -0,0 +1,547 @@
+#define _GNU_SOURCE
+
+#include "loop.h"
+#include "../api/transmission.h"
+#include "config.h"
+#include "error.h"
+#include "logger.h"
+#include "thread.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+static const uint8_t conn_reading = 0;
+static const uint8_t conn_working = 1;
+static const uint8_t conn_writing = 2;
+
+loops_t loops = {
+		.ptr = NULL,
+		.len = 0,
+		.stopping = false,
+};
+
+int loop_arm(conn_t *conn, uint32_t events) {
+	struct epoll_event event = {.events = events | EPOLLONESHOT, .data.ptr = conn};
+	if (epoll_ctl(conn->loop->epoll, EPOLL_CTL_MOD, conn->sock, &event) == -1) {
+		error("failed to arm client socket because %s\n", errno_str());
+		return -1;
+	}
+	return 0;
+}
+
+void loop_close(conn_t *conn) {
+	loop_t *loop = conn->loop;
+
+	if (conn->prev != NULL) {
+		conn->prev->next = conn->next;
+	} else {
+		loop->conns = conn->next;
+	}
+	if (conn->next != NULL) {
+		conn->next->prev = conn->prev;
+	}
+
+	if (conn->stream == true) {
+		if (epoll_ctl(loop->epoll, EPOLL_CTL_DEL, conn->sock, NULL) == -1) {
+			error("failed to detach client socket because %s\n", errno_str());
+		}
+		if (fcntl(conn->sock, F_SETFL, fcntl(conn->sock, F_GETFL) & ~O_NONBLOCK) == -1) {
+			error("failed to set client socket blocking because %s\n", errno_str());
+		}
+		if (setsockopt(conn->sock, SOL_SOCKET, SO_SNDTIMEO, &(struct timeval){.tv_sec = send_timeout, .tv_usec = 0},
+									 sizeof(struct timeval)) == -1) {
+			error("failed to set socket send timeout because %s\n", errno_str());
+		}
+		transmission_attach(conn->sock);
+	} else if (close(conn->sock) == -1) {
+		error("failed to close client socket because %s\n", errno_str());
+	}
+
+	free(conn->request_buffer);
+	free(conn->response_buffer);
+	free(conn);
+}
+
+void loop_accept(loop_t *loop) {
+	while (true) {
+		struct sockaddr_in client_addr;
+		int client_sock =
+				accept4(loop->listen, (struct sockaddr *)&client_addr, &(socklen_t){sizeof(client_addr)}, SOCK_NONBLOCK | SOCK_CLOEXEC);
+
+		if (client_sock == -1) {
+			if (errno != EAGAIN && errno != EWOULDBLOCK && atomic_load(&loops.stopping) == false) {
+				error("failed to accept client because %s\n", errno_str());
+			}
+			return;
+		}
+
+		conn_t *conn = calloc(1, sizeof(*conn));
+		if (conn == NULL) {
+			error("failed to allocate %zu bytes for connection because %s\n", sizeof(*conn), errno_str());
+			close(client_sock);
+			continue;
+		}
+
+		conn->sock = client_sock;
+		memcpy(&conn->addr, &client_addr, sizeof(client_addr));
+		conn->loop = loop;
+		conn->state = conn_reading;
+		conn->active_at = time(NULL);
+
+		struct epoll_event event = {.events = EPOLLIN | EPOLLONESHOT, .data.ptr = conn};
+		if (epoll_ctl(loop->epoll, EPOLL_CTL_ADD, client_sock, &event) == -1) {
+			error("failed to watch client socket because %s\n", errno_str());
+			close(client_sock);
+			free(conn);
+			continue;
+		}
+
+		conn->next = loop->conns;
+		if (loop->conns != NULL) {
+			loop->conns->prev = conn;
+		}
+		loop->conns = conn;
+
+		trace("loop thread %hhu accepted %s:%d\n", loop->id, inet_ntoa(client_addr.sin_addr), ntohs(client_addr.sin_port));
+	}
+}
+
+bool loop_framed(conn_t *conn) {
+	conn->request_length = conn->request_len;
+	conn->keep_alive = false;
+
+	if (request_parse(&conn->parser, conn->request_buffer, conn->request_len) == true) {
+		if (conn->parser.status != 0) {
+			return true;
+		}
+
+		size_t request_length = (size_t)conn->parser.body + conn->parser.content_length;
+		if (request_length > receive_buffer) {
+			warn("request length %zu exceeds buffer length %u\n", request_length, receive_buffer);
+			return true;
+		}
+
+		if (conn->request_len >= request_length) {
+			conn->request_length = (uint32_t)request_length;
+			conn->keep_alive = true;
+			return true;
+		}
+
+		if (conn->received_packets >= receive_packets) {
+			warn("packets received %hhu exceeds allowed packets %hhu\n", conn->received_packets, receive_packets);
+			return true;
+		}
+
+		return false;
+	}
+
+	return conn->request_len >= receive_buffer;
+}
+
+void loop_dispatch(conn_t *conn) {
+	conn->state = conn_working;
+	if (queue_push(&(task_t){.conn = conn}) == true) {
+		return;
+	}
+
+	warn("rejecting request from %s:%d because queue size %hu is full\n", inet_ntoa(conn->addr.sin_addr),
+			 ntohs(conn->addr.sin_port), queue.cap);
+
+	const char busy[] = "HTTP/1.1 503 Service Unavailable\r\ncontent-length:0\r\nconnection:close\r\n\r\n";
+	conn->response_buffer = malloc(sizeof(busy) - 1);
+	if (conn->response_buffer == NULL) {
+		error("failed to allocate %zu bytes for response because %s\n", sizeof(busy) - 1, errno_str());
+		loop_close(conn);
+		return;
+	}
+	memcpy(conn->response_buffer, busy, sizeof(busy) - 1);
+	conn->response_len = sizeof(busy) - 1;
+	conn->response_pos = 0;
+	conn->keep_alive = false;
+
+	conn->state = conn_writing;
+	if (loop_arm(conn, EPOLLOUT) == -1) {
+		loop_close(conn);
+	}
+}
+
+void loop_receive(conn_t *conn) {
+	while (true) {
+		if (conn->request_len == conn->request_cap) {
+			if (conn->request_cap >= receive_buffer) {
+				break;
+			}
+			uint32_t request_cap = conn->request_cap == 0 ? 4096 : conn->request_cap * 2;
+			if (request_cap > receive_buffer) {
+				request_cap = receive_buffer;
+			}
+			char *request_buffer = realloc(conn->request_buffer, request_cap);
+			if (request_buffer == NULL) {
+				error("failed to allocate %u bytes because %s\n", request_cap, errno_str());
+				loop_close(conn);
+				return;
+			}
+			conn->request_buffer = request_buffer;
+			conn->request_cap = request_cap;
+		}
+
+		ssize_t received = recv(conn->sock, &conn->request_buffer[conn->request_len], conn->request_cap - conn->request_len, 0);
+
+		if (received == -1) {
+			if (errno == EAGAIN || errno == EWOULDBLOCK) {
+				break;
+			}
+			error("failed to receive data from client because %s\n", errno_str());
+			loop_close(conn);
+			return;
+		}
+		if (received == 0) {
+			if (conn->request_len == 0 && conn->served > 0) {
+				trace("client closed connection after %hhu requests\n", conn->served);
+			} else if (conn->request_len == 0) {
+				warn("client did not send any data\n");
+			} else {
+				warn("client did not send any further data\n");
+			}
+			loop_close(conn);
+			return;
+		}
+
+		conn->request_len += (uint32_t)received;
+		conn->received_packets++;
+		conn->active_at = time(NULL);
+	}
+
+	if (loop_framed(conn) == false) {
+		if (loop_arm(conn, EPOLLIN) == -1) {
+			loop_close(conn);
+		}
+		return;
+	}
+
+	loop_dispatch(conn);
+}
+
+void loop_finish(conn_t *conn) {
+	if (conn->stream == true || conn->keep_alive == false) {
+		loop_close(conn);
+		return;
+	}
+
+	conn->served++;
+	conn->request_len -= conn->request_length;
+	if (conn->request_len > 0) {
+		memmove(conn->request_buffer, &conn->request_buffer[conn->request_length], conn->request_len);
+		trace("pipelined %u bytes after request %hhu\n", conn->request_len, conn->served);
+	}
+	conn->request_length = 0;
+	conn->received_packets = 0;
+	request_reset(&conn->parser);
+
+	free(conn->response_buffer);
+	conn->response_buffer = NULL;
+	conn->response_len = 0;
+	conn->response_pos = 0;
+	conn->sent_packets = 0;
+
+	conn->state = conn_reading;
+	conn->active_at = time(NULL);
+
+	if (conn->request_len > 0 && loop_framed(conn) == true) {
+		loop_dispatch(conn);
+		return;
+	}
+
+	if (loop_arm(conn, EPOLLIN) == -1) {
+		loop_close(conn);
+	}
+}
+
+void loop_send(conn_t *conn) {
+	while (conn->response_pos < conn->response_len) {
+		if (conn->sent_packets + 1 > send_packets) {
+			warn("packets sent %hhu exceeds allowed packets %hhu\n", conn->sent_packets, send_packets);
+			loop_close(conn);
+			return;
+		}
+
+		ssize_t sent = send(conn->sock, &conn->response_buffer[conn->response_pos], conn->response_len - conn->response_pos,
+												MSG_NOSIGNAL);
+
+		if (sent == -1) {
+			if (errno == EAGAIN || errno == EWOULDBLOCK) {
+				if (loop_arm(conn, EPOLLOUT) == -1) {
+					loop_close(conn);
+				}
+				return;
+			}
+			error("failed to send further data to client because %s\n", errno_str());
+			loop_close(conn);
+			return;
+		}
+		if (sent == 0) {
+			warn("server did not send any further data\n");
+			loop_close(conn);
+			return;
+		}
+
+		conn->response_pos += (uint32_t)sent;
+		conn->sent_packets++;
+		conn->active_at = time(NULL);
+	}
+
+	trace("sent %u bytes in %hhu packets to %s:%d\n", conn->response_len, conn->sent_packets, inet_ntoa(conn->addr.sin_addr),
+				ntohs(conn->addr.sin_port));
+
+	loop_finish(conn);
+}
+
+void loop_settle(loop_t *loop) {
+	pthread_mutex_lock(&loop->lock);
+	conn_t *ready = loop->ready;
+	loop->ready = NULL;
+	pthread_mutex_unlock(&loop->lock);
+
+	while (ready != NULL) {
+		conn_t *conn = ready;
+		ready = conn->ready;
+		conn->ready = NULL;
+
+		if (conn->closing == true) {
+			loop_close(conn);
+			continue;
+		}
+
+		if (conn->response_pos >= conn->response_len) {
+			loop_finish(conn);
+			continue;
+		}
+
+		conn->state = conn_writing;
+		conn->active_at = time(NULL);
+		if (loop_arm(conn, EPOLLOUT) == -1) {
+			loop_close(conn);
+		}
+	}
+}
+
+void loop_sweep(loop_t *loop) {
+	time_t now = time(NULL);
+
+	conn_t *conn = loop->conns;
+	while (conn != NULL) {
+		conn_t *next = conn->next;
+		if (conn->state == conn_reading && conn->request_len == 0 && conn->served > 0) {
+			if (conn->active_at + alive_timeout < now) {
+				trace("client %s:%d idled out after %hhu requests\n", inet_ntoa(conn->addr.sin_addr), ntohs(conn->addr.sin_port),
+							conn->served);
+				loop_close(conn);
+			}
+		} else if (conn->state == conn_reading && conn->active_at + receive_timeout < now) {
+			warn("client %s:%d timed out receiving\n", inet_ntoa(conn->addr.sin_addr), ntohs(conn->addr.sin_port));
+			loop_close(conn);
+		} else if (conn->state == conn_writing && conn->active_at + send_timeout < now) {
+			warn("client %s:%d timed out sending\n", inet_ntoa(conn->addr.sin_addr), ntohs(conn->addr.sin_port));
+			loop_close(conn);
+		}
+		conn = next;
+	}
+}
+
+int loop_listener(struct sockaddr_in *server_addr) {
+	int sock = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, IPPROTO_TCP);
+	if (sock == -1) {
+		fatal("failed to create socket because %s\n", errno_str());
+		return -1;
+	}
+
+	if (setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, (int[]){1}, sizeof(int)) == -1) {
+		fatal("failed to set socket reuse address because %s\n", errno_str());
+		goto cleanup;
+	}
+
+	if (setsockopt(sock, SOL_SOCKET, SO_REUSEPORT, (int[]){1}, sizeof(int)) == -1) {
+		fatal("failed to set socket reuse port because %s\n", errno_str());
+		goto cleanup;
+	}
+
+	if (bind(sock, (struct sockaddr *)server_addr, sizeof(*server_addr)) == -1) {
+		fatal("failed to bind to socket because %s\n", errno_str());
+		goto cleanup;
+	}
+
+	if (listen(sock, backlog) == -1) {
+		fatal("failed to listen on socket because %s\n", errno_str());
+		goto cleanup;
+	}
+
+	return sock;
+
+cleanup:
+	close(sock);
+	return -1;
+}
+
+int loop_init(int server_sock, struct sockaddr_in *server_addr) {
+	if (fcntl(server_sock, F_SETFL, fcntl(server_sock, F_GETFL) | O_NONBLOCK) == -1) {
+		fatal("failed to set socket non blocking because %s\n", errno_str());
+		return -1;
+	}
+
+	loops.ptr = calloc(io_threads, sizeof(*loops.ptr));
+	if (loops.ptr == NULL) {
+		fatal("failed to allocate %zu bytes for loops because %s\n", io_threads * sizeof(*loops.ptr), errno_str());
+		return -1;
+	}
+
+	for (uint8_t index = 0; index < io_threads; index++) {
+		loop_t *loop = &loops.ptr[index];
+		loop->id = index;
+		loop->listen = server_sock;
+
+		if (reuse_port == true && index > 0 && (loop->listen = loop_listener(server_addr)) == -1) {
+			return -1;
+		}
+
+		if ((errno = pthread_mutex_init(&loop->lock, NULL)) != 0) {
+			fatal("failed to initialise loop lock because %s\n", errno_str());
+			return -1;
+		}
+
+		if ((loop->epoll = epoll_create1(EPOLL_CLOEXEC)) == -1) {
+			fatal("failed to create epoll because %s\n", errno_str());
+			return -1;
+		}
+
+		if ((loop->event = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) == -1) {
+			fatal("failed to create eventfd because %s\n", errno_str());
+			return -1;
+		}
+
+		struct epoll_event event = {.events = EPOLLIN, .data.ptr = loop};
+		if (epoll_ctl(loop->epoll, EPOLL_CTL_ADD, loop->event, &event) == -1) {
+			fatal("failed to watch eventfd because %s\n", errno_str());
+			return -1;
+		}
+
+		uint32_t listen_events = reuse_port == true ? EPOLLIN : EPOLLIN | EPOLLEXCLUSIVE;
+		struct epoll_event listen_event = {.events = listen_events, .data.ptr = NULL};
+		if (epoll_ctl(loop->epoll, EPOLL_CTL_ADD, loop->listen, &listen_event) == -1) {
+			fatal("failed to watch socket because %s\n", errno_str());
+			return -1;
+		}
+
+		if ((errno = pthread_create(&loop->thread, NULL, &loop_thread, loop)) != 0) {
+			fatal("failed to spawn loop thread because %s\n", errno_str());
+			return -1;
+		}
+
+		loops.len++;
+	}
+
+	info("spawned %hhu loop threads\n", loops.len);
+	return 0;
+}
+
+void loop_wake(void) {
+	for (uint8_t index = 0; index < loops.len; index++) {
+		if (write(loops.ptr[index].event, &(uint64_t){1}, sizeof(uint64_t)) == -1) {
+			continue;
+		}
+	}
+}
+
+void loop_join(void) {
+	for (uint8_t index = 0; index < loops.len; index++) {
+		trace("joining loop thread %hhu\n", index);
+		if ((errno = pthread_join(loops.ptr[index].thread, NULL)) != 0) {
+			error("failed to join loop thread %hhu because %s\n", index, errno_str());
+		}
+	}
+}
+
+void loop_free(void) {
+	for (uint8_t index = 0; index < loops.len; index++) {
+		loop_t *loop = &loops.ptr[index];
+		while (loop->conns != NULL) {
+			loop_close(loop->conns);
+		}
+		if (loop->listen != loops.ptr[0].listen) {
+			close(loop->listen);
+		}
+		close(loop->event);
+		close(loop->epoll);
+		pthread_mutex_destroy(&loop->lock);
+	}
+
+	free(loops.ptr);
+	loops.ptr = NULL;
+	loops.len = 0;
+}
+
+void loop_return(conn_t *conn) {
+	loop_t *loop = conn->loop;
+
+	pthread_mutex_lock(&loop->lock);
+	conn->ready = loop->ready;
+	loop->ready = conn;
+	pthread_mutex_unlock(&loop->lock);
+
+	if (write(loop->event, &(uint64_t){1}, sizeof(uint64_t)) == -1) {
+		error("failed to wake loop thread %hhu because %s\n", loop->id, errno_str());
+	}
+}
+
+void *loop_thread(void *args) {
+	loop_t *loop = (loop_t *)args;
+
+	struct epoll_event events[64];
+	time_t swept_at = time(NULL);
+
+	while (atomic_load(&loops.stopping) == false) {
+		int events_len = epoll_wait(loop->epoll, events, sizeof(events) / sizeof(*events), 1000);
+		if (events_len == -1) {
+			if (errno != EINTR) {
+				error("failed to wait for events because %s\n", errno_str());
+			}
+			continue;
+		}
+
+		for (int index = 0; index < events_len; index++) {
+			if (events[index].data.ptr == NULL) {
+				loop_accept(loop);
+			} else if (events[index].data.ptr == loop) {
+				uint64_t value;
+				if (read(loop->event, &value, sizeof(value)) == -1 && errno != EAGAIN) {
+					error("failed to read eventfd because %s\n", errno_str());
+				}
+				loop_settle(loop);
+			} else {
+				conn_t *conn = events[index].data.ptr;
+				if (conn->state == conn_writing) {
+					loop_send(conn);
+				} else {
+					loop_receive(conn);
+				}
+			}
+		}
+
+		time_t now = time(NULL);
+		if (now != swept_at) {
+			loop_sweep(loop);
+			swept_at = now;
+		}
+	}
+
+	trace("loop thread %hhu stopping\n", loop->id);
+	return NULL;
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "request.h"
+#include <arpa/inet.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+
+typedef struct loop_t loop_t;
+
+typedef struct conn_t {
+	int sock;
+	struct sockaddr_in addr;
+	loop_t *loop;
+	uint8_t state;
+	char *request_buffer;
+	uint32_t request_len;
+	uint32_t request_cap;
+	uint32_t request_length;
+	parser_t parser;
+	uint8_t received_packets;
+	char *response_buffer;
+	uint32_t response_len;
+	uint32_t response_pos;
+	uint8_t sent_packets;
+	uint8_t served;
+	bool keep_alive;
+	bool stream;
+	bool closing;
+	time_t active_at;
+	struct conn_t *prev;
+	struct conn_t *next;
+	struct conn_t *ready;
+} conn_t;
+
+struct loop_t {
+	uint8_t id;
+	int epoll;
+	int event;
+	int listen;
+	pthread_t thread;
+	conn_t *conns;
+	conn_t *ready;
+	pthread_mutex_t lock;
+};
+
+typedef struct loops_t {
+	loop_t *ptr;
+	uint8_t len;
+	atomic_bool stopping;
+} loops_t;
+
+extern struct loops_t loops;
+
+int loop_init(int server_sock, struct sockaddr_in *server_addr);
+void loop_wake(void);
+void loop_join(void);
+void loop_free(void);
+
+void loop_return(conn_t *conn);
+
+void *loop_thread(void *args);
@@ -0,0 +1,120 @@
+#include "metrics.h"
+#include "error.h"
+#include "logger.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+metrics_t metrics = {.shards = NULL, .len = 0, .next = 0};
+
+const int16_t rssi_origin = -164;
+const uint8_t rssi_step = 8;
+const int16_t snr_origin = -24;
+const uint8_t snr_step = 2;
+const int16_t airtime_error_origin = -3000;
+const uint8_t airtime_error_step = 250;
+
+static _Thread_local shard_t *local = NULL;
+
+int metrics_init(void) {
+	metrics.len = 16;
+	metrics.shards = aligned_alloc(64, metrics.len * sizeof(shard_t));
+	if (metrics.shards == NULL) {
+		fatal("failed to allocate %zu bytes for metrics because %s\n", metrics.len * sizeof(shard_t), errno_str());
+		return -1;
+	}
+
+	memset(metrics.shards, 0, metrics.len * sizeof(shard_t));
+	return 0;
+}
+
+void metrics_free(void) {
+	free(metrics.shards);
+	metrics.shards = NULL;
+	metrics.len = 0;
+}
+
+shard_t *metric_shard(void) {
+	if (local == NULL) {
+		local = &metrics.shards[atomic_fetch_add_explicit(&metrics.next, 1, memory_order_relaxed) % metrics.len];
+	}
+	return local;
+}
+
+void metric_count(atomic_uint_fast64_t *counter, uint64_t value) {
+	atomic_fetch_add_explicit(counter, value, memory_order_relaxed);
+}
+
+uint8_t metric_bucket(uint64_t value) {
+	if (value < 2) {
+		return (uint8_t)value;
+	}
+
+	uint8_t octave = (uint8_t)(63 - __builtin_clzll(value));
+	uint8_t bucket = (uint8_t)(octave * 2 + ((value >> (octave - 1)) & 1));
+	return bucket < 48 ? bucket : 47;
+}
+
+uint64_t metric_bound(uint8_t bucket) {
+	if (bucket < 2) {
+		return bucket;
+	}
+
+	uint8_t octave = bucket / 2;
+	return (1ull << octave) + ((uint64_t)(bucket % 2 + 1) << (octave - 1)) - 1;
+}
+
+void metric_observe(histogram_t *histogram, uint64_t value) {
+	atomic_fetch_add_explicit(&histogram->buckets[metric_bucket(value)], 1, memory_order_relaxed);
+	atomic_fetch_add_explicit(&histogram->sum, value, memory_order_relaxed);
+}
+
+void metric_spread(spread_t *spread, int32_t value, int16_t origin, uint8_t step) {
+	int32_t bucket = (value - origin) / step;
+	if (bucket < 0) {
+		bucket = 0;
+	}
+	if (bucket > 23) {
+		bucket = 23;
+	}
+
+	atomic_fetch_add_explicit(&spread->buckets[bucket], 1, memory_order_relaxed);
+	atomic_fetch_add_explicit(&spread->sum, value, memory_order_relaxed);
+}
+
+uint64_t metric_elapsed(struct timespec *start) {
+	struct timespec stop;
+	clock_gettime(CLOCK_MONOTONIC, &stop);
+	return (uint64_t)((stop.tv_sec - start->tv_sec) * 1000000 + (stop.tv_nsec - start->tv_nsec) / 1000);
+}
+
+uint64_t metric_total(atomic_uint_fast64_t *counter) {
+	size_t offset = (size_t)((uint8_t *)counter - (uint8_t *)&metrics.shards[0]);
+
+	uint64_t total = 0;
+	for (uint8_t index = 0; index < metrics.len; index++) {
+		total += atomic_load_explicit((atomic_uint_fast64_t *)((uint8_t *)&metrics.shards[index] + offset), memory_order_relaxed);
+	}
+	return total;
+}
+
+void metric_merge(histogram_t *histogram, uint64_t (*buckets)[48], uint64_t *sum) {
+	for (uint8_t bucket = 0; bucket < 48; bucket++) {
+		(*buckets)[bucket] = metric_total(&histogram->buckets[bucket]);
+	}
+	*sum = metric_total(&histogram->sum);
+}
+
+void metric_gather(spread_t *spread, uint64_t (*buckets)[24], int64_t *sum) {
+	for (uint8_t bucket = 0; bucket < 24; bucket++) {
+		(*buckets)[bucket] = metric_total(&spread->buckets[bucket]);
+	}
+
+	size_t offset = (size_t)((uint8_t *)&spread->sum - (uint8_t *)&metrics.shards[0]);
+	*sum = 0;
+	for (uint8_t index = 0; index < metrics.len; index++) {
+		*sum += atomic_load_explicit((atomic_int_fast64_t *)((uint8_t *)&metrics.shards[index] + offset), memory_order_relaxed);
+	}
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <stdatomic.h>
+#include <stdint.h>
+#include <time.h>
+
+typedef struct histogram_t {
+	atomic_uint_fast64_t buckets[48];
+	atomic_uint_fast64_t sum;
+} histogram_t;
+
+typedef struct spread_t {
+	atomic_uint_fast64_t buckets[24];
+	atomic_int_fast64_t sum;
+} spread_t;
+
+typedef struct shard_t {
+	_Alignas(64) atomic_uint_fast64_t requests[32];
+	atomic_uint_fast64_t received_bytes[32];
+	atomic_uint_fast64_t sent_bytes[32];
+	histogram_t latency[32];
+	atomic_uint_fast64_t grown;
+	atomic_uint_fast64_t shrunk;
+	atomic_uint_fast64_t receives;
+	atomic_uint_fast64_t transmits;
+	atomic_uint_fast64_t corrupts;
+	atomic_uint_fast64_t deadline_misses;
+	atomic_uint_fast64_t drops;
+	spread_t rssi;
+	spread_t snr;
+	spread_t airtime_error;
+	histogram_t turnaround;
+	histogram_t uplink_wait;
+	histogram_t uplink_forward;
+	histogram_t downlink_wait;
+	histogram_t downlink_forward;
+	histogram_t transmission_wait;
+} shard_t;
+
+typedef struct metrics_t {
+	shard_t *shards;
+	uint8_t len;
+	atomic_uint next;
+} metrics_t;
+
+extern struct metrics_t metrics;
+
+extern const int16_t rssi_origin;
+extern const uint8_t rssi_step;
+extern const int16_t snr_origin;
+extern const uint8_t snr_step;
+extern const int16_t airtime_error_origin;
+extern const uint8_t airtime_error_step;
+
+int metrics_init(void);
+void metrics_free(void);
+
+shard_t *metric_shard(void);
+void metric_count(atomic_uint_fast64_t *counter, uint64_t value);
+void metric_observe(histogram_t *histogram, uint64_t value);
+void metric_spread(spread_t *spread, int32_t value, int16_t origin, uint8_t step);
+uint64_t metric_elapsed(struct timespec *start);
+
+uint64_t metric_bound(uint8_t bucket);
+uint64_t metric_total(atomic_uint_fast64_t *counter);
+void metric_merge(histogram_t *histogram, uint64_t (*buckets)[48], uint64_t *sum);
+void metric_gather(spread_t *spread, uint64_t (*buckets)[24], int64_t *sum);
@@ -1,6 +1,7 @@
 #include "request.h"
 #include "config.h"
 #include "response.h"
+#include "scan.h"
 #include "strn.h"
 #include <stdbool.h>
 #include <stdint.h>
@@ -36,156 +37,333 @@ void request_init(request_t *request, int *client_sock) {
 	request->socket = *client_sock;
 }
 
-void request(char *buffer, size_t length, request_t *req, response_t *res) {
-	uint8_t stage = 0;
-	size_t index = 0;
+void request_reset(parser_t *parser) { memset(parser, 0, sizeof(*parser)); }
 
-	const size_t method_index = index;
-	while (stage == 0 && req->method.len < req->method.cap && index < length) {
-		char *byte = &buffer[index];
-		if (*byte >= 'A' && *byte <= 'Z') {
-			*byte += 32;
-		}
-		if (*byte == ' ') {
-			stage = 1;
-		} else if (*byte <= '\037') {
-			res->status = 400;
-			return;
-		} else {
-			req->method.len++;
-		}
-		index++;
+void request_method(parser_t *parser, char *byte) {
+	if (*byte >= 'A' && *byte <= 'Z') {
+		*byte += 32;
 	}
-	req->method.ptr = &buffer[method_index];
-	if (stage == 0 || req->method.len == 0) {
-		res->status = 501;
-		return;
+	if (*byte == ' ') {
+		if (parser->method_len == 0) {
+			parser->status = 501;
+		}
+		parser->stage = 1;
+		parser->pathname = parser->index + 1;
+	} else if (*byte <= '\037') {
+		parser->status = 400;
+	} else if (++parser->method_len >= 8) {
+		parser->status = 501;
 	}
+}
 
-	const size_t pathname_index = index;
-	while (stage == 1 && req->pathname.len < req->pathname.cap && index < length) {
-		char *byte = &buffer[index];
-		if (*byte == '?') {
-			stage = 2;
-		} else if (*byte == ' ') {
-			stage = 3;
-		} else if (*byte <= '\037') {
-			res->status = 400;
-			return;
-		} else {
-			req->pathname.len++;
+void request_pathname(parser_t *parser, char *byte) {
+	if (*byte == '?' || *byte == ' ') {
+		if (parser->pathname_len == 0) {
+			parser->status = 414;
 		}
-		index++;
+		parser->stage = *byte == '?' ? 2 : 3;
+		parser->search = parser->index + 1;
+		parser->protocol = parser->index + 1;
+	} else if (*byte <= '\037') {
+		parser->status = 400;
+	} else if (++parser->pathname_len >= 128) {
+		parser->status = 414;
 	}
-	req->pathname.ptr = &buffer[pathname_index];
-	if (stage == 1 || req->pathname.len == 0) {
-		res->status = 414;
-		return;
+}
+
+void request_search(parser_t *parser, char *byte) {
+	if (*byte == ' ') {
+		parser->stage = 3;
+		parser->protocol = parser->index + 1;
+	} else if (*byte <= '\037') {
+		parser->status = 400;
+	} else if (++parser->search_len >= 256) {
+		parser->status = 414;
 	}
+}
 
-	const size_t search_index = index;
-	while (stage == 2 && req->search.len < req->search.cap && index < length) {
-		char *byte = &buffer[index];
-		if (*byte == ' ') {
-			stage = 3;
-		} else if (*byte <= '\037') {
-			res->status = 400;
-			return;
-		} else {
-			req->search.len++;
+void request_protocol(parser_t *parser, char *byte) {
+	if (*byte >= 'A' && *byte <= 'Z') {
+		*byte += 32;
+	}
+	if (*byte == '\r' || *byte == '\n') {
+		if (parser->protocol_len == 0) {
+			parser->status = 505;
 		}
-		index++;
+		parser->stage = 4;
+	} else if (*byte <= '\037') {
+		parser->status = 400;
+	} else if (++parser->protocol_len >= 16) {
+		parser->status = 505;
 	}
-	req->search.ptr = &buffer[search_index];
-	if (stage == 2) {
-		res->status = 414;
-		return;
+}
+
+void request_break(parser_t *parser, char *byte) {
+	if (*byte == '\r' || *byte == '\n') {
+		parser->stage = 5;
+		parser->breaks = 2;
+		parser->header = parser->index + 1;
+		parser->line = parser->index + 1;
+	} else {
+		parser->status = 400;
 	}
+}
 
-	const size_t protocol_index = index;
-	while ((stage == 3 || stage == 4) && req->protocol.len < req->protocol.cap && index < length) {
-		char *byte = &buffer[index];
+void request_field(parser_t *parser, char *buffer, char *byte) {
+	if (parser->field == 0) {
 		if (*byte >= 'A' && *byte <= 'Z') {
 			*byte += 32;
 		}
-		if (*byte == '\r' || *byte == '\n') {
-			stage += 1;
-		} else if (*byte <= '\037') {
-			res->status = 400;
-			return;
+		if (*byte == ':') {
+			bool length = parser->index - parser->line == 14 && memcmp(&buffer[parser->line], "content-length", 14) == 0;
+			if (length == true && parser->sized == true) {
+				parser->status = 400;
+				return;
+			}
+			parser->sized = parser->sized || length;
+			parser->field = length == true ? 2 : 1;
+			parser->digits = false;
+			parser->colon = parser->index;
+		}
+	} else if (parser->field == 2) {
+		if (*byte >= '0' && *byte <= '9') {
+			if (parser->content_length <= receive_buffer) {
+				parser->content_length = parser->content_length * 10 + (uint32_t)(*byte - '0');
+			}
+			parser->digits = true;
+		} else if (*byte == ' ') {
+			parser->field = parser->digits == true ? 3 : 2;
 		} else {
-			req->protocol.len++;
+			parser->status = 400;
 		}
-		index++;
+	} else if (parser->field == 3 && *byte != ' ') {
+		parser->status = 400;
 	}
-	req->protocol.ptr = &buffer[protocol_index];
-	if (stage == 3 || req->protocol.len == 0) {
-		res->status = 505;
+}
+
+void request_entry(parser_t *parser, char *buffer) {
+	uint32_t key_len = parser->colon - parser->line;
+	if (parser->entries_len >= sizeof(parser->entries) / sizeof(*parser->entries) || key_len > 255) {
+		parser->overflow = true;
 		return;
 	}
-	if (stage == 4 || req->protocol.len == 0) {
-		res->status = 400;
-		return;
+
+	uint32_t value = parser->colon + 1;
+	uint32_t value_end = parser->index;
+	while (value < value_end && buffer[value] == ' ') {
+		value++;
+	}
+	while (value_end > value && buffer[value_end - 1] == ' ') {
+		value_end--;
 	}
 
-	bool header_key = true;
-	const size_t header_index = index;
-	while ((stage >= 3 && stage <= 6) && req->header.len < req->header.cap && index < length) {
-		char *byte = &buffer[index];
-		if (header_key == true && *byte >= 'A' && *byte <= 'Z') {
-			*byte += 32;
-		}
-		if (*byte == ':') {
-			header_key = false;
-		}
-		if (*byte == '\r' || *byte == '\n') {
-			header_key = true;
-			stage += 1;
-		} else if (*byte <= '\037') {
-			res->status = 400;
-			return;
-		} else {
-			stage = 3;
+	entry_t *entry = &parser->entries[parser->entries_len];
+	entry->key = parser->line;
+	entry->key_len = (uint8_t)key_len;
+	entry->value = value;
+	entry->value_len = (uint16_t)(value_end - value);
+	parser->entries_len++;
+}
+
+void request_header(parser_t *parser, char *buffer, char *byte) {
+	parser->header_len++;
+
+	if (*byte == '\r' || *byte == '\n') {
+		if (parser->field != 0) {
+			request_entry(parser, buffer);
 		}
-		req->header.len++;
-		index++;
-	}
-	req->header.ptr = &buffer[header_index];
-	if (stage >= 3 && stage <= 5) {
-		res->status = 431;
+		parser->breaks++;
+		parser->field = 0;
+		parser->line = parser->index + 1;
+	} else if (*byte <= '\037') {
+		parser->status = 400;
 		return;
+	} else {
+		parser->breaks = 0;
+		request_field(parser, buffer, byte);
 	}
-	if (stage == 6) {
-		res->status = 400;
+
+	if (parser->breaks == 4) {
+		parser->stage = 6;
+		parser->body = parser->index + 1;
 		return;
 	}
 
-	req->body.len = (uint32_t)(length - index);
-	req->body.ptr = &buffer[index];
+	if (parser->header_len >= 2048) {
+		parser->status = parser->breaks == 3 ? 400 : 431;
+	}
 }
 
-const char *param_find(request_t *request, uint8_t offset, uint8_t *length) {
-	if (request->pathname.len < offset) {
-		return NULL;
+uint32_t request_skip(parser_t *parser, char *bytes, uint32_t remaining) {
+	if (parser->stage == 0) {
+		uint32_t room = 8 - 1 - parser->method_len;
+		uint32_t skipped = scan_plain(bytes, remaining < room ? remaining : room, ' ', ' ', true);
+		parser->method_len = (uint8_t)(parser->method_len + skipped);
+		return skipped;
 	}
 
-	while (offset + *length < request->pathname.len) {
-		if (request->pathname.ptr[offset + *length] == '/') {
+	if (parser->stage == 1) {
+		uint32_t room = 128 - 1 - parser->pathname_len;
+		uint32_t skipped = scan_plain(bytes, remaining < room ? remaining : room, '?', ' ', false);
+		parser->pathname_len = (uint8_t)(parser->pathname_len + skipped);
+		return skipped;
+	}
+
+	if (parser->stage == 2) {
+		uint32_t room = 256 - 1 - parser->search_len;
+		uint32_t skipped = scan_plain(bytes, remaining < room ? remaining : room, ' ', ' ', false);
+		parser->search_len = (uint16_t)(parser->search_len + skipped);
+		return skipped;
+	}
+
+	if (parser->stage == 3) {
+		uint32_t room = 16 - 1 - parser->protocol_len;
+		uint32_t skipped = scan_plain(bytes, remaining < room ? remaining : room, '\r', '\n', true);
+		parser->protocol_len = (uint8_t)(parser->protocol_len + skipped);
+		return skipped;
+	}
+
+	if (parser->stage == 5 && parser->field < 2) {
+		uint32_t room = 2048 - 1 - parser->header_len;
+		uint32_t skipped = parser->field == 0 ? scan_plain(bytes, remaining < room ? remaining : room, ':', ':', true)
+																					: scan_plain(bytes, remaining < room ? remaining : room, '\r', '\n', false);
+		parser->header_len = (uint16_t)(parser->header_len + skipped);
+		if (skipped > 0) {
+			parser->breaks = 0;
+		}
+		return skipped;
+	}
+
+	return 0;
+}
+
+bool request_parse(parser_t *parser, char *buffer, uint32_t length) {
+	while (parser->status == 0 && parser->stage < 6 && parser->index < length) {
+		parser->index += request_skip(parser, &buffer[parser->index], length - parser->index);
+		if (parser->index >= length) {
 			break;
 		}
-		*length += 1;
+
+		char *byte = &buffer[parser->index];
+		if (parser->stage == 0) {
+			request_method(parser, byte);
+		} else if (parser->stage == 1) {
+			request_pathname(parser, byte);
+		} else if (parser->stage == 2) {
+			request_search(parser, byte);
+		} else if (parser->stage == 3) {
+			request_protocol(parser, byte);
+		} else if (parser->stage == 4) {
+			request_break(parser, byte);
+		} else {
+			request_header(parser, buffer, byte);
+		}
+		parser->index++;
 	}
 
-	return &request->pathname.ptr[offset];
+	return parser->status != 0 || parser->stage == 6;
 }
 
-const char *header_find(request_t *request, const char *key) {
-	const char *header = strncasestrn(request->header.ptr, request->header.len, key, strlen(key));
+void request(char *buffer, uint32_t length, parser_t *parser, request_t *req, response_t *res) {
+	if (parser->status == 0 && parser->stage < 6) {
+		if (parser->stage == 0) {
+			parser->status = 501;
+		} else if (parser->stage == 1 || parser->stage == 2) {
+			parser->status = 414;
+		} else if (parser->stage == 3) {
+			parser->status = 505;
+		} else if (parser->stage == 4 || parser->breaks == 3) {
+			parser->status = 400;
+		} else {
+			parser->status = 431;
+		}
+	}
+
+	req->method.ptr = buffer;
+	req->method.len = parser->method_len;
+	req->pathname.ptr = &buffer[parser->pathname];
+	req->pathname.len = parser->pathname_len;
+	req->search.ptr = &buffer[parser->search];
+	req->search.len = parser->search_len;
+	req->protocol.ptr = &buffer[parser->protocol];
+	req->protocol.len = parser->protocol_len;
+	req->header.ptr = &buffer[parser->header];
+	req->header.len = parser->header_len;
+	req->body.ptr = &buffer[parser->body];
+	req->body.len = 0;
+	req->body.pos = 0;
+
+	req->headers_len = parser->entries_len;
+	req->overflow = parser->overflow;
+	for (uint8_t index = 0; index < parser->entries_len; index++) {
+		req->headers[index].key = &buffer[parser->entries[index].key];
+		req->headers[index].key_len = parser->entries[index].key_len;
+		req->headers[index].value = &buffer[parser->entries[index].value];
+		req->headers[index].value_len = parser->entries[index].value_len;
+	}
+
+	req->param = NULL;
+	req->param_len = 0;
+
+	req->params_len = 0;
+	uint16_t start = 0;
+	while (start < req->search.len && req->params_len < sizeof(req->params) / sizeof(*req->params)) {
+		uint16_t end = start;
+		uint16_t equals = req->search.len;
+		while (end < req->search.len && req->search.ptr[end] != '&') {
+			if (equals == req->search.len && req->search.ptr[end] == '=') {
+				equals = end;
+			}
+			end++;
+		}
+		if (equals > end) {
+			equals = end;
+		}
+
+		if (equals > start) {
+			field_t *param = &req->params[req->params_len];
+			param->key = &req->search.ptr[start];
+			param->key_len = (uint8_t)(equals - start);
+			param->value = &req->search.ptr[equals < end ? equals + 1 : end];
+			param->value_len = (uint16_t)(equals < end ? end - equals - 1 : 0);
+			req->params_len++;
+		}
+		start = (uint16_t)(end + 1);
+	}
+
+	if (parser->status != 0) {
+		res->status = parser->status;
+		return;
+	}
+
+	req->body.len = length - parser->body;
+}
+
+const char *param_find(request_t *request, uint8_t *length) {
+	*length = request->param_len;
+	return request->param;
+}
+
+const char *header_find(request_t *request, const char *key, uint16_t *value_len) {
+	size_t key_len = strlen(key);
+	for (uint8_t index = 0; index < request->headers_len; index++) {
+		field_t *header = &request->headers[index];
+		if (header->key_len == key_len && memcmp(header->key, key, key_len) == 0) {
+			*value_len = header->value_len;
+			return header->value;
+		}
+	}
+
+	if (request->overflow == false) {
+		return NULL;
+	}
+
+	const char *header = strncasestrn(request->header.ptr, request->header.len, key, key_len);
 	if (header == NULL) {
 		return NULL;
 	}
 
-	header += strlen(key);
+	header += key_len;
 	if (header[0] == ':') {
 		header += 1;
 	}
@@ -193,9 +371,32 @@ const char *header_find(request_t *request, const char *key) {
 		header += 1;
 	}
 
+	const char *header_end = request->header.ptr + request->header.len;
+	*value_len = 0;
+	while (&header[*value_len] < header_end && header[*value_len] != '\r') {
+		*value_len += 1;
+	}
+
 	return header;
 }
 
+int search_find(request_t *request, const char *key, const char **value, size_t *value_len, size_t value_len_max) {
+	size_t key_len = strlen(key);
+	for (uint8_t index = 0; index < request->params_len; index++) {
+		field_t *param = &request->params[index];
+		if (param->key_len == key_len && memcmp(param->key, key, key_len) == 0) {
+			if (param->value_len > value_len_max) {
+				return -1;
+			}
+			*value = param->value;
+			*value_len = param->value_len;
+			return 0;
+		}
+	}
+
+	return -1;
+}
+
 const char *body_read(request_t *request, uint32_t length) {
 	char *ptr = &(request->body.ptr[request->body.pos]);
 	request->body.pos += length;
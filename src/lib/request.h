@@ -1,11 +1,19 @@
 #pragma once
 
 #include "strn.h"
+#include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
 
 typedef struct response_t response_t;
 
+typedef struct field_t {
+	const char *key;
+	uint8_t key_len;
+	const char *value;
+	uint16_t value_len;
+} field_t;
+
 typedef struct request_t {
 	strn8_t method;
 	strn8_t pathname;
@@ -13,12 +21,55 @@ typedef struct request_t {
 	strn8_t protocol;
 	strn16_t header;
 	strn32_t body;
+	field_t headers[24];
+	uint8_t headers_len;
+	field_t params[16];
+	uint8_t params_len;
+	const char *param;
+	uint8_t param_len;
+	bool overflow;
 	int socket;
 } request_t;
 
+typedef struct entry_t {
+	uint32_t key;
+	uint8_t key_len;
+	uint32_t value;
+	uint16_t value_len;
+} entry_t;
+
+typedef struct parser_t {
+	uint8_t stage;
+	uint8_t breaks;
+	uint8_t field;
+	bool digits;
+	bool sized;
+	uint16_t status;
+	uint32_t index;
+	uint32_t line;
+	uint32_t colon;
+	uint8_t method_len;
+	uint32_t pathname;
+	uint8_t pathname_len;
+	uint32_t search;
+	uint16_t search_len;
+	uint32_t protocol;
+	uint8_t protocol_len;
+	uint32_t header;
+	uint16_t header_len;
+	uint32_t body;
+	uint32_t content_length;
+	entry_t entries[24];
+	uint8_t entries_len;
+	bool overflow;
+} parser_t;
+
 void request_init(request_t *request, int *client_sock);
-void request(char *buffer, size_t length, request_t *req, response_t *res);
+void request_reset(parser_t *parser);
+bool request_parse(parser_t *parser, char *buffer, uint32_t length);
+void request(char *buffer, uint32_t length, parser_t *parser, request_t *req, response_t *res);
 
-const char *param_find(request_t *request, uint8_t offset, uint8_t *length);
-const char *header_find(request_t *request, const char *key);
+const char *param_find(request_t *request, uint8_t *length);
+const char *header_find(request_t *request, const char *key, uint16_t *value_len);
+int search_find(request_t *request, const char *key, const char **value, size_t *value_len, size_t value_len_max);
 const char *body_read(request_t *request, uint32_t length);
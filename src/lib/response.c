@@ -27,9 +27,14 @@ void response_init(response_t *response, char *buffer) {
 	offset += response->body.cap;
 
 	response->stream = false;
+	response->keep_alive = false;
 }
 
 size_t response(request_t *req, response_t *res, char *buffer) {
+	if (res->stream == false) {
+		header_write(res, "content-length:%u\r\n", res->body.len);
+		header_write(res, "connection:%s\r\n", res->keep_alive == true ? "keep-alive" : "close");
+	}
 	res->head.len += (uint8_t)sprintf(res->head.ptr, "HTTP/1.1 %hu %s\r\n", res->status, status_text(res->status));
 	if (res->header.len > 0) {
 		memmove(&buffer[res->head.len], res->header.ptr, res->header.len);
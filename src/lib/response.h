@@ -13,6 +13,7 @@ typedef struct response_t {
 	strn16_t header;
 	strn32_t body;
 	bool stream;
+	bool keep_alive;
 } response_t;
 
 void response_init(response_t *response, char *buffer);
@@ -0,0 +1,199 @@
+#include "scan.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+uint32_t (*scan_plain)(char *bytes, uint32_t len, char stop, char halt, bool fold) = &scan_plain_scalar;
+size_t (*scan_find)(const char *bytes, size_t len, char lower, char upper) = &scan_find_scalar;
+
+uint32_t scan_plain_scalar(char *bytes, uint32_t len, char stop, char halt, bool fold) {
+	uint32_t index = 0;
+	while (index < len && bytes[index] > '\037' && bytes[index] != stop && bytes[index] != halt) {
+		if (fold == true && bytes[index] >= 'A' && bytes[index] <= 'Z') {
+			bytes[index] += 32;
+		}
+		index++;
+	}
+	return index;
+}
+
+size_t scan_find_scalar(const char *bytes, size_t len, char lower, char upper) {
+	size_t index = 0;
+	while (index < len && bytes[index] != lower && bytes[index] != upper) {
+		index++;
+	}
+	return index;
+}
+
+#if defined(__x86_64__)
+
+uint32_t scan_plain_sse2(char *bytes, uint32_t len, char stop, char halt, bool fold) {
+	const __m128i control = _mm_set1_epi8('\037');
+	const __m128i stops = _mm_set1_epi8(stop);
+	const __m128i halts = _mm_set1_epi8(halt);
+	const __m128i lower = _mm_set1_epi8('A' - 1);
+	const __m128i upper = _mm_set1_epi8('Z' + 1);
+	const __m128i shift = _mm_set1_epi8(32);
+
+	uint32_t index = 0;
+	while (index + 16 <= len) {
+		__m128i chunk = _mm_loadu_si128((const __m128i *)&bytes[index]);
+		__m128i special = _mm_or_si128(_mm_cmpeq_epi8(chunk, stops), _mm_cmpeq_epi8(chunk, halts));
+		special = _mm_or_si128(special, _mm_andnot_si128(_mm_cmpgt_epi8(chunk, control), _mm_set1_epi8(-1)));
+
+		uint32_t mask = (uint32_t)_mm_movemask_epi8(special);
+		if (mask != 0) {
+			return index + scan_plain_scalar(&bytes[index], (uint32_t)__builtin_ctz(mask), stop, halt, fold);
+		}
+
+		if (fold == true) {
+			__m128i caps = _mm_and_si128(_mm_cmpgt_epi8(chunk, lower), _mm_cmpgt_epi8(upper, chunk));
+			_mm_storeu_si128((__m128i *)&bytes[index], _mm_add_epi8(chunk, _mm_and_si128(caps, shift)));
+		}
+		index += 16;
+	}
+
+	return index + scan_plain_scalar(&bytes[index], len - index, stop, halt, fold);
+}
+
+size_t scan_find_sse2(const char *bytes, size_t len, char lower, char upper) {
+	const __m128i lowers = _mm_set1_epi8(lower);
+	const __m128i uppers = _mm_set1_epi8(upper);
+
+	size_t index = 0;
+	while (index + 16 <= len) {
+		__m128i chunk = _mm_loadu_si128((const __m128i *)&bytes[index]);
+		__m128i match = _mm_or_si128(_mm_cmpeq_epi8(chunk, lowers), _mm_cmpeq_epi8(chunk, uppers));
+
+		uint32_t mask = (uint32_t)_mm_movemask_epi8(match);
+		if (mask != 0) {
+			return index + (size_t)__builtin_ctz(mask);
+		}
+		index += 16;
+	}
+
+	return index + scan_find_scalar(&bytes[index], len - index, lower, upper);
+}
+
+__attribute__((target("avx2"))) uint32_t scan_plain_avx2(char *bytes, uint32_t len, char stop, char halt, bool fold) {
+	const __m256i control = _mm256_set1_epi8('\037');
+	const __m256i stops = _mm256_set1_epi8(stop);
+	const __m256i halts = _mm256_set1_epi8(halt);
+	const __m256i lower = _mm256_set1_epi8('A' - 1);
+	const __m256i upper = _mm256_set1_epi8('Z' + 1);
+	const __m256i shift = _mm256_set1_epi8(32);
+
+	uint32_t index = 0;
+	while (index + 32 <= len) {
+		__m256i chunk = _mm256_loadu_si256((const __m256i *)&bytes[index]);
+		__m256i special = _mm256_or_si256(_mm256_cmpeq_epi8(chunk, stops), _mm256_cmpeq_epi8(chunk, halts));
+		special = _mm256_or_si256(special, _mm256_andnot_si256(_mm256_cmpgt_epi8(chunk, control), _mm256_set1_epi8(-1)));
+
+		uint32_t mask = (uint32_t)_mm256_movemask_epi8(special);
+		if (mask != 0) {
+			return index + scan_plain_scalar(&bytes[index], (uint32_t)__builtin_ctz(mask), stop, halt, fold);
+		}
+
+		if (fold == true) {
+			__m256i caps = _mm256_and_si256(_mm256_cmpgt_epi8(chunk, lower), _mm256_cmpgt_epi8(upper, chunk));
+			_mm256_storeu_si256((__m256i *)&bytes[index], _mm256_add_epi8(chunk, _mm256_and_si256(caps, shift)));
+		}
+		index += 32;
+	}
+
+	return index + scan_plain_sse2(&bytes[index], len - index, stop, halt, fold);
+}
+
+__attribute__((target("avx2"))) size_t scan_find_avx2(const char *bytes, size_t len, char lower, char upper) {
+	const __m256i lowers = _mm256_set1_epi8(lower);
+	const __m256i uppers = _mm256_set1_epi8(upper);
+
+	size_t index = 0;
+	while (index + 32 <= len) {
+		__m256i chunk = _mm256_loadu_si256((const __m256i *)&bytes[index]);
+		__m256i match = _mm256_or_si256(_mm256_cmpeq_epi8(chunk, lowers), _mm256_cmpeq_epi8(chunk, uppers));
+
+		uint32_t mask = (uint32_t)_mm256_movemask_epi8(match);
+		if (mask != 0) {
+			return index + (size_t)__builtin_ctz(mask);
+		}
+		index += 32;
+	}
+
+	return index + scan_find_sse2(&bytes[index], len - index, lower, upper);
+}
+
+#elif defined(__aarch64__)
+
+uint64_t scan_mask_neon(uint8x16_t match) {
+	uint8x8_t narrowed = vshrn_n_u16(vreinterpretq_u16_u8(match), 4);
+	return vget_lane_u64(vreinterpret_u64_u8(narrowed), 0);
+}
+
+uint32_t scan_plain_neon(char *bytes, uint32_t len, char stop, char halt, bool fold) {
+	const uint8x16_t control = vdupq_n_u8('\037');
+	const uint8x16_t stops = vdupq_n_u8((uint8_t)stop);
+	const uint8x16_t halts = vdupq_n_u8((uint8_t)halt);
+	const uint8x16_t lower = vdupq_n_u8('A');
+	const uint8x16_t upper = vdupq_n_u8('Z');
+	const uint8x16_t shift = vdupq_n_u8(32);
+
+	uint32_t index = 0;
+	while (index + 16 <= len) {
+		uint8x16_t chunk = vld1q_u8((const uint8_t *)&bytes[index]);
+		uint8x16_t special = vorrq_u8(vceqq_u8(chunk, stops), vceqq_u8(chunk, halts));
+		special = vorrq_u8(special, vcleq_u8(chunk, control));
+
+		uint64_t mask = scan_mask_neon(special);
+		if (mask != 0) {
+			return index + scan_plain_scalar(&bytes[index], (uint32_t)(__builtin_ctzll(mask) >> 2), stop, halt, fold);
+		}
+
+		if (fold == true) {
+			uint8x16_t caps = vandq_u8(vcgeq_u8(chunk, lower), vcleq_u8(chunk, upper));
+			vst1q_u8((uint8_t *)&bytes[index], vaddq_u8(chunk, vandq_u8(caps, shift)));
+		}
+		index += 16;
+	}
+
+	return index + scan_plain_scalar(&bytes[index], len - index, stop, halt, fold);
+}
+
+size_t scan_find_neon(const char *bytes, size_t len, char lower, char upper) {
+	const uint8x16_t lowers = vdupq_n_u8((uint8_t)lower);
+	const uint8x16_t uppers = vdupq_n_u8((uint8_t)upper);
+
+	size_t index = 0;
+	while (index + 16 <= len) {
+		uint8x16_t chunk = vld1q_u8((const uint8_t *)&bytes[index]);
+		uint64_t mask = scan_mask_neon(vorrq_u8(vceqq_u8(chunk, lowers), vceqq_u8(chunk, uppers)));
+		if (mask != 0) {
+			return index + (size_t)(__builtin_ctzll(mask) >> 2);
+		}
+		index += 16;
+	}
+
+	return index + scan_find_scalar(&bytes[index], len - index, lower, upper);
+}
+
+#endif
+
+const char *scan_init(void) {
+#if defined(__x86_64__)
+	scan_plain = &scan_plain_sse2;
+	scan_find = &scan_find_sse2;
+	return "sse2";
+#elif defined(__aarch64__)
+	scan_plain = &scan_plain_neon;
+	scan_find = &scan_find_neon;
+	return "neon";
+#else
+	return "scalar";
+#endif
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+extern uint32_t (*scan_plain)(char *bytes, uint32_t len, char stop, char halt, bool fold);
+extern size_t (*scan_find)(const char *bytes, size_t len, char lower, char upper);
+
+uint32_t scan_plain_scalar(char *bytes, uint32_t len, char stop, char halt, bool fold);
+size_t scan_find_scalar(const char *bytes, size_t len, char lower, char upper);
+
+#if defined(__x86_64__)
+uint32_t scan_plain_sse2(char *bytes, uint32_t len, char stop, char halt, bool fold);
+size_t scan_find_sse2(const char *bytes, size_t len, char lower, char upper);
+uint32_t scan_plain_avx2(char *bytes, uint32_t len, char stop, char halt, bool fold);
+size_t scan_find_avx2(const char *bytes, size_t len, char lower, char upper);
+#elif defined(__aarch64__)
+uint32_t scan_plain_neon(char *bytes, uint32_t len, char stop, char halt, bool fold);
+size_t scan_find_neon(const char *bytes, size_t len, char lower, char upper);
+#endif
+
+const char *scan_init(void);
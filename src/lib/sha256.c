@@ -1,13 +1,15 @@
+#include "sha256.h"
 #include <memory.h>
+#include <stdbool.h>
 #include <stdint.h>
 #include <stdlib.h>
 
-typedef struct sha256_ctx {
-	uint32_t state[8];
-	uint8_t data[64];
-	size_t data_len;
-	uint64_t bit_len;
-} sha256_ctx;
+#if defined(__x86_64__)
+#include <immintrin.h>
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#include <sys/auxv.h>
+#endif
 
 const uint32_t constants[64] = {0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
 																0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
@@ -18,6 +20,8 @@ const uint32_t constants[64] = {0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5,
 																0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
 																0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
 
+void (*sha256_blocks)(uint32_t (*state)[8], const uint8_t *data, size_t blocks) = &sha256_blocks_scalar;
+
 uint32_t rotate(uint32_t value, uint32_t bits) { return (((value) >> (bits)) | ((value) << (32 - (bits)))); }
 uint32_t choose(uint32_t condition, uint32_t selector, uint32_t mask) {
 	return (((condition) & (selector)) ^ (~(condition) & (mask)));
@@ -43,65 +47,160 @@ void sha256_init(sha256_ctx *ctx) {
 	ctx->state[7] = 0x5be0cd19;
 }
 
-void sha256_transform(sha256_ctx *ctx, const uint8_t *data) {
+void sha256_blocks_scalar(uint32_t (*state)[8], const uint8_t *data, size_t blocks) {
 	uint32_t alpha, bravo, charlie, delta, echo, foxtrot, golf, hotel;
 	uint32_t india, juliet;
 	uint32_t store1, store2;
 	uint32_t message[64];
 
-	india = 0;
-	juliet = 0;
-	for (; india < 16; india++, juliet += 4)
-		message[india] = ((uint32_t)(data[juliet] << 24)) | ((uint32_t)(data[juliet + 1]) << 16) |
-										 ((uint32_t)(data[juliet + 2]) << 8) | ((uint32_t)(data[juliet + 3]));
-	for (; india < 64; india++)
-		message[india] = sigma1(message[india - 2]) + message[india - 7] + sigma0(message[india - 15]) + message[india - 16];
-
-	alpha = ctx->state[0];
-	bravo = ctx->state[1];
-	charlie = ctx->state[2];
-	delta = ctx->state[3];
-	echo = ctx->state[4];
-	foxtrot = ctx->state[5];
-	golf = ctx->state[6];
-	hotel = ctx->state[7];
-
-	india = 0;
-	for (; india < 64; india++) {
-		store1 = hotel + epsilon1(echo) + choose(echo, foxtrot, golf) + constants[india] + message[india];
-		store2 = epsilon0(alpha) + majority(alpha, bravo, charlie);
-		hotel = golf;
-		golf = foxtrot;
-		foxtrot = echo;
-		echo = delta + store1;
-		delta = charlie;
-		charlie = bravo;
-		bravo = alpha;
-		alpha = store1 + store2;
+	for (; blocks > 0; blocks--, data += 64) {
+		india = 0;
+		juliet = 0;
+		for (; india < 16; india++, juliet += 4)
+			message[india] = ((uint32_t)(data[juliet] << 24)) | ((uint32_t)(data[juliet + 1]) << 16) |
+											 ((uint32_t)(data[juliet + 2]) << 8) | ((uint32_t)(data[juliet + 3]));
+		for (; india < 64; india++)
+			message[india] = sigma1(message[india - 2]) + message[india - 7] + sigma0(message[india - 15]) + message[india - 16];
+
+		alpha = (*state)[0];
+		bravo = (*state)[1];
+		charlie = (*state)[2];
+		delta = (*state)[3];
+		echo = (*state)[4];
+		foxtrot = (*state)[5];
+		golf = (*state)[6];
+		hotel = (*state)[7];
+
+		india = 0;
+		for (; india < 64; india++) {
+			store1 = hotel + epsilon1(echo) + choose(echo, foxtrot, golf) + constants[india] + message[india];
+			store2 = epsilon0(alpha) + majority(alpha, bravo, charlie);
+			hotel = golf;
+			golf = foxtrot;
+			foxtrot = echo;
+			echo = delta + store1;
+			delta = charlie;
+			charlie = bravo;
+			bravo = alpha;
+			alpha = store1 + store2;
+		}
+
+		(*state)[0] += alpha;
+		(*state)[1] += bravo;
+		(*state)[2] += charlie;
+		(*state)[3] += delta;
+		(*state)[4] += echo;
+		(*state)[5] += foxtrot;
+		(*state)[6] += golf;
+		(*state)[7] += hotel;
+	}
+}
+
+#if defined(__x86_64__)
+
+__attribute__((target("sha,sse4.1"))) void sha256_blocks_shani(uint32_t (*state)[8], const uint8_t *data, size_t blocks) {
+	const __m128i shuffle = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+
+	__m128i swap = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)&(*state)[0]), 0xb1);
+	__m128i state1 = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)&(*state)[4]), 0x1b);
+	__m128i state0 = _mm_alignr_epi8(swap, state1, 8);
+	state1 = _mm_blend_epi16(state1, swap, 0xf0);
+
+	for (; blocks > 0; blocks--, data += 64) {
+		__m128i abef = state0;
+		__m128i cdgh = state1;
+		__m128i message[4];
+
+		for (uint8_t index = 0; index < 4; index++) {
+			message[index] = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)&data[index * 16]), shuffle);
+		}
+
+		for (uint8_t group = 0; group < 16; group++) {
+			if (group >= 4) {
+				__m128i next = _mm_sha256msg1_epu32(message[group & 3], message[(group + 1) & 3]);
+				next = _mm_add_epi32(next, _mm_alignr_epi8(message[(group + 3) & 3], message[(group + 2) & 3], 4));
+				message[group & 3] = _mm_sha256msg2_epu32(next, message[(group + 3) & 3]);
+			}
+
+			__m128i round = _mm_add_epi32(message[group & 3], _mm_loadu_si128((const __m128i *)&constants[group * 4]));
+			state1 = _mm_sha256rnds2_epu32(state1, state0, round);
+			state0 = _mm_sha256rnds2_epu32(state0, state1, _mm_shuffle_epi32(round, 0x0e));
+		}
+
+		state0 = _mm_add_epi32(state0, abef);
+		state1 = _mm_add_epi32(state1, cdgh);
 	}
 
-	ctx->state[0] += alpha;
-	ctx->state[1] += bravo;
-	ctx->state[2] += charlie;
-	ctx->state[3] += delta;
-	ctx->state[4] += echo;
-	ctx->state[5] += foxtrot;
-	ctx->state[6] += golf;
-	ctx->state[7] += hotel;
+	swap = _mm_shuffle_epi32(state0, 0x1b);
+	state1 = _mm_shuffle_epi32(state1, 0xb1);
+	_mm_storeu_si128((__m128i *)&(*state)[0], _mm_blend_epi16(swap, state1, 0xf0));
+	_mm_storeu_si128((__m128i *)&(*state)[4], _mm_alignr_epi8(state1, swap, 8));
 }
 
+#elif defined(__aarch64__)
+
+__attribute__((target("+crypto"))) void sha256_blocks_armv8(uint32_t (*state)[8], const uint8_t *data, size_t blocks) {
+	uint32x4_t state0 = vld1q_u32(&(*state)[0]);
+	uint32x4_t state1 = vld1q_u32(&(*state)[4]);
+
+	for (; blocks > 0; blocks--, data += 64) {
+		uint32x4_t abcd = state0;
+		uint32x4_t efgh = state1;
+		uint32x4_t message[4];
+
+		for (uint8_t index = 0; index < 4; index++) {
+			message[index] = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(&data[index * 16])));
+		}
+
+		for (uint8_t group = 0; group < 16; group++) {
+			if (group >= 4) {
+				message[group & 3] = vsha256su1q_u32(vsha256su0q_u32(message[group & 3], message[(group + 1) & 3]),
+																						 message[(group + 2) & 3], message[(group + 3) & 3]);
+			}
+
+			uint32x4_t round = vaddq_u32(message[group & 3], vld1q_u32(&constants[group * 4]));
+			uint32x4_t previous = state0;
+			state0 = vsha256hq_u32(state0, state1, round);
+			state1 = vsha256h2q_u32(state1, previous, round);
+		}
+
+		state0 = vaddq_u32(state0, abcd);
+		state1 = vaddq_u32(state1, efgh);
+	}
+
+	vst1q_u32(&(*state)[0], state0);
+	vst1q_u32(&(*state)[4], state1);
+}
+
+#endif
+
 void sha256_update(sha256_ctx *ctx, const uint8_t *data, size_t data_len) {
-	size_t index = 0;
-
-	for (; index < data_len; index++) {
-		ctx->data[ctx->data_len] = data[index];
-		ctx->data_len++;
-		if (ctx->data_len == 64) {
-			sha256_transform(ctx, ctx->data);
-			ctx->bit_len += 512;
-			ctx->data_len = 0;
+	if (ctx->data_len > 0) {
+		size_t fill = 64 - ctx->data_len < data_len ? 64 - ctx->data_len : data_len;
+		memcpy(&ctx->data[ctx->data_len], data, fill);
+		ctx->data_len += fill;
+		data += fill;
+		data_len -= fill;
+
+		if (ctx->data_len < 64) {
+			return;
 		}
+
+		sha256_blocks(&ctx->state, ctx->data, 1);
+		ctx->bit_len += 512;
+		ctx->data_len = 0;
+	}
+
+	size_t blocks = data_len / 64;
+	if (blocks > 0) {
+		sha256_blocks(&ctx->state, data, blocks);
+		ctx->bit_len += blocks * 512;
+		data += blocks * 64;
+		data_len -= blocks * 64;
 	}
+
+	memcpy(ctx->data, data, data_len);
+	ctx->data_len = data_len;
 }
 
 void sha256_final(sha256_ctx *ctx, uint8_t (*hash)[32]) {
@@ -115,7 +214,7 @@ void sha256_final(sha256_ctx *ctx, uint8_t (*hash)[32]) {
 		ctx->data[index++] = 0x80;
 		while (index < 64)
 			ctx->data[index++] = 0x00;
-		sha256_transform(ctx, ctx->data);
+		sha256_blocks(&ctx->state, ctx->data, 1);
 		memset(ctx->data, 0, 56);
 	}
 
@@ -128,7 +227,7 @@ void sha256_final(sha256_ctx *ctx, uint8_t (*hash)[32]) {
 	ctx->data[58] = (uint8_t)(ctx->bit_len >> 40);
 	ctx->data[57] = (uint8_t)(ctx->bit_len >> 48);
 	ctx->data[56] = (uint8_t)(ctx->bit_len >> 56);
-	sha256_transform(ctx, ctx->data);
+	sha256_blocks(&ctx->state, ctx->data, 1);
 
 	for (index = 0; index < 4; index++) {
 		(*hash)[index] = (ctx->state[0] >> (24 - index * 8)) & 0x000000ff;
@@ -150,11 +249,10 @@ void sha256(const void *data, const size_t data_len, uint8_t (*hash)[32]) {
 	sha256_final(&ctx, hash);
 }
 
-void sha256_hmac(const uint8_t *key, const size_t key_len, const void *data, const size_t data_len, uint8_t (*hmac)[32]) {
+void sha256_hmac_key(const uint8_t *key, const size_t key_len, sha256_key_t *keyed) {
 	uint8_t key_block[64] = {0};
 	uint8_t outer_padding[64];
 	uint8_t inner_padding[64];
-	uint8_t hash[32];
 
 	if (key_len > sizeof(key_block)) {
 		sha256(key, key_len, (uint8_t (*)[32])key_block);
@@ -168,15 +266,90 @@ void sha256_hmac(const uint8_t *key, const size_t key_len, const void *data, con
 		inner_padding[index] = key_block[index] ^ 0x36;
 	}
 
+	sha256_init(&keyed->inner);
+	sha256_update(&keyed->inner, inner_padding, sizeof(inner_padding));
+
+	sha256_init(&keyed->outer);
+	sha256_update(&keyed->outer, outer_padding, sizeof(outer_padding));
+}
+
+void sha256_hmac_keyed(const sha256_key_t *keyed, const void *data, const size_t data_len, uint8_t (*hmac)[32]) {
+	uint8_t hash[32];
 	sha256_ctx ctx;
 
-	sha256_init(&ctx);
-	sha256_update(&ctx, inner_padding, sizeof(inner_padding));
+	memcpy(&ctx, &keyed->inner, sizeof(ctx));
 	sha256_update(&ctx, data, data_len);
 	sha256_final(&ctx, &hash);
 
-	sha256_init(&ctx);
-	sha256_update(&ctx, outer_padding, sizeof(outer_padding));
+	memcpy(&ctx, &keyed->outer, sizeof(ctx));
 	sha256_update(&ctx, hash, sizeof(hash));
 	sha256_final(&ctx, hmac);
 }
+
+void sha256_hmac(const uint8_t *key, const size_t key_len, const void *data, const size_t data_len, uint8_t (*hmac)[32]) {
+	sha256_key_t keyed;
+	sha256_hmac_key(key, key_len, &keyed);
+	sha256_hmac_keyed(&keyed, data, data_len, hmac);
+}
+
+bool sha256_check(void) {
+	const char *messages[3] = {"", "abc", "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq"};
+	const uint8_t digests[3][32] = {
+			{0xe3, 0xb0, 0xc4, 0x42, 0x98, 0xfc, 0x1c, 0x14, 0x9a, 0xfb, 0xf4, 0xc8, 0x99, 0x6f, 0xb9, 0x24,
+			 0x27, 0xae, 0x41, 0xe4, 0x64, 0x9b, 0x93, 0x4c, 0xa4, 0x95, 0x99, 0x1b, 0x78, 0x52, 0xb8, 0x55},
+			{0xba, 0x78, 0x16, 0xbf, 0x8f, 0x01, 0xcf, 0xea, 0x41, 0x41, 0x40, 0xde, 0x5d, 0xae, 0x22, 0x23,
+			 0xb0, 0x03, 0x61, 0xa3, 0x96, 0x17, 0x7a, 0x9c, 0xb4, 0x10, 0xff, 0x61, 0xf2, 0x00, 0x15, 0xad},
+			{0x24, 0x8d, 0x6a, 0x61, 0xd2, 0x06, 0x38, 0xb8, 0xe5, 0xc0, 0x26, 0x93, 0x0c, 0x3e, 0x60, 0x39,
+			 0xa3, 0x3c, 0xe4, 0x59, 0x64, 0xff, 0x21, 0x67, 0xf6, 0xec, 0xed, 0xd4, 0x19, 0xdb, 0x06, 0xc1},
+	};
+
+	uint8_t hash[32];
+	for (uint8_t index = 0; index < 3; index++) {
+		sha256(messages[index], strlen(messages[index]), &hash);
+		if (memcmp(hash, digests[index], sizeof(hash)) != 0) {
+			return false;
+		}
+	}
+
+	uint8_t block[200];
+	memset(block, 'a', sizeof(block));
+	sha256(block, sizeof(block), &hash);
+
+	uint8_t expected[32];
+	sha256_ctx ctx;
+	sha256_init(&ctx);
+	for (uint8_t index = 0; index < sizeof(block); index++) {
+		sha256_update(&ctx, &block[index], 1);
+	}
+	sha256_final(&ctx, &expected);
+
+	return memcmp(hash, expected, sizeof(hash)) == 0;
+}
+
+const char *sha256_select(void) {
+	const char *backend = "scalar";
+
+#if defined(__x86_64__)
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("sha") && __builtin_cpu_supports("sse4.1")) {
+		sha256_blocks = &sha256_blocks_shani;
+		backend = "sha-ni";
+	}
+#elif defined(__aarch64__)
+	if (getauxval(AT_HWCAP) & HWCAP_SHA2) {
+		sha256_blocks = &sha256_blocks_armv8;
+		backend = "armv8";
+	}
+#endif
+
+	if (sha256_check() == true) {
+		return backend;
+	}
+
+	sha256_blocks = &sha256_blocks_scalar;
+	if (sha256_check() == true) {
+		return "scalar";
+	}
+
+	return NULL;
+}
@@ -1,7 +1,29 @@
 #pragma once
 
+#include <stdbool.h>
 #include <stdint.h>
 #include <stdlib.h>
 
+typedef struct sha256_ctx {
+	uint32_t state[8];
+	uint8_t data[64];
+	size_t data_len;
+	uint64_t bit_len;
+} sha256_ctx;
+
+typedef struct sha256_key_t {
+	sha256_ctx inner;
+	sha256_ctx outer;
+} sha256_key_t;
+
 void sha256(const void *data, size_t data_len, uint8_t (*hash)[32]);
 void sha256_hmac(const uint8_t *key, const size_t key_len, const void *data, const size_t data_len, uint8_t (*hmac)[32]);
+void sha256_hmac_key(const uint8_t *key, const size_t key_len, sha256_key_t *keyed);
+void sha256_hmac_keyed(const sha256_key_t *keyed, const void *data, const size_t data_len, uint8_t (*hmac)[32]);
+
+extern void (*sha256_blocks)(uint32_t (*state)[8], const uint8_t *data, size_t blocks);
+
+void sha256_blocks_scalar(uint32_t (*state)[8], const uint8_t *data, size_t blocks);
+
+bool sha256_check(void);
+const char *sha256_select(void);
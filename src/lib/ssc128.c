@@ -1,75 +1,172 @@
+#include "ssc128.h"
 #include <memory.h>
 #include <stdint.h>
 #include <stdlib.h>
 
-void diffuse(uint32_t value[2], const uint32_t key[4]) {
+#if defined(__x86_64__)
+#include <immintrin.h>
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+void (*ssc128_lanes)(const ssc128_key_t *key, uint32_t *alpha, uint32_t *bravo, uint8_t count) = &ssc128_lanes_scalar;
+
+void diffuse(const ssc128_key_t *key, uint32_t *alpha, uint32_t *bravo) {
+	for (uint8_t index = 0; index < 32; index++) {
+		*alpha += (((*bravo << 4) ^ (*bravo >> 5)) + *bravo) ^ key->rounds[index * 2];
+		*bravo += (((*alpha << 4) ^ (*alpha >> 5)) + *alpha) ^ key->rounds[index * 2 + 1];
+	}
+}
+
+void ssc128_expand(const uint8_t (*key)[16], ssc128_key_t *expanded) {
 	const uint32_t delta = 0x9e3779b9;
 
-	uint32_t alpha = value[0];
-	uint32_t bravo = value[1];
-	uint32_t sum = 0;
+	uint32_t words[4];
+	for (uint8_t index = 0; index < sizeof(words) / sizeof(*words); index++) {
+		words[index] = ((uint32_t)(*key)[index * sizeof(*words)] << 24) | ((uint32_t)(*key)[index * sizeof(*words) + 1] << 16) |
+									 ((uint32_t)(*key)[index * sizeof(*words) + 2] << 8) | ((uint32_t)(*key)[index * sizeof(*words) + 3]);
+	}
 
+	uint32_t sum = 0;
 	for (uint8_t index = 0; index < 32; index++) {
-		alpha += (((bravo << 4) ^ (bravo >> 5)) + bravo) ^ (sum + key[sum & 3]);
+		expanded->rounds[index * 2] = sum + words[sum & 3];
 		sum += delta;
-		bravo += (((alpha << 4) ^ (alpha >> 5)) + alpha) ^ (sum + key[(sum >> 11) & 3]);
+		expanded->rounds[index * 2 + 1] = sum + words[(sum >> 11) & 3];
 	}
 
-	value[0] = alpha;
-	value[1] = bravo;
+	expanded->tail[0] = 0;
+	expanded->tail[1] = 0;
+	diffuse(expanded, &expanded->tail[0], &expanded->tail[1]);
 }
 
-void ssc128_block(const uint8_t (*key)[16], uint8_t (*input)[16], uint8_t (*output)[16]) {
-	uint32_t alpha[4];
-	uint32_t bravo[4];
+void ssc128_lanes_scalar(const ssc128_key_t *key, uint32_t *alpha, uint32_t *bravo, uint8_t count) {
+	for (uint8_t lane = 0; lane < count; lane++) {
+		diffuse(key, &alpha[lane], &bravo[lane]);
+	}
+}
+
+#if defined(__x86_64__)
+
+void ssc128_lanes_sse2(const ssc128_key_t *key, uint32_t *alpha, uint32_t *bravo, uint8_t count) {
+	uint8_t lane = 0;
+	for (; lane + 4 <= count; lane += 4) {
+		__m128i left = _mm_loadu_si128((const __m128i *)&alpha[lane]);
+		__m128i right = _mm_loadu_si128((const __m128i *)&bravo[lane]);
 
-	for (uint8_t index = 0; index < sizeof(alpha) / sizeof(*alpha); index++) {
-		alpha[index] = ((uint32_t)(*key)[index * sizeof(*alpha)] << 24) | ((uint32_t)(*key)[index * sizeof(*alpha) + 1] << 16) |
-									 ((uint32_t)(*key)[index * sizeof(*alpha) + 2] << 8) | ((uint32_t)(*key)[index * sizeof(*alpha) + 3]);
+		for (uint8_t index = 0; index < 32; index++) {
+			__m128i mix = _mm_add_epi32(_mm_xor_si128(_mm_slli_epi32(right, 4), _mm_srli_epi32(right, 5)), right);
+			left = _mm_add_epi32(left, _mm_xor_si128(mix, _mm_set1_epi32((int)key->rounds[index * 2])));
+			mix = _mm_add_epi32(_mm_xor_si128(_mm_slli_epi32(left, 4), _mm_srli_epi32(left, 5)), left);
+			right = _mm_add_epi32(right, _mm_xor_si128(mix, _mm_set1_epi32((int)key->rounds[index * 2 + 1])));
+		}
+
+		_mm_storeu_si128((__m128i *)&alpha[lane], left);
+		_mm_storeu_si128((__m128i *)&bravo[lane], right);
 	}
-	for (uint8_t index = 0; index < sizeof(bravo) / sizeof(*bravo); index++) {
-		bravo[index] = ((uint32_t)(*input)[index * sizeof(*bravo)] << 24) | ((uint32_t)(*input)[index * sizeof(*bravo) + 1] << 16) |
-									 ((uint32_t)(*input)[index * sizeof(*bravo) + 2] << 8) | ((uint32_t)(*input)[index * sizeof(*bravo) + 3]);
+
+	ssc128_lanes_scalar(key, &alpha[lane], &bravo[lane], (uint8_t)(count - lane));
+}
+
+__attribute__((target("avx2"))) void ssc128_lanes_avx2(const ssc128_key_t *key, uint32_t *alpha, uint32_t *bravo, uint8_t count) {
+	uint8_t lane = 0;
+	for (; lane + 8 <= count; lane += 8) {
+		__m256i left = _mm256_loadu_si256((const __m256i *)&alpha[lane]);
+		__m256i right = _mm256_loadu_si256((const __m256i *)&bravo[lane]);
+
+		for (uint8_t index = 0; index < 32; index++) {
+			__m256i mix = _mm256_add_epi32(_mm256_xor_si256(_mm256_slli_epi32(right, 4), _mm256_srli_epi32(right, 5)), right);
+			left = _mm256_add_epi32(left, _mm256_xor_si256(mix, _mm256_set1_epi32((int)key->rounds[index * 2])));
+			mix = _mm256_add_epi32(_mm256_xor_si256(_mm256_slli_epi32(left, 4), _mm256_srli_epi32(left, 5)), left);
+			right = _mm256_add_epi32(right, _mm256_xor_si256(mix, _mm256_set1_epi32((int)key->rounds[index * 2 + 1])));
+		}
+
+		_mm256_storeu_si256((__m256i *)&alpha[lane], left);
+		_mm256_storeu_si256((__m256i *)&bravo[lane], right);
+	}
+
+	ssc128_lanes_sse2(key, &alpha[lane], &bravo[lane], (uint8_t)(count - lane));
+}
+
+#elif defined(__aarch64__)
+
+void ssc128_lanes_neon(const ssc128_key_t *key, uint32_t *alpha, uint32_t *bravo, uint8_t count) {
+	uint8_t lane = 0;
+	for (; lane + 4 <= count; lane += 4) {
+		uint32x4_t left = vld1q_u32(&alpha[lane]);
+		uint32x4_t right = vld1q_u32(&bravo[lane]);
+
+		for (uint8_t index = 0; index < 32; index++) {
+			uint32x4_t mix = vaddq_u32(veorq_u32(vshlq_n_u32(right, 4), vshrq_n_u32(right, 5)), right);
+			left = vaddq_u32(left, veorq_u32(mix, vdupq_n_u32(key->rounds[index * 2])));
+			mix = vaddq_u32(veorq_u32(vshlq_n_u32(left, 4), vshrq_n_u32(left, 5)), left);
+			right = vaddq_u32(right, veorq_u32(mix, vdupq_n_u32(key->rounds[index * 2 + 1])));
+		}
+
+		vst1q_u32(&alpha[lane], left);
+		vst1q_u32(&bravo[lane], right);
 	}
 
-	diffuse(&bravo[0], alpha);
-	diffuse(&bravo[2], alpha);
+	ssc128_lanes_scalar(key, &alpha[lane], &bravo[lane], (uint8_t)(count - lane));
+}
+
+#endif
 
-	memcpy(output, bravo, sizeof(*output));
+const char *ssc128_init(void) {
+#if defined(__x86_64__)
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2")) {
+		ssc128_lanes = &ssc128_lanes_avx2;
+		return "avx2";
+	}
+	ssc128_lanes = &ssc128_lanes_sse2;
+	return "sse2";
+#elif defined(__aarch64__)
+	ssc128_lanes = &ssc128_lanes_neon;
+	return "neon";
+#else
+	return "scalar";
+#endif
 }
 
-void ssc128_crypt(uint8_t *data, const size_t data_len, const uint16_t frame, const uint8_t (*key)[16]) {
-	uint8_t data_block[16];
-	uint8_t data_stream[16];
+void ssc128_crypt(uint8_t *data, const size_t data_len, const uint16_t frame, const ssc128_key_t *key) {
+	uint32_t alpha[16];
+	uint32_t bravo[16];
+	uint32_t data_stream[64];
 
 	size_t data_ind = 0;
 	uint32_t block_ind = 0;
 
 	while (data_ind < data_len) {
-		memset(data_block, 0, sizeof(data_block));
+		size_t remaining = (data_len - data_ind + 15) / 16;
+		uint8_t count = remaining < sizeof(alpha) / sizeof(*alpha) ? (uint8_t)remaining : sizeof(alpha) / sizeof(*alpha);
 
-		data_block[0] = (uint8_t)(frame >> 8);
-		data_block[1] = (uint8_t)(frame & 0xff);
+		for (uint8_t lane = 0; lane < count; lane++) {
+			alpha[lane] = ((uint32_t)frame << 16) | ((block_ind + lane) >> 16);
+			bravo[lane] = (block_ind + lane) << 16;
+		}
 
-		data_block[2] = (uint8_t)(block_ind >> 24);
-		data_block[3] = (uint8_t)(block_ind >> 16);
-		data_block[4] = (uint8_t)(block_ind >> 8);
-		data_block[5] = (uint8_t)(block_ind & 0xff);
+		ssc128_lanes(key, alpha, bravo, count);
 
-		ssc128_block(key, &data_block, &data_stream);
+		for (uint8_t lane = 0; lane < count; lane++) {
+			data_stream[lane * 4] = alpha[lane];
+			data_stream[lane * 4 + 1] = bravo[lane];
+			data_stream[lane * 4 + 2] = key->tail[0];
+			data_stream[lane * 4 + 3] = key->tail[1];
+		}
 
-		for (uint8_t ind = 0; ind < sizeof(data_block) && data_ind < data_len; ind++) {
-			data[data_ind++] ^= data_stream[ind];
+		const uint8_t *stream = (const uint8_t *)data_stream;
+		for (size_t ind = 0; ind < (size_t)count * 16 && data_ind < data_len; ind++) {
+			data[data_ind++] ^= stream[ind];
 		}
 
-		block_ind++;
+		block_ind += count;
 	}
 }
 
-void ssc128_encrypt(void *data, const size_t data_len, const uint16_t frame, const uint8_t (*key)[16]) {
+void ssc128_encrypt(void *data, const size_t data_len, const uint16_t frame, const ssc128_key_t *key) {
 	ssc128_crypt(data, data_len, frame, key);
 }
 
-void ssc128_decrypt(void *data, const size_t data_len, const uint16_t frame, const uint8_t (*key)[16]) {
+void ssc128_decrypt(void *data, const size_t data_len, const uint16_t frame, const ssc128_key_t *key) {
 	ssc128_crypt(data, data_len, frame, key);
 }
@@ -3,5 +3,16 @@
 #include <stdint.h>
 #include <stdlib.h>
 
-void ssc128_encrypt(void *data, const size_t data_len, const uint16_t frame, const uint8_t (*key)[16]);
-void ssc128_decrypt(void *data, const size_t data_len, const uint16_t frame, const uint8_t (*key)[16]);
+typedef struct ssc128_key_t {
+	uint32_t rounds[64];
+	uint32_t tail[2];
+} ssc128_key_t;
+
+extern void (*ssc128_lanes)(const ssc128_key_t *key, uint32_t *alpha, uint32_t *bravo, uint8_t count);
+
+void ssc128_lanes_scalar(const ssc128_key_t *key, uint32_t *alpha, uint32_t *bravo, uint8_t count);
+
+const char *ssc128_init(void);
+void ssc128_expand(const uint8_t (*key)[16], ssc128_key_t *expanded);
+void ssc128_encrypt(void *data, const size_t data_len, const uint16_t frame, const ssc128_key_t *key);
+void ssc128_decrypt(void *data, const size_t data_len, const uint16_t frame, const ssc128_key_t *key);
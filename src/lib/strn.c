@@ -1,3 +1,4 @@
+#include "scan.h"
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -47,17 +48,28 @@ int strnfind(const char *buffer, const size_t buffer_len, const char *prefix, co
 }
 
 const char *strncasestrn(const char *buffer, size_t buffer_len, const char *buf, size_t buf_len) {
+	if (buf_len == 0 || buf_len > buffer_len) {
+		return NULL;
+	}
+
+	const char lower = buf[0];
+	const char upper = lower >= 'a' && lower <= 'z' ? (char)(lower - 32) : lower;
+	const size_t last = buffer_len - buf_len;
+
 	size_t index = 0;
-	size_t ind = 0;
+	while (index <= last) {
+		index += scan_find(&buffer[index], last + 1 - index, lower, upper);
+		if (index > last) {
+			return NULL;
+		}
 
-	while (index < buffer_len) {
-		if (buffer[index] == buf[ind] || (buffer[index] >= 'A' && buffer[index] <= 'Z' && buffer[index] + 32 == buf[ind])) {
+		size_t ind = 1;
+		while (ind < buf_len && (buffer[index + ind] == buf[ind] ||
+														 (buffer[index + ind] >= 'A' && buffer[index + ind] <= 'Z' && buffer[index + ind] + 32 == buf[ind]))) {
 			ind++;
-			if (ind == buf_len) {
-				return (char *)&buffer[index + 1 - buf_len];
-			}
-		} else {
-			ind = 0;
+		}
+		if (ind == buf_len) {
+			return &buffer[index];
 		}
 		index++;
 	}
@@ -3,63 +3,273 @@
 #include "config.h"
 #include "error.h"
 #include "logger.h"
+#include "loop.h"
+#include "metrics.h"
 #include <errno.h>
+#include <limits.h>
+#include <linux/futex.h>
 #include <sqlite3.h>
 #include <stdbool.h>
 #include <stdlib.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
 
 queue_t queue = {
+		.slots = NULL,
+		.cap = 0,
 		.head = 0,
 		.tail = 0,
-		.size = 0,
+		.filled = 0,
+		.sleepers = 0,
+};
+
+contexts_t contexts = {
+		.ptr = NULL,
+		.len = 0,
+		.idle = NULL,
+		.idle_len = 0,
 		.lock = PTHREAD_MUTEX_INITIALIZER,
-		.filled = PTHREAD_COND_INITIALIZER,
-		.available = PTHREAD_COND_INITIALIZER,
 };
 
 thread_pool_t thread_pool = {
 		.size = 0,
 		.load = 0,
+		.scale = 0,
+		.scaling = false,
 		.lock = PTHREAD_MUTEX_INITIALIZER,
-		.scale = PTHREAD_COND_INITIALIZER,
 		.available = PTHREAD_COND_INITIALIZER,
 };
 
-void cancel(void *lock) { pthread_mutex_unlock((pthread_mutex_t *)lock); }
+long futex_wait(atomic_uint *word, unsigned int value, struct timespec *timeout) {
+	return syscall(SYS_futex, word, FUTEX_WAIT_PRIVATE, value, timeout, NULL, 0);
+}
 
-int spawn(worker_t *worker, uint8_t id, void *(*function)(void *),
-					void (*logger)(const char *message, ...) __attribute__((format(printf, 1, 2)))) {
-	worker->arg.id = id;
-	trace("spawning worker thread %hhu\n", id);
+void futex_wake(atomic_uint *word, int count) { syscall(SYS_futex, word, FUTEX_WAKE_PRIVATE, count, NULL, NULL, 0); }
 
-	int db_error = sqlite3_open_v2(database_file, &worker->arg.database, SQLITE_OPEN_READWRITE, NULL);
-	if (db_error != SQLITE_OK) {
-		logger("failed to open %s because %s\n", database_file, sqlite3_errmsg(worker->arg.database));
+int queue_init(void) {
+	queue.slots = malloc(queue_size * sizeof(*queue.slots));
+	if (queue.slots == NULL) {
+		error("failed to allocate %zu bytes for slots because %s\n", queue_size * sizeof(*queue.slots), errno_str());
 		return -1;
 	}
 
-	int exec_error = sqlite3_exec(worker->arg.database, "pragma foreign_keys = on", NULL, NULL, NULL);
+	queue.cap = queue_size;
+	for (uint16_t index = 0; index < queue.cap; index++) {
+		atomic_init(&queue.slots[index].sequence, index);
+	}
+
+	return 0;
+}
+
+bool queue_try_push(task_t *task) {
+	uint_fast64_t tail = atomic_load_explicit(&queue.tail, memory_order_relaxed);
+
+	while (true) {
+		slot_t *slot = &queue.slots[tail % queue.cap];
+		uint_fast64_t sequence = atomic_load_explicit(&slot->sequence, memory_order_acquire);
+
+		if (sequence == tail) {
+			if (atomic_compare_exchange_weak_explicit(&queue.tail, &tail, tail + 1, memory_order_relaxed, memory_order_relaxed)) {
+				slot->task = *task;
+				atomic_store_explicit(&slot->sequence, tail + 1, memory_order_release);
+				return true;
+			}
+		} else if (sequence < tail) {
+			return false;
+		} else {
+			tail = atomic_load_explicit(&queue.tail, memory_order_relaxed);
+		}
+	}
+}
+
+bool queue_try_pop(task_t *task) {
+	uint_fast64_t head = atomic_load_explicit(&queue.head, memory_order_relaxed);
+
+	while (true) {
+		slot_t *slot = &queue.slots[head % queue.cap];
+		uint_fast64_t sequence = atomic_load_explicit(&slot->sequence, memory_order_acquire);
+
+		if (sequence == head + 1) {
+			if (atomic_compare_exchange_weak_explicit(&queue.head, &head, head + 1, memory_order_relaxed, memory_order_relaxed)) {
+				*task = slot->task;
+				atomic_store_explicit(&slot->sequence, head + queue.cap, memory_order_release);
+				return true;
+			}
+		} else if (sequence < head + 1) {
+			return false;
+		} else {
+			head = atomic_load_explicit(&queue.head, memory_order_relaxed);
+		}
+	}
+}
+
+uint16_t queue_len(void) {
+	uint_fast64_t head = atomic_load_explicit(&queue.head, memory_order_relaxed);
+	uint_fast64_t tail = atomic_load_explicit(&queue.tail, memory_order_relaxed);
+	return tail > head ? (uint16_t)(tail - head) : 0;
+}
+
+bool queue_push(task_t *task) {
+	if (queue_try_push(task) == false) {
+		return false;
+	}
+
+	trace("loop thread increased queue size to %hu\n", queue_len());
+
+	atomic_fetch_add(&queue.filled, 1);
+	if (atomic_load(&queue.sleepers) > 0) {
+		futex_wake(&queue.filled, 1);
+	}
+
+	uint8_t load = atomic_load_explicit(&thread_pool.load, memory_order_relaxed);
+	uint8_t size = atomic_load_explicit(&thread_pool.size, memory_order_relaxed);
+
+	if (load >= size && atomic_exchange_explicit(&thread_pool.scaling, true, memory_order_relaxed) == false) {
+		atomic_fetch_add(&thread_pool.scale, 1);
+		futex_wake(&thread_pool.scale, 1);
+	}
+
+	return true;
+}
+
+int queue_pop(task_t *task, atomic_bool *stopping) {
+	while (true) {
+		unsigned int filled = atomic_load(&queue.filled);
+
+		if (atomic_load(stopping) == true) {
+			return -1;
+		}
+
+		if (queue_try_pop(task) == true) {
+			return 0;
+		}
+
+		atomic_fetch_add(&queue.sleepers, 1);
+		futex_wait(&queue.filled, filled, NULL);
+		atomic_fetch_sub(&queue.sleepers, 1);
+	}
+}
+
+int context_open(context_t *context, void (*logger)(const char *message, ...) __attribute__((format(printf, 1, 2)))) {
+	int db_error = sqlite3_open_v2(database_file, &context->database, SQLITE_OPEN_READWRITE, NULL);
+	if (db_error != SQLITE_OK) {
+		logger("failed to open %s because %s\n", database_file, sqlite3_errmsg(context->database));
+		goto cleanup;
+	}
+
+	int exec_error = sqlite3_exec(context->database, "pragma foreign_keys = on", NULL, NULL, NULL);
 	if (exec_error != SQLITE_OK) {
-		logger("failed to enforce foreign key constraints because %s\n", sqlite3_errmsg(worker->arg.database));
+		logger("failed to enforce foreign key constraints because %s\n", sqlite3_errmsg(context->database));
+		goto cleanup;
+	}
+
+	sqlite3_busy_timeout(context->database, database_timeout);
+
+	context->response_buffer = malloc(send_buffer * sizeof(char));
+	if (context->response_buffer == NULL) {
+		logger("failed to allocate %u bytes because %s\n", send_buffer, errno_str());
+		goto cleanup;
+	}
+
+	return 0;
+
+cleanup:
+	sqlite3_close_v2(context->database);
+	context->database = NULL;
+	return -1;
+}
+
+int context_warm(void (*logger)(const char *message, ...) __attribute__((format(printf, 1, 2)))) {
+	context_t *context = &contexts.ptr[contexts.len];
+	if (context_open(context, logger) == -1) {
 		return -1;
 	}
 
-	sqlite3_busy_timeout(worker->arg.database, database_timeout);
+	contexts.len++;
+	contexts.idle[contexts.idle_len] = context;
+	contexts.idle_len++;
+	trace("warmed worker context %hhu\n", contexts.len);
+
+	return 0;
+}
 
-	worker->arg.request_buffer = malloc(receive_buffer * sizeof(char));
-	if (worker->arg.request_buffer == NULL) {
-		logger("failed to allocate %u bytes because %s\n", receive_buffer, errno_str());
+int context_init(void) {
+	contexts.ptr = calloc(most_workers, sizeof(*contexts.ptr));
+	if (contexts.ptr == NULL) {
+		fatal("failed to allocate %zu bytes for contexts because %s\n", most_workers * sizeof(*contexts.ptr), errno_str());
 		return -1;
 	}
 
-	worker->arg.response_buffer = malloc(send_buffer * sizeof(char));
-	if (worker->arg.response_buffer == NULL) {
-		logger("failed to allocate %u bytes because %s\n", send_buffer, errno_str());
+	contexts.idle = malloc(most_workers * sizeof(*contexts.idle));
+	if (contexts.idle == NULL) {
+		fatal("failed to allocate %zu bytes for contexts because %s\n", most_workers * sizeof(*contexts.idle), errno_str());
+		return -1;
+	}
+
+	uint8_t warm = least_workers < most_workers ? least_workers + 1 : most_workers;
+	for (uint8_t index = 0; index < warm; index++) {
+		if (context_warm(&fatal) == -1) {
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+context_t *context_acquire(void (*logger)(const char *message, ...) __attribute__((format(printf, 1, 2)))) {
+	pthread_mutex_lock(&contexts.lock);
+
+	if (contexts.idle_len == 0 && (contexts.len >= most_workers || context_warm(logger) == -1)) {
+		pthread_mutex_unlock(&contexts.lock);
+		return NULL;
+	}
+
+	contexts.idle_len--;
+	context_t *context = contexts.idle[contexts.idle_len];
+
+	pthread_mutex_unlock(&contexts.lock);
+	return context;
+}
+
+void context_release(context_t *context) {
+	pthread_mutex_lock(&contexts.lock);
+	contexts.idle[contexts.idle_len] = context;
+	contexts.idle_len++;
+	pthread_mutex_unlock(&contexts.lock);
+}
+
+void context_free(void) {
+	for (uint8_t index = 0; index < contexts.len; index++) {
+		if (sqlite3_close_v2(contexts.ptr[index].database) != SQLITE_OK) {
+			error("failed to close %s because %s\n", database_file, sqlite3_errmsg(contexts.ptr[index].database));
+		}
+		free(contexts.ptr[index].response_buffer);
+	}
+
+	free(contexts.ptr);
+	free(contexts.idle);
+	contexts.ptr = NULL;
+	contexts.idle = NULL;
+	contexts.len = 0;
+	contexts.idle_len = 0;
+}
+
+int spawn(worker_t *worker, uint8_t id, void *(*function)(void *),
+					void (*logger)(const char *message, ...) __attribute__((format(printf, 1, 2)))) {
+	worker->arg.id = id;
+	atomic_store(&worker->arg.stopping, false);
+	trace("spawning worker thread %hhu\n", id);
+
+	worker->arg.context = context_acquire(logger);
+	if (worker->arg.context == NULL) {
+		logger("failed to acquire context for worker thread %hhu\n", id);
 		return -1;
 	}
 
 	if ((errno = pthread_create(&worker->thread, NULL, function, (void *)&worker->arg)) != 0) {
 		logger("failed to spawn worker thread %hhu because %s\n", worker->arg.id, errno_str());
+		context_release(worker->arg.context);
 		return -1;
 	}
 
@@ -69,23 +279,16 @@ int spawn(worker_t *worker, uint8_t id, void *(*function)(void *),
 int join(worker_t *worker, uint8_t id) {
 	trace("joining worker thread %hhu\n", id);
 
-	if (pthread_cancel(worker->thread) == -1) {
-		error("failed to cancel worker thread %hhu because %s\n", id, errno_str());
-		return -1;
-	};
+	atomic_store(&worker->arg.stopping, true);
+	atomic_fetch_add(&queue.filled, 1);
+	futex_wake(&queue.filled, INT_MAX);
 
-	if (pthread_join(worker->thread, NULL) == -1) {
+	if ((errno = pthread_join(worker->thread, NULL)) != 0) {
 		error("failed to join worker thread %hhu because %s\n", id, errno_str());
 		return -1;
 	}
 
-	if (sqlite3_close_v2(worker->arg.database) != SQLITE_OK) {
-		error("failed to close %s because %s\n", database_file, sqlite3_errmsg(worker->arg.database));
-		return -1;
-	}
-
-	free(worker->arg.request_buffer);
-	free(worker->arg.response_buffer);
+	context_release(worker->arg.context);
 
 	return 0;
 }
@@ -93,68 +296,96 @@ int join(worker_t *worker, uint8_t id) {
 void *thread(void *args) {
 	arg_t *arg = (arg_t *)args;
 
-	while (true) {
-		pthread_mutex_lock(&queue.lock);
-		pthread_cleanup_push(cancel, &queue.lock);
+	task_t task;
+	while (queue_pop(&task, &arg->stopping) == 0) {
+		trace("worker thread %hhu decreased queue size to %hu\n", arg->id, queue_len());
 
-		while (queue.size == 0) {
-			pthread_cond_wait(&queue.filled, &queue.lock);
-		}
-
-		pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, &arg->state);
-		pthread_cleanup_pop(false);
-
-		task_t task = queue.tasks[queue.head];
-		queue.head = (uint8_t)((queue.head + 1) % queue_size);
-		queue.size--;
-		trace("worker thread %hhu decreased queue size to %hhu\n", arg->id, queue.size);
-		pthread_cond_signal(&queue.available);
-		pthread_mutex_unlock(&queue.lock);
-
-		pthread_mutex_lock(&thread_pool.lock);
-		thread_pool.load++;
-		trace("worker thread %hhu increased thread pool load to %hhu\n", arg->id, thread_pool.load);
-		pthread_mutex_unlock(&thread_pool.lock);
+		uint8_t load = atomic_fetch_add(&thread_pool.load, 1) + 1;
+		trace("worker thread %hhu increased thread pool load to %hhu\n", arg->id, load);
 
-		handle(arg->database, arg->request_buffer, arg->response_buffer, &task.client_sock, &task.client_addr);
+		handle(arg->context->database, arg->context->response_buffer, task.conn);
+		loop_return(task.conn);
 
-		pthread_mutex_lock(&thread_pool.lock);
-		thread_pool.load--;
-		trace("worker thread %hhu decreased thread pool load to %hhu\n", arg->id, thread_pool.load);
-		pthread_cond_signal(&thread_pool.available);
-		pthread_mutex_unlock(&thread_pool.lock);
+		load = atomic_fetch_sub(&thread_pool.load, 1) - 1;
+		trace("worker thread %hhu decreased thread pool load to %hhu\n", arg->id, load);
 
-		pthread_setcancelstate(arg->state, NULL);
-		pthread_testcancel();
+		if (load == 0) {
+			pthread_mutex_lock(&thread_pool.lock);
+			pthread_cond_broadcast(&thread_pool.available);
+			pthread_mutex_unlock(&thread_pool.lock);
+		}
 	}
+
+	return NULL;
 }
 
 void *scaler(void *args) {
 	(void)args;
 
-	while (true) {
-		pthread_mutex_lock(&thread_pool.lock);
-		pthread_cond_wait(&thread_pool.scale, &thread_pool.lock);
-		pthread_mutex_unlock(&thread_pool.lock);
+	uint16_t average = 0;
+	uint8_t idle_ticks = 0;
 
-		if (thread_pool.load >= thread_pool.size) {
+	while (atomic_load(&loops.stopping) == false) {
+		struct timespec interval = {.tv_sec = 0, .tv_nsec = 100000000};
+		long waited = futex_wait(&thread_pool.scale, atomic_load(&thread_pool.scale), &interval);
+		bool ticked = waited == -1 && errno == ETIMEDOUT;
+		if (ticked == true) {
+			atomic_store(&thread_pool.scaling, false);
+		}
+
+		uint8_t load = atomic_load(&thread_pool.load);
+		uint8_t size = atomic_load(&thread_pool.size);
+		uint16_t demand = load + queue_len();
+
+		if (ticked == true) {
+			average = (uint16_t)((average * 3 + load * 256) / 4);
+		}
+
+		if (demand >= size && size < most_workers) {
 			debug("all worker threads currently busy\n");
-			uint8_t new_size = thread_pool.size + 1;
-			if (new_size <= most_workers && spawn(&thread_pool.workers[thread_pool.size], thread_pool.size, &thread, &error) == 0) {
-				info("scaled threads from %hhu to %hhu\n", thread_pool.size, new_size);
-				thread_pool.size = new_size;
+			uint8_t target = demand + 1 < most_workers ? (uint8_t)(demand + 1) : most_workers;
+			uint8_t new_size = size;
+			while (new_size < target && spawn(&thread_pool.workers[new_size], new_size, &thread, &error) == 0) {
+				new_size++;
+				atomic_store(&thread_pool.size, new_size);
+			}
+			if (new_size > size) {
+				info("scaled threads from %hhu to %hhu\n", size, new_size);
+				metric_count(&metric_shard()->grown, new_size - size);
+				atomic_store(&thread_pool.scaling, false);
+			}
+
+			pthread_mutex_lock(&contexts.lock);
+			if (contexts.idle_len == 0 && contexts.len < most_workers) {
+				context_warm(&error);
 			}
+			pthread_mutex_unlock(&contexts.lock);
+
+			idle_ticks = 0;
+			continue;
+		}
+
+		if (ticked == false) {
+			continue;
 		}
 
-		if (thread_pool.load <= thread_pool.size / 2 && thread_pool.size > least_workers) {
-			debug("half worker threads currently idle\n");
-			uint8_t new_size = thread_pool.size - 1;
+		if (average * 2 >= size * 256 || size <= least_workers) {
+			idle_ticks = 0;
+			continue;
+		}
+
+		idle_ticks++;
+		if (idle_ticks >= 20) {
+			debug("half worker threads idle on average\n");
+			uint8_t new_size = size - 1;
 			if (join(&thread_pool.workers[new_size], new_size) == 0) {
-				info("scaled threads from %hhu to %hhu\n", thread_pool.size, new_size);
-				thread_pool.size = new_size;
+				info("scaled threads from %hhu to %hhu\n", size, new_size);
+				atomic_store(&thread_pool.size, new_size);
+				metric_count(&metric_shard()->shrunk, 1);
 			}
+			idle_ticks = 0;
 		}
-
-		pthread_mutex_unlock(&thread_pool.lock);
 	}
+
+	return NULL;
 }
@@ -1,33 +1,66 @@
 #pragma once
 
-#include <arpa/inet.h>
+#include "loop.h"
 #include <pthread.h>
 #include <sqlite3.h>
+#include <stdatomic.h>
+#include <stdbool.h>
 #include <stdint.h>
 
 typedef struct task_t {
-	int client_sock;
-	struct sockaddr_in client_addr;
+	conn_t *conn;
 } task_t;
 
+typedef struct slot_t {
+	atomic_uint_fast64_t sequence;
+	task_t task;
+} slot_t;
+
 typedef struct queue_t {
-	task_t *tasks;
-	uint8_t head;
-	uint8_t tail;
-	uint8_t size;
-	pthread_mutex_t lock;
-	pthread_cond_t filled;
-	pthread_cond_t available;
+	slot_t *slots;
+	uint16_t cap;
+	_Alignas(64) atomic_uint_fast64_t head;
+	_Alignas(64) atomic_uint_fast64_t tail;
+	_Alignas(64) atomic_uint filled;
+	atomic_uint sleepers;
 } queue_t;
 
 extern struct queue_t queue;
 
-typedef struct arg_t {
-	uint8_t id;
-	int state;
+long futex_wait(atomic_uint *word, unsigned int value, struct timespec *timeout);
+void futex_wake(atomic_uint *word, int count);
+
+int queue_init(void);
+bool queue_try_push(task_t *task);
+bool queue_try_pop(task_t *task);
+bool queue_push(task_t *task);
+int queue_pop(task_t *task, atomic_bool *stopping);
+uint16_t queue_len(void);
+
+typedef struct context_t {
 	sqlite3 *database;
-	char *request_buffer;
 	char *response_buffer;
+} context_t;
+
+typedef struct contexts_t {
+	context_t *ptr;
+	uint8_t len;
+	context_t **idle;
+	uint8_t idle_len;
+	pthread_mutex_t lock;
+} contexts_t;
+
+extern struct contexts_t contexts;
+
+int context_init(void);
+context_t *context_acquire(void (*logger)(const char *message, ...) __attribute__((format(printf, 1, 2))));
+void context_release(context_t *context);
+void context_free(void);
+
+typedef struct arg_t {
+	uint8_t id;
+	atomic_bool stopping;
+	context_t *context;
 } arg_t;
 
 typedef struct worker_t {
@@ -38,10 +71,11 @@ typedef struct worker_t {
 typedef struct thread_pool_t {
 	pthread_t scaler;
 	worker_t *workers;
-	uint8_t size;
-	uint8_t load;
+	_Atomic uint8_t size;
+	_Atomic uint8_t load;
+	atomic_uint scale;
+	atomic_bool scaling;
 	pthread_mutex_t lock;
-	pthread_cond_t scale;
 	pthread_cond_t available;
 } thread_pool_t;
 
@@ -1,5 +1,6 @@
 #include "api/drop.h"
 #include "api/init.h"
+#include "api/router.h"
 #include "api/seed.h"
 #include "api/transmission.h"
 #include "api/wipe.h"
@@ -8,15 +9,22 @@
 #include "app/radio.h"
 #include "app/schedule.h"
 #include "app/uplink.h"
+#include "lib/bwt.h"
 #include "lib/config.h"
 #include "lib/error.h"
 #include "lib/format.h"
 #include "lib/logger.h"
+#include "lib/loop.h"
+#include "lib/metrics.h"
+#include "lib/scan.h"
+#include "lib/sha256.h"
+#include "lib/ssc128.h"
 #include "lib/thread.h"
 #include <arpa/inet.h>
 #include <errno.h>
 #include <pthread.h>
 #include <signal.h>
+#include <stdatomic.h>
 #include <sqlite3.h>
 #include <stdbool.h>
 #include <stdint.h>
@@ -25,8 +33,6 @@
 #include <string.h>
 #include <unistd.h>
 
-bool stopping = false;
-
 int server_sock;
 struct sockaddr_in server_addr;
 
@@ -34,7 +40,8 @@ void stop(int sig) {
 	signal(sig, SIG_DFL);
 	trace("received signal %d\n", sig);
 
-	stopping = true;
+	atomic_store(&loops.stopping, true);
+	loop_wake();
 
 	if (close(server_sock) == -1) {
 		error("failed to close socket because %s\n", errno_str());
@@ -53,24 +60,33 @@ int main(int argc, char *argv[]) {
 		info("--address           -a   ip address to bind               (%s)\n", address);
 		info("--port              -p   port to listen on                (%hu)\n", port);
 		info("--backlog           -b   backlog allowed on socket        (%hhu)\n", backlog);
-		info("--queue-size        -qs  size of clients in queue         (%hhu)\n", queue_size);
+		info("--queue-size        -qs  size of clients in queue         (%hu)\n", queue_size);
 		info("--least-workers     -lw  least amount of worker threads   (%hhu)\n", least_workers);
 		info("--most-workers      -mw  most amount of worker threads    (%hhu)\n", most_workers);
+		info("--io-threads        -it  amount of event loop threads     (%hhu)\n", io_threads);
+		info("--reuse-port        -ru  listen on a socket per loop      (%s)\n", human_bool(reuse_port));
 		info("--bwt-key           -bk  random bytes for bwt signing     (%s)\n", bwt_key);
 		info("--bwt-ttl           -bt  time to live for bwt expiry      (%u)\n", bwt_ttl);
+		info("--bwt-cache         -bc  verified tokens kept in cache    (%hu)\n", bwt_cache);
 		info("--database-file     -df  path to sqlite database file     (%s)\n", database_file);
 		info("--database-timeout  -dt  milliseconds to wait for lock    (%hu)\n", database_timeout);
 		info("--receive-timeout   -rt  seconds to wait for receiving    (%hhu)\n", receive_timeout);
 		info("--send-timeout      -st  seconds to wait for sending      (%hhu)\n", send_timeout);
+		info("--alive-timeout     -at  seconds to keep idle alive       (%hhu)\n", alive_timeout);
+		info("--alive-requests    -ar  most requests per connection     (%hhu)\n", alive_requests);
 		info("--receive-packets   -rp  most packets allowed to receive  (%hhu)\n", receive_packets);
 		info("--send-packets      -sp  most packets allowed to send     (%hhu)\n", send_packets);
 		info("--receive-buffer    -rb  most bytes in receive buffer     (%u)\n", receive_buffer);
 		info("--send-buffer       -sb  most bytes in send buffer        (%u)\n", send_buffer);
+		info("--reply-deadline    -rd  milliseconds from rx to reply    (%hu)\n", reply_deadline);
+		info("--sim-interval      -si  milliseconds between sim uplinks (%hu)\n", sim_interval);
+		info("--sim-airtime       -sa  delay sim radios by airtime      (%s)\n", human_bool(sim_airtime));
 		info("--log-level         -ll  logging verbosity to print       (%s)\n", human_log_level(log_level));
 		info("--log-receives      -lr  log incoming transmissions       (%s)\n", human_bool(log_receives));
 		info("--log-transmits     -lt  log outgoing transmissions       (%s)\n", human_bool(log_transmits));
 		info("--log-requests      -lq  log incoming requests            (%s)\n", human_bool(log_requests));
 		info("--log-responses     -ls  log outgoing responses           (%s)\n", human_bool(log_responses));
+		info("--log-async         -la  write logs from a writer thread  (%s)\n", human_bool(log_async));
 		exit(0);
 	}
 
@@ -122,18 +138,41 @@ int main(int argc, char *argv[]) {
 		exit(0);
 	}
 
+	if (log_async == true && logger_start() == -1) {
+		exit(1);
+	}
+
 	page_init();
 
+	if (metrics_init() == -1) {
+		exit(1);
+	}
+
+	if (router_init() == -1) {
+		exit(1);
+	}
+
+	const char *backend = sha256_select();
+	if (backend == NULL) {
+		fatal("sha256 failed known answer tests\n");
+		exit(1);
+	}
+	debug("using %s sha256 backend\n", backend);
+
+	if (bwt_init() == -1) {
+		exit(1);
+	}
+
+	debug("using %s scan kernels\n", scan_init());
+	debug("using %s ssc128 lanes\n", ssc128_init());
+
 	info("starting nexus application\n");
 
-	queue.tasks = malloc(queue_size * sizeof(*queue.tasks));
-	if (queue.tasks == NULL) {
-		fatal("failed to allocate %zu bytes for tasks because %s\n", queue_size * sizeof(*queue.tasks), errno_str());
+	if (queue_init() == -1) {
 		exit(1);
 	}
 
-	if ((errno = pthread_create(&thread_pool.scaler, NULL, &scaler, NULL)) != 0) {
-		fatal("failed to spawn scaler thread because %s\n", errno_str());
+	if (context_init() == -1) {
 		exit(1);
 	}
 
@@ -152,6 +191,11 @@ int main(int argc, char *argv[]) {
 
 	info("spawned %hhu worker threads\n", least_workers);
 
+	if ((errno = pthread_create(&thread_pool.scaler, NULL, &scaler, NULL)) != 0) {
+		fatal("failed to spawn scaler thread because %s\n", errno_str());
+		exit(1);
+	}
+
 	if (transmission_init() == -1) {
 		exit(1);
 	}
@@ -195,6 +239,11 @@ int main(int argc, char *argv[]) {
 		exit(1);
 	}
 
+	if (reuse_port == true && setsockopt(server_sock, SOL_SOCKET, SO_REUSEPORT, (int[]){1}, sizeof(int)) == -1) {
+		fatal("failed to set socket reuse port because %s\n", errno_str());
+		exit(1);
+	}
+
 	server_addr.sin_family = AF_INET;
 	server_addr.sin_addr.s_addr = inet_addr(address);
 	server_addr.sin_port = htons(port);
@@ -211,50 +260,14 @@ int main(int argc, char *argv[]) {
 
 	info("listening on %s:%d\n", inet_ntoa(server_addr.sin_addr), ntohs(server_addr.sin_port));
 
-	while (true) {
-		pthread_mutex_lock(&queue.lock);
-
-		while (queue.size >= queue_size) {
-			warn("waiting for queue size %hhu to decrease\n", queue.size);
-			pthread_cond_wait(&queue.available, &queue.lock);
-		}
-
-		pthread_mutex_unlock(&queue.lock);
-
-		pthread_mutex_lock(&thread_pool.lock);
-
-		if (thread_pool.load >= thread_pool.size) {
-			pthread_cond_signal(&thread_pool.scale);
-		}
-
-		if (thread_pool.load <= thread_pool.size / 2 && thread_pool.size > least_workers) {
-			pthread_cond_signal(&thread_pool.scale);
-		}
-
-		pthread_mutex_unlock(&thread_pool.lock);
-
-		struct sockaddr_in client_addr;
-		int client_sock = accept(server_sock, (struct sockaddr *)&client_addr, &(socklen_t){sizeof(client_addr)});
-
-		if (stopping == true) {
-			break;
-		}
-
-		if (client_sock == -1) {
-			error("failed to accept client because %s\n", errno_str());
-			continue;
-		}
-
-		pthread_mutex_lock(&queue.lock);
+	if (loop_init(server_sock, &server_addr) == -1) {
+		exit(1);
+	}
 
-		queue.tasks[queue.tail].client_sock = client_sock;
-		memcpy(&queue.tasks[queue.tail].client_addr, &client_addr, sizeof(client_addr));
-		queue.tail = (uint8_t)((queue.tail + 1) % queue_size);
-		queue.size++;
-		trace("main thread increased queue size to %hhu\n", queue.size);
+	loop_join();
 
-		pthread_cond_signal(&queue.filled);
-		pthread_mutex_unlock(&queue.lock);
+	if ((errno = pthread_join(thread_pool.scaler, NULL)) != 0) {
+		error("failed to join scaler thread because %s\n", errno_str());
 	}
 
 	pthread_mutex_lock(&thread_pool.lock);
@@ -273,11 +286,16 @@ int main(int argc, char *argv[]) {
 		join(&thread_pool.workers[index], index);
 	}
 
-	free(queue.tasks);
+	context_free();
+	loop_free();
+
+	free(queue.slots);
 	free(thread_pool.workers);
 
 	page_close();
 	page_free();
+	router_free();
+	bwt_free();
 
 	for (uint8_t index = 0; index < comms.radios_len; index++) {
 		if (pthread_cancel(comms.workers[index].thread) == -1) {
@@ -287,9 +305,7 @@ int main(int argc, char *argv[]) {
 		if (pthread_join(comms.workers[index].thread, NULL) == -1) {
 			error("failed to join radio thread %02x%02x\n", (*comms.radios[index].id)[0], (*comms.radios[index].id)[1]);
 		}
-		if (close(comms.workers[index].arg.fd) == -1) {
-			error("failed to close ioctl because %s\n", errno_str());
-		}
+		sx1278_close(&comms.workers[index].arg.sx1278);
 		free(comms.radios[index].id);
 		free(comms.radios[index].device);
 	}
@@ -303,6 +319,7 @@ int main(int argc, char *argv[]) {
 	free(comms.workers);
 	free(comms.radios);
 	free(comms.devices);
+	free(comms.keys);
 
 	if (pthread_cancel(transmissions.worker.thread) == -1) {
 		error("failed to cancel transmission thread\n");
@@ -314,6 +331,7 @@ int main(int argc, char *argv[]) {
 	free(streams.ptr);
 	free(transmissions.ptr);
 
+	pthread_mutex_lock(&uplinks.lock);
 	if (uplinks.size > 0) {
 		info("waiting for %hhu uplinks...\n", uplinks.size);
 	}
@@ -321,6 +339,7 @@ int main(int argc, char *argv[]) {
 		trace("waiting for %hhu uplinks in queue\n", uplinks.size);
 		pthread_cond_wait(&uplinks.available, &uplinks.lock);
 	}
+	pthread_mutex_unlock(&uplinks.lock);
 
 	if (pthread_cancel(uplinks.worker.thread) == -1) {
 		error("failed to cancel uplink thread\n");
@@ -338,6 +357,7 @@ int main(int argc, char *argv[]) {
 	free(uplinks.worker.arg.hosts);
 	free(uplinks.ptr);
 
+	pthread_mutex_lock(&downlinks.lock);
 	if (downlinks.size > 0) {
 		info("waiting for %hhu downlinks...\n", downlinks.size);
 	}
@@ -345,6 +365,7 @@ int main(int argc, char *argv[]) {
 		trace("waiting for %hhu downlinks in queue\n", downlinks.size);
 		pthread_cond_wait(&downlinks.available, &downlinks.lock);
 	}
+	pthread_mutex_unlock(&downlinks.lock);
 
 	if (pthread_cancel(downlinks.worker.thread) == -1) {
 		error("failed to cancel downlink thread\n");
@@ -364,6 +385,8 @@ int main(int argc, char *argv[]) {
 
 	free(schedules.ptr);
 
+	metrics_free();
+
 	info("graceful shutdown complete\n");
 	exit(0);
 }